@@ -87,13 +87,17 @@ linux64:
 	# linux only, any library that should be included in the project using
 	# pkg-config
 	# ADDON_PKG_CONFIG_LIBRARIES =
+	# shm_open, for SharedLineSet, on glibc before 2.34
+	ADDON_LDFLAGS = -lrt
 vs:
 	# After compiling copy the following dynamic libraries to the executable directory
 	# only windows visual studio
 	# ADDON_DLLS_TO_COPY = 
 	
 linuxarmv6l:
+	ADDON_LDFLAGS = -lrt
 linuxarmv7l:
+	ADDON_LDFLAGS = -lrt
 android/armeabi:	
 android/armeabi-v7a:	
 osx:
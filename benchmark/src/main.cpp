@@ -0,0 +1,16 @@
+#include "ofMain.h"
+#include "ofApp.h"
+
+// The benchmark draws into FBOs only, so a hidden window is enough for the GL
+// context. Without a GPU, run it on Mesa's llvmpipe, e.g.
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a make RunRelease
+int main(){
+  ofGLFWWindowSettings settings;
+  settings.setGLVersion(4,1);
+  settings.setSize(256, 256);
+  settings.visible = false;
+  auto window = ofCreateWindow(settings);
+
+  ofRunApp(window, std::make_shared<ofApp>());
+  ofRunMainLoop();
+}
@@ -0,0 +1,130 @@
+#include "ofApp.h"
+#include <chrono>
+#include <fstream>
+
+namespace {
+
+const std::vector<int> INSTANCE_COUNTS { 100, 300, 1000, 3000, 10000 };
+const std::vector<int> FBO_SIZES { 512, 1024, 2048 };
+constexpr int WARMUP_FRAMES = 10;
+constexpr int MEASURED_FRAMES = 60;
+constexpr float CHURN = 0.01f; // fraction of the constrained lines replaced each frame
+constexpr int MAJOR_REF_POINTS = 14;
+constexpr float MIN_MAJOR_WIDTH = 12.0f;
+constexpr float MAX_MAJOR_WIDTH = 26.0f;
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void addRandomConstrainedLine(DividedArea& area) {
+  glm::vec2 ref1 { ofRandom(1.0f), ofRandom(1.0f) };
+  glm::vec2 ref2 = ref1 + glm::vec2 { ofRandom(-0.1f, 0.1f), ofRandom(-0.1f, 0.1f) };
+  area.addConstrainedDividerLine(ref1, ref2, ofFloatColor(1.0f, 1.0f, 1.0f, 0.5f), 0.0f, ofRandom(1.0f) < 0.5f);
+}
+
+}
+
+void ofApp::setup(){
+  ofSeedRandom(1);
+  std::string path = ofToDataPath("benchmark.csv", true);
+  std::ofstream csv(path);
+  csv << "instances,mode,style,fboSize,frames,cpuSubmitMs,glFinishMs,uploadedBytes,drawCalls\n";
+
+  for (int fboSize : FBO_SIZES) {
+    allocateFbos(fboSize);
+    for (int instanceCount : INSTANCE_COUNTS) {
+      for (bool oneShot : { false, true }) {
+        for (int style = 0; style < static_cast<int>(MajorLineStyle::Count); ++style) {
+          Result result = run(instanceCount, oneShot, static_cast<MajorLineStyle>(style), fboSize);
+          csv << instanceCount << ',' << (oneShot ? "oneShot" : "store") << ','
+              << '"' << majorLineStyleToString(static_cast<MajorLineStyle>(style)) << '"' << ','
+              << fboSize << ',' << result.frames << ','
+              << result.cpuSubmitMs << ',' << result.glFinishMs << ','
+              << result.uploadedBytes << ',' << result.drawCalls << '\n';
+          ofLogNotice("benchmark") << instanceCount << " lines, " << (oneShot ? "one-shot" : "store") << ", "
+                                   << majorLineStyleToString(static_cast<MajorLineStyle>(style)) << ", " << fboSize << "px: "
+                                   << result.cpuSubmitMs << "ms submit, " << result.glFinishMs << "ms finish";
+        }
+      }
+    }
+  }
+
+  csv.close();
+  ofLogNotice("benchmark") << "Wrote " << path;
+  std::exit(0);
+}
+
+void ofApp::allocateFbos(int fboSize){
+  ofFbo::Settings settings;
+  settings.width = fboSize;
+  settings.height = fboSize;
+  settings.internalformat = GL_RGBA;
+  settings.useDepth = false;
+  settings.useStencil = false;
+  settings.textureTarget = GL_TEXTURE_2D;
+  fbo.allocate(settings);
+  backgroundFbo.allocate(settings);
+  backgroundFbo.getTexture().setTextureMinMagFilter(GL_LINEAR, GL_LINEAR);
+
+  // Something for the background-sampling styles to distort
+  backgroundFbo.begin();
+  ofClear(0, 0, 0, 255);
+  for (int i = 0; i < 3; ++i) {
+    ofSetColor(ofColor::fromHsb(i * 85, 255, 255));
+    ofDrawCircle(fboSize * (0.25f + 0.25f * i), fboSize * 0.5f, fboSize * 0.1f);
+  }
+  ofSetColor(255);
+  backgroundFbo.end();
+}
+
+// Each frame replaces CHURN of the constrained lines, then draws them and the
+// major lines as a cell would
+ofApp::Result ofApp::run(int instanceCount, bool oneShot, MajorLineStyle style, int fboSize){
+  DividedArea area({ 1.0, 1.0 }, MAJOR_REF_POINTS / 2);
+  area.maxConstrainedLinesParameter = instanceCount;
+  area.constrainedOcclusionDistanceParameter = 0.0f; // so the count is reached
+  area.setMajorLineStyle(style);
+  area.setOneShotDraw(oneShot);
+
+  std::vector<glm::vec2> majorRefPoints;
+  for (int i = 0; i < MAJOR_REF_POINTS; ++i) majorRefPoints.push_back({ ofRandom(1.0f), ofRandom(1.0f) });
+  area.updateUnconstrainedDividerLines(majorRefPoints);
+  for (int attempts = 0; area.constrainedDividerLines.size() < static_cast<size_t>(instanceCount) && attempts < instanceCount * 4; ++attempts) {
+    addRandomConstrainedLine(area);
+  }
+
+  int churn = std::max(1, static_cast<int>(instanceCount * CHURN));
+  LineConfig majorLineConfig { MIN_MAJOR_WIDTH, MAX_MAJOR_WIDTH, ofColor::white };
+  Result result;
+  for (int frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; ++frame) {
+    for (int i = 0; i < churn; ++i) addRandomConstrainedLine(area);
+
+    fbo.begin();
+    ofClear(0, 0, 0, 255);
+    area.resetRenderStats();
+    auto start = Clock::now();
+    area.drawInstanced(fboSize);
+    area.draw({}, majorLineConfig, fboSize, backgroundFbo);
+    double cpuSubmitMs = millisecondsSince(start);
+    start = Clock::now();
+    glFinish();
+    double glFinishMs = millisecondsSince(start);
+    fbo.end();
+
+    if (frame < WARMUP_FRAMES) continue;
+    ++result.frames;
+    result.cpuSubmitMs += cpuSubmitMs;
+    result.glFinishMs += glFinishMs;
+    result.uploadedBytes += area.getRenderStats().uploadedBytes;
+    result.drawCalls += area.getRenderStats().drawCalls;
+  }
+
+  result.cpuSubmitMs /= result.frames;
+  result.glFinishMs /= result.frames;
+  result.uploadedBytes /= result.frames;
+  result.drawCalls /= result.frames;
+  return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxDividedArea.h"
+
+// Sweeps instance count, constrained-line draw path (the whole store redrawn
+// each frame, or OneShotDraw), major line style and FBO size, and writes the
+// mean per-frame costs to bin/data/benchmark.csv, then exits.
+class ofApp : public ofBaseApp {
+public:
+  void setup() override;
+
+private:
+  struct Result {
+    int frames = 0;
+    double cpuSubmitMs = 0.0; // issuing the draws
+    double glFinishMs = 0.0; // then waiting for the GPU to finish them
+    double uploadedBytes = 0.0;
+    double drawCalls = 0.0;
+  };
+  Result run(int instanceCount, bool oneShot, MajorLineStyle style, int fboSize);
+  void allocateFbos(int fboSize);
+
+  ofFbo fbo;
+  ofFbo backgroundFbo; // for the styles that sample what's behind them
+};
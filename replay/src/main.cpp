@@ -0,0 +1,20 @@
+#include "ofMain.h"
+#include "ofApp.h"
+
+// Replays an input log recorded with InputLogRecorder:
+//   bin/replay path/to/show.divin
+// Nothing is drawn, but DividedArea loads its shaders as it's made, so a
+// hidden window provides the GL context. Without a display, run it under
+// xvfb-run, on Mesa's llvmpipe if there's no GPU.
+int main(int argc, char* argv[]){
+  std::string logPath = (argc > 1) ? argv[1] : ofToDataPath("input.divin", true);
+
+  ofGLFWWindowSettings settings;
+  settings.setGLVersion(4,1);
+  settings.setSize(256, 256);
+  settings.visible = false;
+  auto window = ofCreateWindow(settings);
+
+  ofRunApp(window, std::make_shared<ofApp>(logPath));
+  ofRunMainLoop();
+}
@@ -0,0 +1,59 @@
+#include "ofApp.h"
+#include "InputLog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Nearest rank, of sorted
+double percentile(const std::vector<double>& sorted, double fraction) {
+  size_t rank = static_cast<size_t>(fraction * sorted.size());
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+}
+
+void ofApp::setup(){
+  InputLogPlayer player;
+  if (!player.open(logPath)) {
+    ofLogError("replay") << "Couldn't read an input log from " << logPath;
+    std::exit(2);
+  }
+  DividedArea area(player.getAreaSize(), player.getMaxUnconstrainedDividerLines());
+
+  auto start = Clock::now();
+  size_t records = player.play(area);
+  double replayMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::string path = ofToDataPath("replay.csv", true);
+  std::ofstream csv(path);
+  csv << "call,count,totalMs,meanMs,medianMs,p99Ms,maxMs\n";
+  for (size_t call = 0; call < inputlog::CALL_COUNT; ++call) {
+    std::vector<double> durations = player.getDurations(static_cast<inputlog::Record>(call));
+    if (durations.empty()) continue;
+    std::sort(durations.begin(), durations.end());
+    double totalMs = 0.0;
+    for (double ms : durations) totalMs += ms;
+    const char* name = inputlog::getRecordName(static_cast<inputlog::Record>(call));
+    csv << '"' << name << '"' << ',' << durations.size() << ',' << totalMs << ',' << totalMs / durations.size() << ','
+        << percentile(durations, 0.5) << ',' << percentile(durations, 0.99) << ',' << durations.back() << '\n';
+    ofLogNotice("replay") << name << ": " << durations.size() << " calls, " << totalMs << "ms, "
+                          << percentile(durations, 0.99) << "ms p99, " << durations.back() << "ms max";
+  }
+  csv.close();
+
+  ofLogNotice("replay") << records << " records in " << replayMs << "ms, ending with "
+                        << area.constrainedDividerLines.size() << " constrained and "
+                        << area.unconstrainedDividerLines.size() << " major lines (line set "
+                        << ofToHex(inputlog::hashLineSet(area)) << ")";
+  ofLogNotice("replay") << "Wrote " << path;
+  if (player.getCheckpointMismatchCount() > 0) {
+    ofLogError("replay") << player.getCheckpointMismatchCount() << " of " << player.getCheckpointCount()
+                         << " checkpoints didn't match the recording";
+    std::exit(1);
+  }
+  std::exit(0);
+}
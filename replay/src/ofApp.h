@@ -0,0 +1,17 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxDividedArea.h"
+
+// Feeds an input log through a new DividedArea as fast as it goes, writes
+// each kind of call's timings to bin/data/replay.csv, then exits: with 1 if
+// a line set didn't match the recording at one of its checkpoints, so a
+// bisect can use it as is.
+class ofApp : public ofBaseApp {
+public:
+  explicit ofApp(std::string logPath) : logPath(std::move(logPath)) {}
+  void setup() override;
+
+private:
+  std::string logPath;
+};
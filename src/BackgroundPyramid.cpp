@@ -0,0 +1,104 @@
+#include "BackgroundPyramid.hpp"
+#include "ofGraphics.h"
+#include <algorithm>
+#include <cmath>
+
+const ofFbo& BackgroundPyramid::getLevel(const ofFbo& newBackground, int level) {
+  level = std::clamp(level, 0, MAX_LEVEL);
+  if (level == 0) return newBackground;
+
+  if (background != &newBackground) {
+    background = &newBackground;
+    builtLevels = 0;
+  }
+  if (builtLevels < level) {
+    if (!shaderLoaded) {
+      blurShader.load();
+      shaderLoaded = true;
+    }
+    ofPushStyle();
+    ofDisableBlendMode();
+    while (builtLevels < level) {
+      buildLevel((builtLevels == 0) ? newBackground : levels[builtLevels - 1], builtLevels + 1);
+      ++builtLevels;
+    }
+    ofPopStyle();
+  }
+  return levels[level - 1];
+}
+
+// Any blur at all takes level 1 at least, as level 0 isn't blurred
+int BackgroundPyramid::levelForBlurRadius(float radius) {
+  if (!(radius > 0.0f)) return 0;
+  return std::clamp(static_cast<int>(std::lround(std::log2(radius))), 1, MAX_LEVEL);
+}
+
+void BackgroundPyramid::allocateIfNeeded(ofFbo& fbo, int width, int height) {
+  if (fbo.isAllocated() && static_cast<int>(fbo.getWidth()) == width && static_cast<int>(fbo.getHeight()) == height) return;
+  ofFbo::Settings settings;
+  settings.width = width;
+  settings.height = height;
+  settings.internalformat = GL_RGBA16F;
+  settings.textureTarget = GL_TEXTURE_2D;
+  settings.minFilter = GL_LINEAR;
+  settings.maxFilter = GL_LINEAR;
+  settings.wrapModeHorizontal = GL_CLAMP_TO_EDGE;
+  settings.wrapModeVertical = GL_CLAMP_TO_EDGE;
+  fbo.allocate(settings);
+}
+
+void BackgroundPyramid::buildLevel(const ofFbo& source, int level) {
+  int width = std::max(1, static_cast<int>(source.getWidth()) / 2);
+  int height = std::max(1, static_cast<int>(source.getHeight()) / 2);
+  ofFbo& half = halfLevels[level - 1];
+  ofFbo& target = levels[level - 1];
+  allocateIfNeeded(half, width, static_cast<int>(source.getHeight()));
+  allocateIfNeeded(target, width, height);
+
+  half.begin();
+  blurShader.draw(source.getTexture(), { 1.0f / source.getWidth(), 0.0f }, { half.getWidth(), half.getHeight() });
+  half.end();
+  target.begin();
+  blurShader.draw(half.getTexture(), { 0.0f, 1.0f / half.getHeight() }, { target.getWidth(), target.getHeight() });
+  target.end();
+}
+
+void BackgroundPyramid::BlurShader::draw(const ofTexture& source, glm::vec2 step, glm::vec2 targetSize) {
+  shader.begin();
+  shader.setUniformTexture("sourceTex", source, 0);
+  shader.setUniform2f("tapStep", step);
+  shader.setUniform2f("invTargetSize", 1.0f / targetSize);
+  ofDrawRectangle(0.0f, 0.0f, targetSize.x, targetSize.y);
+  shader.end();
+}
+
+std::string BackgroundPyramid::BlurShader::getVertexShader() {
+  return GLSL(
+    in vec4 position;
+    uniform mat4 modelViewProjectionMatrix;
+
+    void main() {
+      gl_Position = modelViewProjectionMatrix * position;
+    }
+  );
+}
+
+std::string BackgroundPyramid::BlurShader::getFragmentShader() {
+  return GLSL(
+    out vec4 fragColor;
+    uniform sampler2D sourceTex;
+    uniform vec2 tapStep;
+    uniform vec2 invTargetSize;
+
+    void main() {
+      // Texture space from the target's own pixel, so orientation is kept
+      // whatever the FBO's projection flips
+      vec2 uv = gl_FragCoord.xy * invTargetSize;
+      // A 9-tap Gaussian in 5 bilinear taps
+      vec4 sum = texture(sourceTex, uv) * 0.2270270270;
+      sum += (texture(sourceTex, uv + tapStep * 1.3846153846) + texture(sourceTex, uv - tapStep * 1.3846153846)) * 0.3162162162;
+      sum += (texture(sourceTex, uv + tapStep * 3.2307692308) + texture(sourceTex, uv - tapStep * 3.2307692308)) * 0.0702702703;
+      fragColor = sum;
+    }
+  );
+}
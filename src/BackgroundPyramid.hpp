@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+
+#include "glm/vec2.hpp"
+#include "ofFbo.h"
+#include "Shader.h"
+
+// Successively halved and blurred copies of a background FBO, for the major
+// line styles that sample what's behind them. Levels are built on first use
+// after invalidate and then shared by every line and style that asks for
+// them, so a blurred sample costs one texture tap however wide the blur.
+// DividedArea invalidates its pyramid at the start of each draw with a
+// background; anyone else must likewise call invalidate whenever the
+// background's contents change, as only a different FBO is noticed.
+//
+// Level 0 is the background itself. Level n is 1/2^n of its size, each level
+// made from the one below by a separable Gaussian (a horizontal pass that
+// halves the width, then a vertical one that halves the height), so a single
+// bilinear tap of level n averages roughly 2^n background pixels either way.
+// Textures are in the same orientation as the background's.
+class BackgroundPyramid {
+public:
+  static constexpr int MAX_LEVEL = 6;
+
+  // Rebuilt after invalidate or for a different background; level is
+  // clamped to 0..MAX_LEVEL. Render thread only.
+  const ofFbo& getLevel(const ofFbo& background, int level);
+  void invalidate() { builtLevels = 0; }
+
+  // The level closest to a box blur of radius pixels, as BlurRefraction used
+  // to take in nine taps; 0 only for no blur
+  static int levelForBlurRadius(float radius);
+
+private:
+  class BlurShader : public Shader {
+  public:
+    // Fills the current target, stepping `step` (in source texture units)
+    // between taps
+    void draw(const ofTexture& source, glm::vec2 step, glm::vec2 targetSize);
+  protected:
+    std::string getVertexShader() override;
+    std::string getFragmentShader() override;
+  };
+
+  void buildLevel(const ofFbo& source, int level);
+  static void allocateIfNeeded(ofFbo& fbo, int width, int height);
+
+  BlurShader blurShader;
+  bool shaderLoaded = false;
+  const ofFbo* background = nullptr;
+  int builtLevels = 0; // levels 1..builtLevels are current
+  std::array<ofFbo, MAX_LEVEL> levels; // levels[n - 1] is level n
+  std::array<ofFbo, MAX_LEVEL> halfLevels; // after each level's horizontal pass
+};
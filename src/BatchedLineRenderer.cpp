@@ -0,0 +1,148 @@
+#include "BatchedLineRenderer.hpp"
+#include "ofGraphics.h"
+#include <algorithm>
+#include <cstring>
+
+static constexpr int ATTR_LOC_CELL = 6; // after DividedArea's instance attributes
+
+void BatchedLineRenderer::setup() {
+  // The same unit quad as DividedArea's
+  quad.setMode(OF_PRIMITIVE_TRIANGLES);
+  quad.addVertex({-0.5f, -0.5f, 0.0f});
+  quad.addVertex({ 0.5f, -0.5f, 0.0f});
+  quad.addVertex({ 0.5f,  0.5f, 0.0f});
+  quad.addVertex({-0.5f,  0.5f, 0.0f});
+  quad.addIndex(0); quad.addIndex(1); quad.addIndex(2);
+  quad.addIndex(2); quad.addIndex(3); quad.addIndex(0);
+  vbo.setMesh(quad, GL_STATIC_DRAW);
+  shader.load();
+  cellBO.allocate(MAX_CELLS * sizeof(BatchedDividerLineCell), nullptr, GL_DYNAMIC_DRAW);
+}
+
+bool BatchedLineRenderer::layOut(const std::vector<Cell>& cells, size_t cellCount) {
+  bool moved = (slots.size() != cellCount);
+  for (size_t i = 0; i < cellCount && !moved; ++i) {
+    moved = slots[i].area != cells[i].area || slots[i].capacity != cells[i].area->getConstrainedLineStorageCapacity();
+  }
+  if (!moved) return false;
+
+  slots.clear();
+  cellIndices.clear();
+  size_t offset = 0;
+  for (size_t i = 0; i < cellCount; ++i) {
+    size_t capacity = cells[i].area->getConstrainedLineStorageCapacity();
+    // Counted as full so update blanks whatever its lines don't cover
+    slots.push_back(Slot { cells[i].area, offset, capacity, 0, capacity });
+    cellIndices.insert(cellIndices.end(), capacity, static_cast<float>(i));
+    offset += capacity;
+  }
+  reserve(offset);
+  if (!cellIndices.empty()) {
+    cellIndexBO.updateData(0, cellIndices.size() * sizeof(float), cellIndices.data());
+    renderStats.uploadedBytes += cellIndices.size() * sizeof(float);
+  }
+  return true;
+}
+
+// Doubling, as DividedArea::reserveInstanceBuffers does
+void BatchedLineRenderer::reserve(size_t instanceCount) {
+  if (instanceCount <= allocatedInstances) return;
+  allocatedInstances = std::max(instanceCount, allocatedInstances * 2);
+  instanceBO.allocate(allocatedInstances * sizeof(ConstrainedDividerLine), nullptr, GL_DYNAMIC_DRAW);
+  cellIndexBO.allocate(allocatedInstances * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+  bindFrom(0);
+}
+
+// Both per-instance buffers, from the same instance
+void BatchedLineRenderer::bindFrom(size_t firstInstance) {
+  DividedArea::bindInstanceAttributes(vbo, instanceBO, firstInstance);
+  vbo.bind();
+  vbo.setAttributeBuffer(ATTR_LOC_CELL, cellIndexBO, 1, sizeof(float), firstInstance * sizeof(float));
+  vbo.setAttributeDivisor(ATTR_LOC_CELL, 1);
+  vbo.unbind();
+  boundFirstInstance = firstInstance;
+}
+
+// Null lines uploads blank (zero-width, transparent) ones
+void BatchedLineRenderer::upload(size_t offset, size_t count, const ConstrainedDividerLine* lines) {
+  if (count == 0) return;
+  if (!lines) {
+    if (blankLines.size() < count) blankLines.resize(count, ConstrainedDividerLine { {}, {}, 0.0f, 0.0f, ofFloatColor(0.0f, 0.0f, 0.0f, 0.0f), {}, {} });
+    lines = blankLines.data();
+  }
+  instanceBO.updateData(offset * sizeof(ConstrainedDividerLine), count * sizeof(ConstrainedDividerLine), lines);
+  renderStats.uploadedBytes += count * sizeof(ConstrainedDividerLine);
+}
+
+void BatchedLineRenderer::draw(const std::vector<Cell>& cells, float scale) {
+  update(cells);
+  drawCells(0, cells.size(), scale);
+}
+
+void BatchedLineRenderer::update(const std::vector<Cell>& cells) {
+  size_t cellCount = std::min(cells.size(), static_cast<size_t>(MAX_CELLS));
+  if (cellCount == 0) {
+    slots.clear();
+    return;
+  }
+  if (quad.getNumVertices() == 0) setup();
+
+  bool moved = layOut(cells, cellCount);
+  cellData.resize(cellCount);
+  for (size_t i = 0; i < cellCount; ++i) {
+    DividedArea& area = *cells[i].area;
+    Slot& slot = slots[i];
+    const ConstrainedDividerLine* lines = area.constrainedDividerLines.getStorage();
+    area.takeInstanceChanges(changes);
+    size_t end = std::min(area.constrainedDividerLines.getStorageSize(), slot.capacity);
+    size_t head = std::min(changes.head, end);
+    size_t from = moved ? head : std::min(changes.changedFrom, end);
+    // Blank what went from either end since the last upload
+    if (slot.head < std::min(head, slot.end)) upload(slot.offset + slot.head, std::min(head, slot.end) - slot.head, nullptr);
+    if (std::max(end, slot.head) < slot.end) upload(slot.offset + std::max(end, slot.head), slot.end - std::max(end, slot.head), nullptr);
+    if (!moved) {
+      changes.forEachChangedRun([&](size_t first, size_t count) {
+        if (first < from) upload(slot.offset + first, std::min(count, from - first), lines + first);
+      });
+    }
+    upload(slot.offset + from, end - from, lines + from);
+    slot.head = head;
+    slot.end = end;
+
+    cellData[i] = BatchedDividerLineCell { area.getDividerLineShape(), cells[i].scale, cells[i].offset };
+  }
+  if (cellData.size() != uploadedCellData.size()
+      || std::memcmp(cellData.data(), uploadedCellData.data(), cellData.size() * sizeof(BatchedDividerLineCell)) != 0) {
+    cellBO.updateData(0, cellData.size() * sizeof(BatchedDividerLineCell), cellData.data());
+    renderStats.uploadedBytes += cellData.size() * sizeof(BatchedDividerLineCell);
+    uploadedCellData = cellData;
+  }
+}
+
+void BatchedLineRenderer::drawCells(size_t first, size_t count, float scale) {
+  size_t last = std::min(first + count, slots.size());
+  if (first >= last) return;
+  // From the first slot's head to the last slot's end; the blanks in between draw nothing
+  size_t firstInstance = 0, endInstance = 0;
+  for (size_t i = first; i < last; ++i) {
+    if (slots[i].head == slots[i].end) continue;
+    if (endInstance == 0) firstInstance = slots[i].offset + slots[i].head;
+    endInstance = slots[i].offset + slots[i].end;
+  }
+  if (endInstance == 0) return;
+  size_t drawCount = endInstance - firstInstance;
+  if (boundFirstInstance != firstInstance) bindFrom(firstInstance);
+
+  ofPushMatrix();
+  ofScale(scale);
+  ofEnableBlendMode(OF_BLENDMODE_ALPHA);
+  ofFill(); glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); ofDisableDepthTest();
+  shader.begin(cellBO);
+  vbo.bind();
+  vbo.drawElementsInstanced(GL_TRIANGLES, quad.getNumIndices(), static_cast<int>(drawCount));
+  ++renderStats.drawCalls;
+  renderStats.instances += drawCount;
+  vbo.unbind();
+  shader.end();
+  ofPopMatrix();
+}
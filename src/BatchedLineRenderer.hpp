@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "ofBufferObject.h"
+#include "ofVbo.h"
+#include "ofMesh.h"
+#include "DividerLineShader.h"
+#include "ofxDividedArea.h"
+
+// Draws the constrained lines of many DividedAreas in a single instanced draw,
+// from one instance buffer, in place of each area's drawInstanced.
+//
+// Every area has a fixed slot in the buffer, laid out as its store's storage
+// is (see DividedArea::getConstrainedLineStorageCapacity), so its lines keep
+// their place however the others change and each draw uploads only what
+// changed since the last (see DividedArea::takeInstanceChanges): evicting the
+// oldest lines just blanks them. The parts of a slot without lines hold
+// degenerate instances that draw nothing. A per-instance cell index picks the
+// area's shape settings and transform from a uniform block of
+// BatchedDividerLineCell.
+//
+// Areas are drawn in the order given, as consecutive drawInstanced calls
+// would draw them. An area in OneShotDraw or async geometry mode can't be
+// batched (see canBatch), and at most MAX_CELLS can be. To draw other things
+// between them, upload every area once with update and draw consecutive runs
+// of them with drawCells; the slots stay put, so nothing is uploaded twice.
+class BatchedLineRenderer {
+public:
+  static constexpr int MAX_CELLS = BatchedDividerLineShader::MAX_CELLS;
+
+  struct Cell {
+    DividedArea* area;
+    glm::vec2 offset { 0.0f, 0.0f }; // in the area's units, after scale
+    float scale = 1.0f;
+  };
+
+  static bool canBatch(const DividedArea& area) { return !area.isOneShotDraw() && !area.isAsyncGeometry(); }
+
+  // Render thread only. scale as for drawInstanced; cells past MAX_CELLS are
+  // ignored.
+  void draw(const std::vector<Cell>& cells, float scale = 1.0f);
+  // draw split in two: update uploads what changed for cells, then drawCells
+  // draws count of them from first, in one draw
+  void update(const std::vector<Cell>& cells);
+  void drawCells(size_t first, size_t count, float scale = 1.0f);
+
+  const DividedArea::RenderStats& getRenderStats() const { return renderStats; }
+  void resetRenderStats() { renderStats = DividedArea::RenderStats {}; }
+
+private:
+  struct Slot {
+    const DividedArea* area;
+    size_t offset, capacity;
+    size_t head, end; // the lines uploaded, in the area's storage; the rest of the slot is blank
+  };
+
+  void setup();
+  // Returns true if the slots moved, when everything is uploaded again
+  bool layOut(const std::vector<Cell>& cells, size_t cellCount);
+  void reserve(size_t instanceCount);
+  void upload(size_t offset, size_t count, const ConstrainedDividerLine* lines);
+  void bindFrom(size_t firstInstance);
+
+  BatchedDividerLineShader shader;
+  ofMesh quad;
+  ofVbo vbo;
+  ofBufferObject instanceBO; // every slot's lines
+  ofBufferObject cellIndexBO; // a float per instance
+  ofBufferObject cellBO; // a BatchedDividerLineCell per cell
+  size_t allocatedInstances = 0;
+  size_t boundFirstInstance = 0; // where the instance attributes start
+  std::vector<Slot> slots;
+  std::vector<BatchedDividerLineCell> cellData, uploadedCellData;
+  std::vector<float> cellIndices;
+  std::vector<ConstrainedDividerLine> blankLines; // for clearing evicted lines and slot tails
+  DividedArea::InstanceChanges changes;
+  DividedArea::RenderStats renderStats;
+};
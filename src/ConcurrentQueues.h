@@ -0,0 +1,161 @@
+//
+//  ConcurrentQueues.h
+//  ofxDividedArea
+//
+//  Lock-free hand-off primitives for moving geometry inputs and snapshots
+//  between threads without blocking either side.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring. push and pop are wait-free;
+// push fails (returns false) when the ring is full rather than blocking.
+// Capacity is rounded up to a power of two.
+template<typename T>
+class SpscQueue {
+public:
+  explicit SpscQueue(size_t minCapacity = 1024) {
+    size_t capacity = 2;
+    while (capacity < minCapacity) capacity <<= 1;
+    slots.resize(capacity);
+    mask = capacity - 1;
+  }
+
+  size_t capacity() const { return slots.size(); }
+
+  // Producer thread only
+  bool push(T&& value) {
+    size_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail - headIndex.load(std::memory_order_acquire) == slots.size()) return false;
+    slots[tail & mask] = std::move(value);
+    tailIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  bool push(const T& value) { T copy = value; return push(std::move(copy)); }
+
+  // Consumer thread only
+  bool pop(T& value) {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    if (head == tailIndex.load(std::memory_order_acquire)) return false;
+    value = std::move(slots[head & mask]);
+    headIndex.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate when called from a third thread
+  size_t size() const {
+    return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+  }
+
+private:
+  std::vector<T> slots;
+  size_t mask;
+  alignas(64) std::atomic<size_t> headIndex { 0 };
+  alignas(64) std::atomic<size_t> tailIndex { 0 };
+};
+
+// Single-producer/single-consumer "latest value wins" slot. The producer fills
+// getWriteBuffer() in place and publishes it with a single atomic exchange; the
+// consumer swaps in the newest published buffer with update() and reads it via
+// getReadBuffer() for as long as it likes. Neither side ever waits, and buffers
+// are recycled so steady-state use doesn't allocate. Values published but never
+// picked up are simply overwritten.
+template<typename T>
+class TripleBuffer {
+public:
+  // Producer thread only
+  T& getWriteBuffer() { return buffers[backIndex]; }
+  // Which of the three getWriteBuffer is, for producers keeping per-buffer state
+  size_t getWriteIndex() const { return backIndex; }
+  void publish() {
+    uint8_t previous = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+    backIndex = previous & INDEX_MASK;
+  }
+
+  // Consumer thread only. Returns true if a newer buffer was swapped in.
+  bool update() {
+    if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+    uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+    frontIndex = previous & INDEX_MASK;
+    return true;
+  }
+  const T& getReadBuffer() const { return buffers[frontIndex]; }
+  T& getReadBuffer() { return buffers[frontIndex]; }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+
+  T buffers[3];
+  uint8_t backIndex = 0;
+  std::atomic<uint8_t> middle { 1 };
+  uint8_t frontIndex = 2;
+};
+
+// Bounded multi-producer/single-consumer ring (Vyukov's sequenced-slot
+// design). Producers never block or take a lock: push claims a slot with a
+// single CAS (retried only when another producer won the same slot) and fails
+// when the ring is full. pop is wait-free for the single consumer.
+template<typename T>
+class MpscQueue {
+public:
+  explicit MpscQueue(size_t minCapacity = 1024) {
+    size_t capacity = 2;
+    while (capacity < minCapacity) capacity <<= 1;
+    cells = std::make_unique<Cell[]>(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  // Any thread
+  bool push(const T& value) {
+    Cell* cell;
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells[position & mask];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false; // full
+      } else {
+        position = enqueuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = value;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer thread only
+  bool pop(T& value) {
+    Cell& cell = cells[dequeuePosition & mask];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(dequeuePosition + 1) < 0) return false; // empty
+    value = std::move(cell.value);
+    cell.sequence.store(dequeuePosition + mask + 1, std::memory_order_release);
+    ++dequeuePosition;
+    return true;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+  alignas(64) std::atomic<size_t> enqueuePosition { 0 };
+  alignas(64) size_t dequeuePosition = 0;
+};
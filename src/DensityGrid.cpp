@@ -0,0 +1,74 @@
+#include "DensityGrid.hpp"
+#include "GeomUtils.h"
+#include <algorithm>
+#include <cmath>
+
+void DensityGrid::reset(glm::vec2 areaSize, int newResolution) {
+  resolution = std::max(1, newResolution);
+  cellSize = std::max(areaSize.x, areaSize.y) / static_cast<float>(resolution);
+  if (!(cellSize > 0.0f)) cellSize = 1.0f;
+  width = std::max(1, static_cast<int>(std::ceil(areaSize.x / cellSize)));
+  height = std::max(1, static_cast<int>(std::ceil(areaSize.y / cellSize)));
+  cells.assign(width * height, {});
+  crossings.assign(width * height, {});
+}
+
+void DensityGrid::clear() {
+  for (auto& cell : cells) cell.clear();
+  for (auto& cell : crossings) cell.clear();
+}
+
+int DensityGrid::getCell(glm::vec2 point) const {
+  int x = std::clamp(static_cast<int>(std::floor(point.x / cellSize)), 0, width - 1);
+  int y = std::clamp(static_cast<int>(std::floor(point.y / cellSize)), 0, height - 1);
+  return y * width + x;
+}
+
+glm::vec2 DensityGrid::getCellCenter(int cell) const {
+  return { ((cell % width) + 0.5f) * cellSize, ((cell / width) + 0.5f) * cellSize };
+}
+
+glm::vec2 DensityGrid::getCellMin(int cell) const {
+  return { (cell % width) * cellSize, (cell / width) * cellSize };
+}
+
+void DensityGrid::addLine(glm::vec2 start, glm::vec2 end, uint64_t id) {
+  if (cells.empty()) return;
+  // Kept sorted: a line re-added after a reflow keeps its age
+  auto& ids = cells[getCell((start + end) * 0.5f)];
+  ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+  forEachCellAlong(start, end, [&](int cell) { crossings[cell].push_back(Crossing { id, start, end }); });
+}
+
+void DensityGrid::removeLine(glm::vec2 start, glm::vec2 end, uint64_t id) {
+  if (cells.empty()) return;
+  auto& ids = cells[getCell((start + end) * 0.5f)];
+  auto it = std::lower_bound(ids.begin(), ids.end(), id);
+  if (it == ids.end() || *it != id) return;
+  ids.erase(it);
+  forEachCellAlong(start, end, [&](int cell) {
+    auto& lines = crossings[cell];
+    auto crossing = std::find_if(lines.begin(), lines.end(), [id](const Crossing& c) { return c.id == id; });
+    if (crossing == lines.end()) return;
+    *crossing = lines.back();
+    lines.pop_back();
+  });
+}
+
+int DensityGrid::getDensestCell() const {
+  int densest = -1;
+  size_t densestCount = 0;
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (cells[i].size() > densestCount) {
+      densest = static_cast<int>(i);
+      densestCount = cells[i].size();
+    }
+  }
+  return densest;
+}
+
+int DensityGrid::getSparsestCell() const {
+  if (crossings.empty()) return -1;
+  auto sparsest = std::min_element(crossings.begin(), crossings.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+  return static_cast<int>(sparsest - crossings.begin());
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "GeomUtils.h"
+
+// Coarse spatial histogram and index of lines over an area. Each cell keeps
+// the lines crossing it (walked cell by cell), so the lines near a segment
+// are a walk along it away, and separately the ids of the lines whose
+// midpoint it holds, in ascending order, so with ids that grow with age the
+// oldest line in the busiest cell is one scan of the cells away.
+class DensityGrid {
+public:
+  struct Crossing {
+    uint64_t id;
+    glm::vec2 start, end;
+  };
+
+  // Square cells, resolution of them along the longer side
+  void reset(glm::vec2 areaSize, int resolution);
+  void clear();
+  bool isAllocated() const { return !cells.empty(); }
+  int getResolution() const { return resolution; }
+
+  void addLine(glm::vec2 start, glm::vec2 end, uint64_t id);
+  void removeLine(glm::vec2 start, glm::vec2 end, uint64_t id);
+
+  int getCellCount() const { return static_cast<int>(cells.size()); }
+  int getCell(glm::vec2 point) const; // clamped to the grid
+  glm::vec2 getCellCenter(int cell) const;
+  glm::vec2 getCellMin(int cell) const;
+  float getCellSize() const { return cellSize; }
+  // Lines crossing the cell, in no particular order
+  int getCoverage(int cell) const { return static_cast<int>(crossings[cell].size()); }
+  const std::vector<Crossing>& getCrossings(int cell) const { return crossings[cell]; }
+  // Calls fn(cell) for the cells the segment a-b passes through, in order
+  // from a; fn may return false to stop
+  template<typename F>
+  void forEachCellAlong(glm::vec2 a, glm::vec2 b, F&& fn) const {
+    geom::forEachGridCell(a / cellSize, b / cellSize, width, height, [&](int x, int y) { return fn(y * width + x); });
+  }
+  // Lines with their midpoint in the cell, ids ascending
+  int getLineCount(int cell) const { return static_cast<int>(cells[cell].size()); }
+  const std::vector<uint64_t>& getLineIds(int cell) const { return cells[cell]; }
+  // By line count; -1 if there are no lines
+  int getDensestCell() const;
+  // By coverage, the first of any ties
+  int getSparsestCell() const;
+
+private:
+  std::vector<std::vector<uint64_t>> cells;
+  std::vector<std::vector<Crossing>> crossings;
+  int width = 0, height = 0;
+  int resolution = 0;
+  float cellSize = 1.0f;
+};
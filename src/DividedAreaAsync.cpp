@@ -0,0 +1,342 @@
+#include "ofxDividedArea.h"
+#include "ConcurrentQueues.h"
+#include "InputLog.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct GeometryCommand {
+  enum class Type { MajorRefPoints, ConstrainedLine, OneShotDraw };
+  Type type = Type::ConstrainedLine;
+  std::vector<glm::vec2> majorRefPoints;
+  float dt = 0.0f;
+  ConstrainedLineRequest request;
+  bool enabled = false; // OneShotDraw
+};
+
+// Everything the render thread needs from one geometry batch. Immutable once
+// published; the buffers are recycled by the TripleBuffer.
+struct GeometrySnapshot {
+  // The constrained lines, laid out as the area's store is, evicted lines
+  // (whose contents are stale) included
+  ConstrainedLineStore instances;
+  // What each recent batch changed in that storage, by generation, for as
+  // far back as the renderer may not have uploaded: the first line from
+  // which everything changed, and single lines changed before it
+  std::vector<std::pair<uint64_t, size_t>> instanceChanges;
+  std::vector<std::pair<uint64_t, size_t>> changedInstances;
+  std::vector<Line> majorLines;
+  bool oneShotDraw = false;
+  // OneShotDraw: lines the renderer hasn't acknowledged drawing yet, the
+  // last of which has sequence number lastOneShotSequence
+  ConstrainedDividerLines oneShotInstances;
+  uint64_t lastOneShotSequence = 0;
+  int instanceCapacity = 0;
+  uint64_t generation = 0;
+  uint64_t appliedCommands = 0; // queued calls applied so far
+};
+
+}
+
+struct DividedArea::AsyncGeometry {
+  SpscQueue<GeometryCommand> commands { 1024 };
+  TripleBuffer<GeometrySnapshot> snapshots;
+  std::thread thread;
+  std::atomic<bool> running { true };
+  std::mutex wakeMutex; // only for sleeping when idle; never held by the producer while pushing
+  std::condition_variable wake;
+
+  // Geometry thread. OneShotDraw lines are kept until the renderer
+  // acknowledges drawing them, so a snapshot that's overwritten before being
+  // latched doesn't lose them.
+  std::deque<ConstrainedDividerLine> unacknowledgedOneShot;
+  uint64_t lastOneShotSequence = 0;
+  uint64_t generation = 0;
+  uint64_t appliedCommands = 0;
+  std::atomic<uint64_t> acknowledgedOneShotSequence { 0 };
+  // Geometry thread. Each buffer is brought up to date from the first line
+  // changed since it was last written and the single lines changed before
+  // that, and the renderer's upload likewise from the changes since the
+  // generation it last uploaded. Evicting the oldest lines copies nothing.
+  DividedArea::InstanceChanges changes;
+  std::array<size_t, 3> snapshotStaleFrom {};
+  std::array<std::vector<size_t>, 3> snapshotStaleLines;
+  std::deque<std::pair<uint64_t, size_t>> instanceChanges;
+  std::deque<std::pair<uint64_t, size_t>> changedInstances;
+  std::atomic<uint64_t> acknowledgedGeneration { 0 };
+  static constexpr size_t MAX_INSTANCE_CHANGES = 64;
+  static constexpr size_t MAX_STALE_LINES = 256;
+
+  // Render thread
+  uint64_t uploadedGeneration = 0;
+  uint64_t drawnOneShotSequence = 0;
+  DividedArea::InstanceChanges uploadChanges;
+
+  static void apply(DividedArea& area, const GeometryCommand& command) {
+    switch (command.type) {
+      case GeometryCommand::Type::MajorRefPoints:
+        area.updateUnconstrainedDividerLines(command.majorRefPoints, command.dt);
+        break;
+      case GeometryCommand::Type::ConstrainedLine:
+        area.addConstrainedDividerLine(command.request);
+        break;
+      case GeometryCommand::Type::OneShotDraw:
+        area.applyOneShotDraw(command.enabled);
+        break;
+    }
+  }
+
+  void run(DividedArea& area) {
+    GeometryCommand command;
+    auto lastMajorFrameTime = std::chrono::steady_clock::now();
+    while (running.load(std::memory_order_acquire)) {
+      // Bound each batch to what's queued now so a busy producer can't starve publication
+      size_t batchSize = commands.size();
+      for (size_t i = 0; i < batchSize && commands.pop(command); ++i) {
+        apply(area, command);
+        ++appliedCommands;
+      }
+      // Also take anything handed over through the ingestion queues, timing
+      // major frames by their arrival here since there's no app frame time
+      auto now = std::chrono::steady_clock::now();
+      float dt = std::chrono::duration<float>(now - lastMajorFrameTime).count();
+      InputDrainStats drained = area.drainInputs(dt);
+      if (drained.majorFrameApplied) lastMajorFrameTime = now;
+      if (batchSize > 0 || drained.majorFrameApplied || drained.constrainedLinesApplied > 0) {
+        publish(area);
+      } else {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait_for(lock, std::chrono::milliseconds(1));
+      }
+    }
+  }
+
+  void publish(DividedArea& area) {
+    if (area.oneShotDraw) {
+      for (const auto& line : area.takePendingConstrainedLines()) {
+        unacknowledgedOneShot.push_back(line);
+        ++lastOneShotSequence;
+      }
+    } else {
+      area.skipPendingConstrainedLines();
+    }
+    uint64_t acknowledged = acknowledgedOneShotSequence.load(std::memory_order_acquire);
+    uint64_t firstSequence = lastOneShotSequence - unacknowledgedOneShot.size() + 1;
+    while (!unacknowledgedOneShot.empty()
+           && (firstSequence <= acknowledged || unacknowledgedOneShot.size() > static_cast<size_t>(area.instanceCapacity))) {
+      unacknowledgedOneShot.pop_front();
+      ++firstSequence;
+    }
+
+    const ConstrainedLineStore& lines = area.constrainedDividerLines;
+    size_t head = lines.getHead(), storageSize = lines.getStorageSize();
+    area.takeInstanceChanges(changes);
+    for (size_t b = 0; b < snapshotStaleFrom.size(); ++b) {
+      std::vector<size_t>& staleLines = snapshotStaleLines[b];
+      snapshotStaleFrom[b] = std::min(snapshotStaleFrom[b], changes.changedFrom);
+      staleLines.insert(staleLines.end(), changes.changedLines.begin(), changes.changedLines.end());
+      // A buffer the renderer holds on to can miss many batches
+      if (staleLines.size() > MAX_STALE_LINES) {
+        snapshotStaleFrom[b] = std::min(snapshotStaleFrom[b], *std::min_element(staleLines.begin(), staleLines.end()));
+        staleLines.clear();
+      }
+    }
+    size_t writeIndex = snapshots.getWriteIndex();
+    GeometrySnapshot& snapshot = snapshots.getWriteBuffer();
+    snapshot.instances.resizeStorage(storageSize, head);
+    ConstrainedDividerLine* copy = snapshot.instances.getStorage();
+    size_t staleFrom = std::clamp(snapshotStaleFrom[writeIndex], head, storageSize);
+    for (size_t slot : snapshotStaleLines[writeIndex]) {
+      if (slot >= head && slot < staleFrom) copy[slot] = lines.getStorage()[slot];
+    }
+    std::copy(lines.getStorage() + staleFrom, lines.getStorage() + storageSize, copy + staleFrom);
+    snapshotStaleFrom[writeIndex] = storageSize;
+    snapshotStaleLines[writeIndex].clear();
+
+    uint64_t uploaded = acknowledgedGeneration.load(std::memory_order_acquire);
+    while (!instanceChanges.empty() && (instanceChanges.front().first <= uploaded || instanceChanges.size() >= MAX_INSTANCE_CHANGES)) {
+      instanceChanges.pop_front();
+    }
+    instanceChanges.emplace_back(generation + 1, changes.changedFrom);
+    while (!changedInstances.empty() && changedInstances.front().first < instanceChanges.front().first) {
+      changedInstances.pop_front();
+    }
+    for (size_t slot : changes.changedLines) changedInstances.emplace_back(generation + 1, slot);
+    snapshot.instanceChanges.assign(instanceChanges.begin(), instanceChanges.end());
+    snapshot.changedInstances.assign(changedInstances.begin(), changedInstances.end());
+
+    snapshot.majorLines.clear();
+    for (const auto& dl : area.unconstrainedDividerLines) {
+      snapshot.majorLines.push_back(Line { dl.start, dl.end });
+    }
+    snapshot.oneShotInstances.assign(unacknowledgedOneShot.begin(), unacknowledgedOneShot.end());
+    snapshot.lastOneShotSequence = lastOneShotSequence;
+    snapshot.oneShotDraw = area.oneShotDraw;
+    snapshot.instanceCapacity = area.instanceCapacity;
+    snapshot.generation = ++generation;
+    snapshot.appliedCommands = appliedCommands;
+    snapshots.publish();
+  }
+};
+
+void DividedArea::AsyncGeometryDeleter::operator()(AsyncGeometry* async) const {
+  delete async;
+}
+
+DividedArea::~DividedArea() {
+  setAsyncGeometry(false);
+  if (inputRecorder) inputRecorder->close(); // after the queued input is applied, and recorded
+}
+
+void DividedArea::setAsyncGeometry(bool enabled) {
+  if (enabled == (asyncGeometry != nullptr)) return;
+
+  if (enabled) {
+    asyncGeometry.reset(new AsyncGeometry());
+    AsyncGeometry* async = asyncGeometry.get();
+    async->publish(*this); // so the renderer starts from the current state
+    async->thread = std::thread([this, async] { async->run(*this); });
+    return;
+  }
+
+  asyncGeometry->running.store(false, std::memory_order_release);
+  asyncGeometry->wake.notify_one();
+  asyncGeometry->thread.join();
+  GeometryCommand command;
+  while (asyncGeometry->commands.pop(command)) {
+    AsyncGeometry::apply(*this, command);
+  }
+  asyncGeometry.reset();
+  // Anything left in the ingestion queues waits for the caller's next drainInputs
+  asyncMajorLines.clear();
+  // The render-side buffers were filled from snapshots
+  instanceBOLost = true;
+}
+
+bool DividedArea::submitMajorRefPoints(std::vector<glm::vec2> majorRefPoints, float dt) {
+  if (!asyncGeometry) {
+    updateUnconstrainedDividerLines(majorRefPoints, dt);
+    return true;
+  }
+  GeometryCommand command;
+  command.type = GeometryCommand::Type::MajorRefPoints;
+  command.majorRefPoints = std::move(majorRefPoints);
+  command.dt = dt;
+  if (!asyncGeometry->commands.push(std::move(command))) return false;
+  asyncGeometry->wake.notify_one();
+  return true;
+}
+
+bool DividedArea::setOneShotDraw(bool enabled) {
+  if (!asyncGeometry) {
+    applyOneShotDraw(enabled);
+    return true;
+  }
+  GeometryCommand command;
+  command.type = GeometryCommand::Type::OneShotDraw;
+  command.enabled = enabled;
+  if (!asyncGeometry->commands.push(std::move(command))) return false;
+  asyncGeometry->wake.notify_one();
+  return true;
+}
+
+bool DividedArea::submitConstrainedDividerLine(const ConstrainedLineRequest& request) {
+  if (!asyncGeometry) {
+    addConstrainedDividerLine(request);
+    return true;
+  }
+  GeometryCommand command;
+  command.type = GeometryCommand::Type::ConstrainedLine;
+  command.request = request;
+  if (!asyncGeometry->commands.push(std::move(command))) return false;
+  asyncGeometry->wake.notify_one();
+  return true;
+}
+
+uint64_t DividedArea::latchAsyncGeometry() {
+  if (!asyncGeometry) return 0;
+  const GeometrySnapshot& snapshot = asyncGeometry->snapshots.getReadBuffer();
+  if (!asyncGeometry->snapshots.update()) return snapshot.appliedCommands;
+  const GeometrySnapshot& latched = asyncGeometry->snapshots.getReadBuffer();
+  asyncMajorLines.resize(latched.majorLines.size());
+  for (size_t i = 0; i < latched.majorLines.size(); ++i) {
+    asyncMajorLines[i].start = latched.majorLines[i].start;
+    asyncMajorLines[i].end = latched.majorLines[i].end;
+  }
+  return latched.appliedCommands;
+}
+
+const ConstrainedLineStore& DividedArea::getLatchedConstrainedLines() const {
+  static const ConstrainedLineStore none;
+  return asyncGeometry ? asyncGeometry->snapshots.getReadBuffer().instances : none;
+}
+
+void DividedArea::drawInstancedAsync(float scale) {
+  latchAsyncGeometry();
+  AsyncGeometry& async = *asyncGeometry;
+  const GeometrySnapshot& snapshot = async.snapshots.getReadBuffer();
+
+  const ConstrainedLineStore& instances = snapshot.instances;
+  int requiredCapacity = std::max({ 2 * snapshot.instanceCapacity, static_cast<int>(instances.getStorageSize()),
+                                    static_cast<int>(snapshot.oneShotInstances.size()) });
+  if (reserveInstanceBuffers(requiredCapacity)) async.uploadedGeneration = 0;
+
+  if (snapshot.oneShotDraw) {
+    if (snapshot.oneShotInstances.empty()) return;
+    uint64_t firstSequence = snapshot.lastOneShotSequence - snapshot.oneShotInstances.size() + 1;
+    size_t alreadyDrawn = (async.drawnOneShotSequence >= firstSequence)
+        ? static_cast<size_t>(async.drawnOneShotSequence - firstSequence + 1) : 0;
+    if (alreadyDrawn >= snapshot.oneShotInstances.size()) return;
+    int count = static_cast<int>(snapshot.oneShotInstances.size() - alreadyDrawn);
+    pendingBO.updateData(0, count * sizeof(ConstrainedDividerLine), &snapshot.oneShotInstances[alreadyDrawn]);
+    renderStats.uploadedBytes += count * sizeof(ConstrainedDividerLine);
+    drawInstanceBuffer(pendingVbo, count, scale);
+    async.drawnOneShotSequence = snapshot.lastOneShotSequence;
+    async.acknowledgedOneShotSequence.store(async.drawnOneShotSequence, std::memory_order_release);
+    return;
+  }
+
+  if (instances.empty()) return;
+  size_t head = instances.getHead(), storageSize = instances.getStorageSize();
+  if (async.uploadedGeneration != snapshot.generation) {
+    auto upload = [&](size_t first, size_t count) {
+      if (count == 0) return;
+      instanceBO.updateData(first * sizeof(ConstrainedDividerLine), count * sizeof(ConstrainedDividerLine), instances.getStorage() + first);
+      renderStats.uploadedBytes += count * sizeof(ConstrainedDividerLine);
+    };
+    // Everything, unless the changes since the last upload are all still listed
+    size_t from = head;
+    const auto& changes = snapshot.instanceChanges;
+    if (async.uploadedGeneration != 0 && !changes.empty() && changes.front().first <= async.uploadedGeneration + 1) {
+      from = storageSize;
+      for (const auto& [generation, changedFrom] : changes) {
+        if (generation > async.uploadedGeneration) from = std::min(from, changedFrom);
+      }
+      from = std::max(from, head);
+      auto& changedLines = async.uploadChanges.changedLines;
+      changedLines.clear();
+      for (const auto& [generation, slot] : snapshot.changedInstances) {
+        if (generation > async.uploadedGeneration && slot >= head && slot < from) changedLines.push_back(slot);
+      }
+      std::sort(changedLines.begin(), changedLines.end());
+      changedLines.erase(std::unique(changedLines.begin(), changedLines.end()), changedLines.end());
+      async.uploadChanges.forEachChangedRun(upload);
+    }
+    upload(from, storageSize - from);
+    async.uploadedGeneration = snapshot.generation;
+    async.acknowledgedGeneration.store(snapshot.generation, std::memory_order_release);
+  }
+  // Drawn from the snapshot's head, as the sync path draws from the store's
+  if (boundInstanceHead != head) {
+    bindInstanceAttributes(vbo, instanceBO, head);
+    boundInstanceHead = head;
+  }
+  drawInstanceBuffer(vbo, static_cast<int>(instances.size()), scale);
+}
@@ -0,0 +1,70 @@
+#include "DividedAreaGroup.hpp"
+#include "ofGraphics.h"
+#include <algorithm>
+
+void DividedAreaGroup::add(DividedArea& dividedArea, glm::vec2 offset, float scale) {
+  cells.push_back(&dividedArea);
+  cellTransforms.push_back(BatchedLineRenderer::Cell { &dividedArea, offset, scale });
+  cellsBatched.push_back(false);
+}
+
+void DividedAreaGroup::clear() {
+  cells.clear();
+  cellTransforms.clear();
+  cellsBatched.clear();
+}
+
+const std::vector<DividedAreaGroup::CellResult>& DividedAreaGroup::update(const std::vector<CellInput>& inputs) {
+  // Sample the frame time here: ofGetLastFrameTime belongs to the main thread
+  return update(inputs, DividedArea::getFrameDeltaTime());
+}
+
+const std::vector<DividedAreaGroup::CellResult>& DividedAreaGroup::update(const std::vector<CellInput>& inputs, float dt) {
+  size_t cellCount = std::min(inputs.size(), cells.size());
+  results.assign(cells.size(), CellResult {});
+
+  pool.parallelFor(cellCount, [&](size_t i) {
+    DividedArea& cell = *cells[i];
+    const CellInput& input = inputs[i];
+    CellResult& result = results[i];
+
+    if (input.updateMajorLines) {
+      result.majorLinesChanged = cell.updateUnconstrainedDividerLines(input.majorRefPoints, dt);
+    }
+    for (const auto& request : input.constrainedLines) {
+      if (cell.addConstrainedDividerLine(request)) ++result.constrainedLinesAdded;
+    }
+  });
+
+  return results;
+}
+
+void DividedAreaGroup::drawInstanced(float scale) {
+  batch.clear();
+  for (size_t i = 0; i < cells.size(); ++i) {
+    bool batched = BatchedLineRenderer::canBatch(*cells[i]) && batch.size() < BatchedLineRenderer::MAX_CELLS;
+    // Its own instance buffer has missed everything uploaded to the batch's
+    if (cellsBatched[i] && !batched) cells[i]->resetInstanceChanges();
+    cellsBatched[i] = batched;
+    if (batched) batch.push_back(cellTransforms[i]);
+  }
+  batchedLineRenderer.update(batch);
+
+  // Keep the order cells were added in: each run of batched cells is one
+  // draw, flushed before the next cell that draws itself
+  size_t runStart = 0, batchIndex = 0;
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (cellsBatched[i]) {
+      ++batchIndex;
+      continue;
+    }
+    batchedLineRenderer.drawCells(runStart, batchIndex - runStart, scale);
+    runStart = batchIndex;
+    const auto& transform = cellTransforms[i];
+    ofPushMatrix();
+    ofTranslate(transform.offset * scale);
+    cells[i]->drawInstanced(scale * transform.scale);
+    ofPopMatrix();
+  }
+  batchedLineRenderer.drawCells(runStart, batchIndex - runStart, scale);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "ofxDividedArea.h"
+#include "BatchedLineRenderer.hpp"
+#include "WorkStealingPool.hpp"
+
+// Runs the per-frame geometry updates of many independent DividedAreas in
+// parallel. Each cell's major-line update and its constrained-line requests are
+// applied in order by a single task, so every cell ends up exactly as it would
+// after the same calls made serially. Cells share no state, so the work scales
+// with the number of cores.
+//
+// Only CPU geometry runs on the pool: GPU uploads happen later, on the render
+// thread, where drawInstanced draws every cell it can in one instanced draw
+// (see BatchedLineRenderer).
+//
+// Cells are not owned and must outlive the group.
+class DividedAreaGroup {
+public:
+  struct CellInput {
+    bool updateMajorLines = false; // call updateUnconstrainedDividerLines with majorRefPoints
+    std::vector<glm::vec2> majorRefPoints;
+    std::vector<ConstrainedLineRequest> constrainedLines; // applied after the major lines
+  };
+
+  struct CellResult {
+    bool majorLinesChanged = false;
+    size_t constrainedLinesAdded = 0;
+  };
+
+  explicit DividedAreaGroup(size_t threadCount = 0) : pool(threadCount) {}
+
+  // Drawn at offset (in the cell's units, after scaling by scale)
+  void add(DividedArea& dividedArea, glm::vec2 offset = { 0.0f, 0.0f }, float scale = 1.0f);
+  void clear();
+  size_t size() const { return cells.size(); }
+  DividedArea& operator[](size_t i) { return *cells[i]; }
+
+  // inputs[i] is applied to the i-th added cell; cells without an input are
+  // left alone. Results are indexed the same way and valid until the next call.
+  const std::vector<CellResult>& update(const std::vector<CellInput>& inputs);
+  const std::vector<CellResult>& update(const std::vector<CellInput>& inputs, float dt);
+
+  // Render thread only. Cells are drawn in the order they were added; each
+  // run of consecutive batchable cells (see BatchedLineRenderer::canBatch)
+  // shares one draw, and the rest draw themselves.
+  void drawInstanced(float scale = 1.0f);
+  const BatchedLineRenderer& getBatchedLineRenderer() const { return batchedLineRenderer; }
+
+private:
+  WorkStealingPool pool;
+  std::vector<DividedArea*> cells;
+  std::vector<BatchedLineRenderer::Cell> cellTransforms; // parallel to cells
+  std::vector<bool> cellsBatched; // by the last drawInstanced
+  std::vector<CellResult> results;
+  BatchedLineRenderer batchedLineRenderer;
+  std::vector<BatchedLineRenderer::Cell> batch;
+};
@@ -21,9 +21,12 @@ float DividerLine::pointToLineDistance(glm::vec2 point, const DividerLine& line)
 // Occluded IF spans are close in perpendicular direction AND directions similar AND spans overlap along tangent
 bool DividerLine::isOccludedBy(const DividerLine& dividerLine, float distanceTolerance, float gradientTolerance) const {
   if (&dividerLine == this) return false;
+  return isOccludedBy(dividerLine.start, dividerLine.end, distanceTolerance, gradientTolerance);
+}
 
+bool DividerLine::isOccludedBy(glm::vec2 otherStart, glm::vec2 otherEnd, float distanceTolerance, float gradientTolerance) const {
   glm::vec2 d1 = end - start;
-  glm::vec2 d2 = dividerLine.end - dividerLine.start;
+  glm::vec2 d2 = otherEnd - otherStart;
   auto n1 = safeNormalize(d1);
   auto n2 = safeNormalize(d2);
   if (n1.length < EPS || n2.length < EPS) return false;
@@ -35,10 +38,10 @@ bool DividerLine::isOccludedBy(const DividerLine& dividerLine, float distanceTol
   glm::vec2 n = glm::vec2(-n1.unit.y, n1.unit.x);
 
   // Compute perpendicular distances of all endpoints to the other's supporting line; require small on both ends (both spans near)
-  float dA0 = std::fabs(cross2(d2, start - dividerLine.start)) / n2.length;
-  float dA1 = std::fabs(cross2(d2, end   - dividerLine.start)) / n2.length;
-  float dB0 = std::fabs(cross2(d1, dividerLine.start - start)) / n1.length;
-  float dB1 = std::fabs(cross2(d1, dividerLine.end   - start)) / n1.length;
+  float dA0 = std::fabs(cross2(d2, start - otherStart)) / n2.length;
+  float dA1 = std::fabs(cross2(d2, end   - otherStart)) / n2.length;
+  float dB0 = std::fabs(cross2(d1, otherStart - start)) / n1.length;
+  float dB1 = std::fabs(cross2(d1, otherEnd   - start)) / n1.length;
 
   if (!((dA0 < distanceTolerance && dA1 < distanceTolerance) ||
         (dB0 < distanceTolerance && dB1 < distanceTolerance))) {
@@ -54,8 +57,8 @@ bool DividerLine::isOccludedBy(const DividerLine& dividerLine, float distanceTol
 
   auto [a0, a1] = projRange(start, end, start, n1.unit); // self range along own tangent
   // project other span into same frame
-  float b0 = glm::dot(dividerLine.start - start, n1.unit);
-  float b1 = glm::dot(dividerLine.end   - start, n1.unit);
+  float b0 = glm::dot(otherStart - start, n1.unit);
+  float b1 = glm::dot(otherEnd   - start, n1.unit);
 
   if (!rangesOverlap(a0, a1, b0, b1, distanceTolerance)) {
     return false;
@@ -77,7 +80,8 @@ bool DividerLine::isOccludedByAnyOf(const Container& dividerLines, float distanc
   return std::any_of(dividerLines.cbegin(),
                      dividerLines.cend(),
                      [&](const auto& dl) {
-    return (isOccludedBy(dl, distanceTolerance, gradientTolerance));
+    if (static_cast<const void*>(&dl) == this) return false;
+    return (isOccludedBy(dl.start, dl.end, distanceTolerance, gradientTolerance));
   });
 }
 
@@ -98,15 +102,18 @@ static inline uint32_t hashVec2(const glm::vec2& v) {
   return h;
 }
 
+// Order-independent pair hash for randomised but stable choice of shrinkTowards point
+glm::vec2 DividerLine::getShrinkTowardsPoint(glm::vec2 ref1, glm::vec2 ref2) {
+  uint32_t h1 = hashVec2(ref1), h2 = hashVec2(ref2);
+  uint32_t pairHash = (h1 < h2) ? (h1 * 0x85ebca6bu ^ h2) : (h2 * 0x85ebca6bu ^ h1);
+  return (pairHash & 1u) ? ref1 : ref2;
+}
+
 // Shrink the startLine towards a reference point to fit inside the constraints
 Line DividerLine::findEnclosedLine(glm::vec2 ref1, glm::vec2 ref2, const DividerLines& constraints, const Line& startLine) {
   glm::vec2 start = startLine.start, end = startLine.end;
 
-  // Order-independent pair hash for randomised but stable choice of shrinkTowards point
-  uint32_t h1 = hashVec2(ref1), h2 = hashVec2(ref2);
-  uint32_t pairHash = (h1 < h2) ? (h1 * 0x85ebca6bu ^ h2) : (h2 * 0x85ebca6bu ^ h1);
-
-  const glm::vec2& shrinkTowards = (pairHash & 1u) ? ref1 : ref2;
+  const glm::vec2 shrinkTowards = getShrinkTowardsPoint(ref1, ref2);
 
   for (const auto& constraint : constraints) {
     if ((ref1 == constraint.ref1 && ref2 == constraint.ref2) || (ref2 == constraint.ref1 && ref1 == constraint.ref2)) {
@@ -125,11 +132,7 @@ template<typename Container>
 Line DividerLine::findEnclosedLineIn(glm::vec2 ref1, glm::vec2 ref2, const Container& constraints, const Line& startLine) {
   glm::vec2 start = startLine.start, end = startLine.end;
 
-  // Order-independent pair hash for randomised but stable choice of shrinkTowards point
-  uint32_t h1 = hashVec2(ref1), h2 = hashVec2(ref2);
-  uint32_t pairHash = (h1 < h2) ? (h1 * 0x85ebca6bu ^ h2) : (h2 * 0x85ebca6bu ^ h1);
-
-  const glm::vec2& shrinkTowards = (pairHash & 1u) ? ref1 : ref2;
+  const glm::vec2 shrinkTowards = getShrinkTowardsPoint(ref1, ref2);
 
   for (const auto& constraint : constraints) {
     if ((ref1 == constraint.ref1 && ref2 == constraint.ref2) || (ref2 == constraint.ref1 && ref1 == constraint.ref2)) {
@@ -202,3 +205,7 @@ template bool DividerLine::isRefPointUsed<glm::vec4>(const DividerLines& divider
 // Explicit instantiations for SmoothedDividerLine containers
 template bool DividerLine::isOccludedByAnyOf<std::vector<SmoothedDividerLine>>(const std::vector<SmoothedDividerLine>& dividerLines, float distanceTolerance, float gradientTolerance) const;
 template Line DividerLine::findEnclosedLineIn<std::vector<SmoothedDividerLine>>(glm::vec2 ref1, glm::vec2 ref2, const std::vector<SmoothedDividerLine>& constraints, const Line& startLine);
+
+// ...and for the constrained lines DividedArea stores
+template bool DividerLine::isOccludedByAnyOf<ConstrainedLineStore>(const ConstrainedLineStore& dividerLines, float distanceTolerance, float gradientTolerance) const;
+template Line DividerLine::findEnclosedLineIn<ConstrainedLineStore>(glm::vec2 ref1, glm::vec2 ref2, const ConstrainedLineStore& constraints, const Line& startLine);
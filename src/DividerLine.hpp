@@ -4,6 +4,7 @@
 #include <vector>
 #include "ofColor.h"
 #include "ofVboMesh.h"
+#include "HeadOffsetVector.h"
 
 // Notes:
 // - pointToLineDistance: For zero-length lines (start≈end), returns distance to start point.
@@ -45,6 +46,9 @@ public:
   mutable ofVboMesh mesh;
 
   static Line findEnclosedLine(glm::vec2 ref1, glm::vec2 ref2, const DividerLines& constraints, const Line& startLine = longestLine);
+  // The ref point findEnclosedLine shrinks towards: the enclosed line is the
+  // span through it between the nearest constraints on either side
+  static glm::vec2 getShrinkTowardsPoint(glm::vec2 ref1, glm::vec2 ref2);
   
   // Templated version for containers of DividerLine subclasses (e.g., SmoothedDividerLine)
   template<typename Container>
@@ -54,6 +58,7 @@ public:
   void draw(float width) const;
   void draw(const LineConfig& config) const;
   bool isOccludedBy(const DividerLine& dividerLine, float distanceTolerance, float gradientTolerance) const;
+  bool isOccludedBy(glm::vec2 otherStart, glm::vec2 otherEnd, float distanceTolerance, float gradientTolerance) const;
   bool isOccludedByAny(const DividerLines& dividerLines, float distanceTolerance, float gradientTolerance) const; // gradients close when dot product > gradientTolerance (dot product == 1 when codirectional)
   
   // Templated version for containers of DividerLine subclasses (e.g., SmoothedDividerLine)
@@ -66,3 +71,20 @@ public:
 //private:
   static float pointToLineDistance(glm::vec2 point, const DividerLine& line);
 };
+
+// A constrained line as DividedArea stores it, once: its span, how it's drawn
+// and the ref points it was made from. Laid out to upload as is for instanced
+// drawing, with start/end read as the shader's p0/p1 and the ref points
+// skipped over by the stride.
+struct ConstrainedDividerLine {
+  glm::vec2 start, end;
+  float width;
+  float style; // 1 for a tapered line, otherwise 0
+  ofFloatColor color;
+  glm::vec2 ref1, ref2;
+
+  DividerLine toDividerLine() const { return DividerLine { ref1, ref2, start, end }; }
+};
+using ConstrainedDividerLines = std::vector<ConstrainedDividerLine>;
+// How DividedArea keeps them, so evicting the oldest moves no other line
+using ConstrainedLineStore = HeadOffsetVector<ConstrainedDividerLine>;
@@ -8,30 +8,72 @@
 #pragma once
 
 #include "Shader.h"
+#include "DividerLineShape.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 class DividerLineShader : public Shader {
 
 public:
-  void begin(float maxTaperLength, float minWidthFactorStart, float maxWidthFactorStart, float minWidthFactorEnd, float maxWidthFactorEnd, float edgeFadeWidth, float edgeWidthFactor, float centerWidthFactor, float extendBeyondCanvas, float lineLengthMinFactor, float linePositionFadeWidth, float linePositionEdgeFactor, float linePositionCenterFactor) {
+  // The uniform block binding point for DividerLineShapeBlock
+  static constexpr GLuint SHAPE_BLOCK_BINDING = 0;
+
+  void load() {
+    Shader::load();
+    shader.bindUniformBlock(SHAPE_BLOCK_BINDING, "DividerLineShapeBlock");
+  }
+
+  // shapeBuffer as from acquireShapeBuffer
+  void begin(const ofBufferObject& shapeBuffer) {
     Shader::begin();
-    shader.setUniform1f("maxTaperLength", maxTaperLength);
-    shader.setUniform1f("minWidthFactorStart", minWidthFactorStart);
-    shader.setUniform1f("maxWidthFactorStart", maxWidthFactorStart);
-    shader.setUniform1f("minWidthFactorEnd", minWidthFactorEnd);
-    shader.setUniform1f("maxWidthFactorEnd", maxWidthFactorEnd);
-    shader.setUniform1f("edgeFadeWidth", edgeFadeWidth);
-    shader.setUniform1f("edgeWidthFactor", edgeWidthFactor);
-    shader.setUniform1f("centerWidthFactor", centerWidthFactor);
-    shader.setUniform1f("extendBeyondCanvas", extendBeyondCanvas);
-    shader.setUniform1f("lineLengthMinFactor", lineLengthMinFactor);
-    shader.setUniform1f("linePositionFadeWidth", linePositionFadeWidth);
-    shader.setUniform1f("linePositionEdgeFactor", linePositionEdgeFactor);
-    shader.setUniform1f("linePositionCenterFactor", linePositionCenterFactor);
+    shapeBuffer.bindBase(GL_UNIFORM_BUFFER, SHAPE_BLOCK_BINDING);
+  }
+
+  // A uniform buffer holding shape, shared with every other holder of an
+  // identical shape for as long as any of them keeps it. GL thread only.
+  static std::shared_ptr<ofBufferObject> acquireShapeBuffer(const DividerLineShape& shape) {
+    static std::vector<std::pair<DividerLineShape, std::weak_ptr<ofBufferObject>>> shapeBuffers;
+    shapeBuffers.erase(std::remove_if(shapeBuffers.begin(), shapeBuffers.end(), [](const auto& entry) {
+      return entry.second.expired();
+    }), shapeBuffers.end());
+    for (const auto& entry : shapeBuffers) {
+      if (entry.first == shape) return entry.second.lock();
+    }
+    // std140 rounds the block up to a multiple of a vec4
+    struct { DividerLineShape shape; float padding[3]; } block { shape, {} };
+    auto buffer = std::make_shared<ofBufferObject>();
+    buffer->allocate(sizeof(block), &block, GL_STATIC_DRAW);
+    shapeBuffers.emplace_back(shape, buffer);
+    return buffer;
   }
 
 protected:
+  // Where the vertex shader reads the shape settings from, by their
+  // DividerLineShape names, and CELL_POSITION, which places the line. GLSL()
+  // can't hold preprocessor lines, so these go in as a plain string.
+  virtual std::string getShapeDeclarations() {
+    return "layout(std140) uniform DividerLineShapeBlock {\n"
+           "  float maxTaperLength;\n" // vary widths over this normalised length (e.g. 0.5)
+           "  float minWidthFactorStart;\n" // when tapering, minimum width factor at start of taper, e.g. 0.6
+           "  float maxWidthFactorStart;\n" // when tapering, maximum width factor at start of taper, e.g. 1.0
+           "  float minWidthFactorEnd;\n" // when tapering, minimum width factor at end, e.g. 0.4
+           "  float maxWidthFactorEnd;\n" // when tapering, maximum width factor at end, e.g. 0.9
+           "  float edgeFadeWidth;\n" // 0 = disabled; >0 = per-endpoint width is interpolated within this normalised distance of any screen edge
+           "  float edgeWidthFactor;\n" // width factor AT the edge (within the fade band). 0 = vanish, 1 = neutral, >1 = bulge.
+           "  float centerWidthFactor;\n" // width factor FAR from edges (outside the band). 1 = full width (default), 0 = invisible in middle, >1 = bulge in middle.
+           "  float extendBeyondCanvas;\n" // extend each line's drawn geometry past instP0/instP1 by this distance in normalised units along the line direction.
+           "  float lineLengthMinFactor;\n" // 1 = disabled; <1 = short lines thinner (multiplier at len=0, approaches 1 at len>=maxTaperLength).
+           "  float linePositionFadeWidth;\n" // 0 = disabled; >0 = band width (normalised) from canvas edges within which midpoint-based width modulation applies.
+           "  float linePositionEdgeFactor;\n" // width factor for lines whose MIDPOINT sits at a canvas edge. 1 = neutral.
+           "  float linePositionCenterFactor;\n" // width factor for lines whose MIDPOINT sits far from any canvas edge (toward centre). 1 = neutral.
+           "};\n"
+           "#define CELL_POSITION(p) (p)\n";
+  }
+
+  // shapeDividerLine (DividerLineShape.h) does the same on the CPU; keep the two in step
   std::string getVertexShader() override {
-    return GLSL(
+    std::string source = GLSL(
                 layout(location = 0) in vec3 inPos;
                 layout(location = 1) in vec2 instP0;
                 layout(location = 2) in vec2 instP1;
@@ -40,19 +82,6 @@ protected:
                 layout(location = 5) in vec4 instColor;
 
                 uniform mat4 modelViewProjectionMatrix;
-                uniform float maxTaperLength; // vary widths over this normalised length (e.g. 0.5)
-                uniform float minWidthFactorStart; // when tapering, minimum width factor at start of taper, e.g. 0.6
-                uniform float maxWidthFactorStart; // when tapering, maximum width factor at start of taper, e.g. 1.0
-                uniform float minWidthFactorEnd; // when tapering, minimum width factor at end, e.g. 0.4
-                uniform float maxWidthFactorEnd; // when tapering, maximum width factor at end, e.g. 0.9
-                uniform float edgeFadeWidth; // 0 = disabled; >0 = per-endpoint width is interpolated within this normalised distance of any screen edge
-                uniform float edgeWidthFactor; // width factor AT the edge (within the fade band). 0 = vanish, 1 = neutral, >1 = bulge.
-                uniform float centerWidthFactor; // width factor FAR from edges (outside the band). 1 = full width (default), 0 = invisible in middle, >1 = bulge in middle.
-                uniform float extendBeyondCanvas; // extend each line's drawn geometry past instP0/instP1 by this distance in normalised units along the line direction.
-                uniform float lineLengthMinFactor; // 1 = disabled; <1 = short lines thinner (multiplier at len=0, approaches 1 at len>=maxTaperLength).
-                uniform float linePositionFadeWidth; // 0 = disabled; >0 = band width (normalised) from canvas edges within which midpoint-based width modulation applies.
-                uniform float linePositionEdgeFactor; // width factor for lines whose MIDPOINT sits at a canvas edge. 1 = neutral.
-                uniform float linePositionCenterFactor; // width factor for lines whose MIDPOINT sits far from any canvas edge (toward centre). 1 = neutral.
 
                 out vec2 vUv;
                 out vec4 vColor;
@@ -152,9 +181,11 @@ protected:
                   float side = inPos.x; // -0.5..0.5
                   vec2 offset = n * side * (2.0 * halfW);
                   vec2 worldPos = base + offset;
-                  gl_Position = modelViewProjectionMatrix * vec4(worldPos, 0.0, 1.0);
+                  gl_Position = modelViewProjectionMatrix * vec4(CELL_POSITION(worldPos), 0.0, 1.0);
                 }
                 );
+    // After the #version line GLSL() starts with
+    return source.insert(source.find('\n') + 1, getShapeDeclarations());
   }
   
   std::string getFragmentShader() override {
@@ -170,3 +201,56 @@ protected:
   }
 
 };
+
+// The same lines from many DividedAreas in one instanced draw (see
+// BatchedLineRenderer). Each instance's cell index, at attribute location 6,
+// picks its area's shape and its transform from DividerLineCellBlock, an
+// array of BatchedDividerLineCell.
+struct BatchedDividerLineCell {
+  DividerLineShape shape;
+  float scale = 1.0f; // then offset is added, in the same units as the lines
+  glm::vec2 offset { 0.0f, 0.0f };
+};
+static_assert(sizeof(BatchedDividerLineCell) == 64, "BatchedDividerLineCell must match the std140 DividerLineCell");
+
+class BatchedDividerLineShader : public DividerLineShader {
+
+public:
+  static constexpr GLuint CELL_BLOCK_BINDING = 1;
+  // 16KB of cells, the least GL_MAX_UNIFORM_BLOCK_SIZE allowed
+  static constexpr int MAX_CELLS = 256;
+
+  void load() {
+    Shader::load();
+    shader.bindUniformBlock(CELL_BLOCK_BINDING, "DividerLineCellBlock");
+  }
+
+  // cellBuffer holds a BatchedDividerLineCell per cell
+  void begin(const ofBufferObject& cellBuffer) {
+    Shader::begin();
+    cellBuffer.bindBase(GL_UNIFORM_BUFFER, CELL_BLOCK_BINDING);
+  }
+
+protected:
+  // Each shape setting becomes a macro reading it from the instance's cell
+  std::string getShapeDeclarations() override {
+    static const char* shapeNames[] = {
+      "maxTaperLength", "minWidthFactorStart", "maxWidthFactorStart", "minWidthFactorEnd", "maxWidthFactorEnd",
+      "edgeFadeWidth", "edgeWidthFactor", "centerWidthFactor", "extendBeyondCanvas", "lineLengthMinFactor",
+      "linePositionFadeWidth", "linePositionEdgeFactor", "linePositionCenterFactor"
+    };
+    std::string fields, macros;
+    for (const char* name : shapeNames) {
+      fields += std::string("  float ") + name + ";\n";
+      macros += std::string("#define ") + name + " CELL." + name + "\n";
+    }
+    return "layout(location = 6) in float instCell;\n"
+           "struct DividerLineCell {\n" + fields + "  float cellScale;\n  vec2 cellOffset;\n};\n"
+           "layout(std140) uniform DividerLineCellBlock {\n"
+           "  DividerLineCell cells[" + std::to_string(MAX_CELLS) + "];\n"
+           "};\n"
+           "#define CELL cells[int(instCell)]\n" + macros +
+           "#define CELL_POSITION(p) ((p) * CELL.cellScale + CELL.cellOffset)\n";
+  }
+
+};
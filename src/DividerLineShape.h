@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "glm/vec2.hpp"
+#include "glm/geometric.hpp"
+
+// The settings that shape every instanced constrained line, as
+// DividerLineShader takes them in its DividerLineShapeBlock uniform block. See
+// the DividedArea parameters of the same names for what each does; the
+// defaults here match theirs. Scalar floats pack at 4-byte offsets under
+// std140 too, so the struct can be uploaded as is.
+struct DividerLineShape {
+  float maxTaperLength = 0.5f;
+  float minWidthFactorStart = 0.6f;
+  float maxWidthFactorStart = 1.0f;
+  float minWidthFactorEnd = 0.4f;
+  float maxWidthFactorEnd = 0.9f;
+  float edgeFadeWidth = 0.0f;
+  float edgeWidthFactor = 0.0f;
+  float centerWidthFactor = 1.0f;
+  float extendBeyondCanvas = 0.0f;
+  float lineLengthMinFactor = 1.0f;
+  float linePositionFadeWidth = 0.0f;
+  float linePositionEdgeFactor = 1.0f;
+  float linePositionCenterFactor = 1.0f;
+
+  // Bitwise, as it decides whether two areas can share one uniform buffer
+  bool operator==(const DividerLineShape& other) const { return std::memcmp(this, &other, sizeof(*this)) == 0; }
+  bool operator!=(const DividerLineShape& other) const { return !(*this == other); }
+};
+static_assert(sizeof(DividerLineShape) == 13 * sizeof(float), "DividerLineShape must match the std140 DividerLineShapeBlock");
+
+// What DividerLineShader draws for one instance: a quad from start to end,
+// its width going linearly from startWidth to endWidth
+struct DividerLineQuad {
+  glm::vec2 start, end;
+  float startWidth, endWidth;
+};
+
+namespace dividerlineshape {
+
+inline float mix(float a, float b, float t) { return a + (b - a) * t; }
+
+inline float smoothstep(float edge0, float edge1, float x) {
+  float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+inline float edgeDistance(glm::vec2 p) {
+  return std::min(std::min(p.x, 1.0f - p.x), std::min(p.y, 1.0f - p.y));
+}
+
+}
+
+// The CPU twin of DividerLineShader's vertex shader; keep the two in step.
+// Positions are in the area's normalised units, as the instances are.
+inline DividerLineQuad shapeDividerLine(const DividerLineShape& shape, glm::vec2 p0, glm::vec2 p1, float width, float style) {
+  using namespace dividerlineshape;
+  glm::vec2 dir = p1 - p0;
+  float len = std::max(glm::length(dir), 1e-6f);
+  glm::vec2 t = dir / len;
+
+  float startWidth = width, endWidth = width;
+  if (style > 0.5f) {
+    float widthFactor = std::clamp(len, 0.0f, shape.maxTaperLength) / shape.maxTaperLength;
+    startWidth = width * mix(shape.minWidthFactorStart, shape.maxWidthFactorStart, widthFactor);
+    endWidth = width * mix(shape.minWidthFactorEnd, shape.maxWidthFactorEnd, widthFactor);
+  }
+
+  if (shape.edgeFadeWidth > 0.0001f) {
+    startWidth *= mix(shape.edgeWidthFactor, shape.centerWidthFactor, smoothstep(0.0f, shape.edgeFadeWidth, edgeDistance(p0)));
+    endWidth *= mix(shape.edgeWidthFactor, shape.centerWidthFactor, smoothstep(0.0f, shape.edgeFadeWidth, edgeDistance(p1)));
+  }
+
+  float lengthFactor = 1.0f;
+  if (shape.lineLengthMinFactor < 0.9999f || shape.lineLengthMinFactor > 1.0001f) {
+    lengthFactor = mix(shape.lineLengthMinFactor, 1.0f, std::clamp(len, 0.0f, shape.maxTaperLength) / shape.maxTaperLength);
+  }
+
+  float positionFactor = 1.0f;
+  if (shape.linePositionFadeWidth > 0.0001f) {
+    float midDist = edgeDistance((p0 + p1) * 0.5f);
+    positionFactor = mix(shape.linePositionEdgeFactor, shape.linePositionCenterFactor, smoothstep(0.0f, shape.linePositionFadeWidth, midDist));
+  }
+  startWidth *= lengthFactor * positionFactor;
+  endWidth *= lengthFactor * positionFactor;
+
+  // Only ends on a canvas edge are extended (see the shader for why)
+  glm::vec2 start = p0, end = p1;
+  if (shape.extendBeyondCanvas > 0.0001f) {
+    if (edgeDistance(p0) < 0.001f) start = p0 - t * shape.extendBeyondCanvas;
+    if (edgeDistance(p1) < 0.001f) end = p1 + t * shape.extendBeyondCanvas;
+  }
+  return DividerLineQuad { start, end, startWidth, endWidth };
+}
+
+// The most shapeDividerLine can multiply a line's width by, for bounding
+// what it draws
+inline float maxDividerLineWidthFactor(const DividerLineShape& shape) {
+  return std::max({ 1.0f, shape.maxWidthFactorStart, shape.maxWidthFactorEnd, shape.minWidthFactorStart, shape.minWidthFactorEnd })
+         * std::max({ 1.0f, shape.edgeWidthFactor, shape.centerWidthFactor })
+         * std::max(1.0f, shape.lineLengthMinFactor)
+         * std::max({ 1.0f, shape.linePositionEdgeFactor, shape.linePositionCenterFactor });
+}
@@ -11,6 +11,7 @@
 #include <cmath>
 #include <limits>
 #include <optional>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -64,28 +65,122 @@ namespace geom {
     return !(a1 < b0 - eps || b1 < a0 - eps);
   }
 
+  // Non-owning view over 2D positions stored anywhere in memory: the x,y floats
+  // of element i are read at first + i * stride bytes. Lets callers pass e.g.
+  // the position member of their own structs without copying into a vector.
+  // Works for any float glm vector type, whose x and y are adjacent.
+  class PointView {
+  public:
+    PointView() = default;
+    PointView(const float* first, size_t count, size_t strideBytes = sizeof(glm::vec2))
+    : base(reinterpret_cast<const unsigned char*>(first)), count(count), stride(strideBytes) {}
+
+    template<typename PT, typename A>
+    PointView(const std::vector<PT, A>& points)
+    : PointView(points.empty() ? nullptr : &points[0].x, points.size(), sizeof(PT)) {}
+
+    // e.g. PointView::of(clusters.data(), clusters.size(), &Cluster::centre)
+    template<typename T, typename PT>
+    static PointView of(const T* items, size_t count, PT T::* member) {
+      return PointView(count == 0 ? nullptr : &(items[0].*member).x, count, sizeof(T));
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    glm::vec2 operator[](size_t i) const {
+      const float* p = reinterpret_cast<const float*>(base + i * stride);
+      return { p[0], p[1] };
+    }
+
+  private:
+    const unsigned char* base = nullptr;
+    size_t count = 0;
+    size_t stride = sizeof(glm::vec2);
+  };
+
+  // Amanatides-Woo traversal of the cells of a width x height grid that the
+  // segment a-b (in cell units) passes through, calling fn(x, y) for each in
+  // order. The segment is clipped to the grid first, so lines reaching far
+  // outside it still walk the right cells. fn may return false to stop.
+  template<typename F>
+  void forEachGridCell(glm::vec2 a, glm::vec2 b, int width, int height, F&& fn) {
+    constexpr float NEVER = std::numeric_limits<float>::infinity();
+    auto visit = [&fn](int x, int y) {
+      if constexpr (std::is_same_v<decltype(fn(x, y)), bool>) {
+        return fn(x, y);
+      } else {
+        fn(x, y);
+        return true;
+      }
+    };
+    glm::vec2 d = b - a;
+    glm::vec2 extent { static_cast<float>(width), static_cast<float>(height) };
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int axis = 0; axis < 2; ++axis) {
+      if (d[axis] == 0.0f) {
+        if (a[axis] < 0.0f || a[axis] > extent[axis]) return;
+        continue;
+      }
+      float ta = -a[axis] / d[axis];
+      float tb = (extent[axis] - a[axis]) / d[axis];
+      t0 = std::max(t0, std::min(ta, tb));
+      t1 = std::min(t1, std::max(ta, tb));
+    }
+    if (t0 > t1) return;
+    b = a + t1 * d;
+    a = a + t0 * d;
+    d = b - a;
+
+    int x = std::clamp(static_cast<int>(std::floor(a.x)), 0, width - 1);
+    int y = std::clamp(static_cast<int>(std::floor(a.y)), 0, height - 1);
+    int endX = std::clamp(static_cast<int>(std::floor(b.x)), 0, width - 1);
+    int endY = std::clamp(static_cast<int>(std::floor(b.y)), 0, height - 1);
+    int stepX = (d.x > 0.0f) ? 1 : -1;
+    int stepY = (d.y > 0.0f) ? 1 : -1;
+    float tDeltaX = (d.x != 0.0f) ? std::fabs(1.0f / d.x) : NEVER;
+    float tDeltaY = (d.y != 0.0f) ? std::fabs(1.0f / d.y) : NEVER;
+    float tMaxX = (d.x != 0.0f) ? ((stepX > 0 ? (x + 1) - a.x : a.x - x) * tDeltaX) : NEVER;
+    float tMaxY = (d.y != 0.0f) ? ((stepY > 0 ? (y + 1) - a.y : a.y - y) * tDeltaY) : NEVER;
+
+    // Bounded by the cells between the ends, in case rounding skips past the last one
+    int remaining = std::abs(endX - x) + std::abs(endY - y);
+    if (!visit(x, y)) return;
+    while (remaining-- > 0) {
+      if (tMaxX < tMaxY) {
+        x += stepX;
+        tMaxX += tDeltaX;
+      } else {
+        y += stepY;
+        tMaxY += tDeltaY;
+      }
+      if (x < 0 || x >= width || y < 0 || y >= height) break;
+      if (!visit(x, y)) return;
+    }
+  }
+
+  inline bool containsPoint(const PointView& points, glm::vec2 point) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (points[i] == point) return true;
+    }
+    return false;
+  }
+
+  inline std::optional<glm::vec2> findClosePoint(const PointView& points, glm::vec2 point, float tolerance) {
+    float tolerance2 = tolerance * tolerance;
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (glm::distance2(points[i], point) < tolerance2) return points[i];
+    }
+    return std::nullopt;
+  }
+
   template<typename PT, typename A>
   bool containsPoint(const std::vector<PT, A>& points, glm::vec2 point) {
-    return std::any_of(points.begin(),
-                       points.end(),
-                       [&](const auto& p) {
-      return (glm::vec2(p) == point);
-    });
+    return containsPoint(PointView(points), point);
   }
 
   template<typename PT, typename A>
   std::optional<glm::vec2> findClosePoint(const std::vector<PT, A>& points, glm::vec2 point, float tolerance) {
-    float tolerance2 = tolerance * tolerance;
-    auto iter = std::find_if(points.begin(),
-                             points.end(),
-                             [&](const auto& p) {
-      return glm::distance2(glm::vec2(p), point) < tolerance2;
-    });
-    if (iter != points.end()) {
-      return *iter;
-    } else {
-      return std::nullopt;
-    }
+    return findClosePoint(PointView(points), point, tolerance);
   }
 
 }
@@ -0,0 +1,241 @@
+#include "GeometryTimeline.hpp"
+#include "ofxDividedArea.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace geometrytimeline;
+
+bool GeometryTimelineRecorder::open(const std::string& path, glm::vec2 areaSize, int newKeyframeInterval) {
+  close();
+  file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+  keyframeInterval = std::max(1, newKeyframeInterval);
+  frame = 0;
+  time = 0.0f;
+  previousLines.clear();
+  previousSerials.clear();
+  closing = false;
+
+  FileHeader header;
+  std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+  header.lineSize = sizeof(ConstrainedDividerLine);
+  header.keyframeInterval = static_cast<uint32_t>(keyframeInterval);
+  header.areaSize = areaSize;
+  chunk.clear();
+  chunk.reserve(CHUNK_BYTES);
+  append(header);
+  writer = std::thread([this] { writeChunks(); });
+  return true;
+}
+
+void GeometryTimelineRecorder::close() {
+  if (!file) return;
+  flushChunk();
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    closing = true;
+  }
+  chunkCondition.notify_one();
+  writer.join();
+  std::fclose(file);
+  file = nullptr;
+}
+
+template<typename T>
+void GeometryTimelineRecorder::append(const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  chunk.insert(chunk.end(), bytes, bytes + sizeof(T));
+}
+
+// Hands the chunk to the writer and carries on in a spare one
+void GeometryTimelineRecorder::flushChunk() {
+  if (chunk.empty()) return;
+  std::vector<uint8_t> next;
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex);
+    fullChunks.push_back(std::move(chunk));
+    if (!spareChunks.empty()) {
+      next = std::move(spareChunks.back());
+      spareChunks.pop_back();
+    }
+  }
+  chunkCondition.notify_one();
+  next.clear();
+  next.reserve(CHUNK_BYTES);
+  chunk = std::move(next);
+}
+
+void GeometryTimelineRecorder::writeChunks() {
+  std::unique_lock<std::mutex> lock(chunkMutex);
+  while (true) {
+    chunkCondition.wait(lock, [this] { return closing || !fullChunks.empty(); });
+    if (fullChunks.empty()) return; // closing, and everything is written
+    std::vector<uint8_t> written = std::move(fullChunks.front());
+    fullChunks.pop_front();
+    lock.unlock();
+    std::fwrite(written.data(), 1, written.size(), file);
+    lock.lock();
+    spareChunks.push_back(std::move(written));
+  }
+}
+
+void GeometryTimelineRecorder::recordFrame(const DividedArea& area) {
+  recordFrame(area, DividedArea::getFrameDeltaTime());
+}
+
+// Lines keep their serials, and evicting one either drops it from the front
+// or moves the front line into its place; so the ring is the old one less a
+// run from its front (up to where the new front line was), with lines changed
+// in place, and new ones after
+void GeometryTimelineRecorder::recordFrame(const DividedArea& area, float dt) {
+  if (!file) return;
+  const ConstrainedLineStore& lines = area.constrainedDividerLines;
+  const HeadOffsetVector<uint64_t>& serials = area.getConstrainedLineSerials();
+  bool keyframe = (frame % keyframeInterval == 0);
+
+  FrameHeader header {};
+  header.magic = FRAME_MAGIC;
+  header.flags = keyframe ? KEYFRAME : 0;
+  header.frame = frame;
+  header.time = time;
+  header.majorLineStyle = static_cast<int32_t>(area.getEffectiveMajorLineStyle());
+  changed.clear();
+  size_t firstAdded = 0;
+  if (!keyframe) {
+    size_t evicted = previousSerials.size();
+    if (!serials.empty()) evicted = std::find(previousSerials.begin(), previousSerials.end(), serials[0]) - previousSerials.begin();
+    evicted = std::max(evicted, previousSerials.size() - std::min(previousSerials.size(), serials.size()));
+    header.evictedCount = static_cast<uint32_t>(evicted);
+    firstAdded = previousSerials.size() - evicted;
+    for (size_t j = 0; j < firstAdded; ++j) {
+      if (std::memcmp(&lines[j], &previousLines[evicted + j], sizeof(ConstrainedDividerLine)) != 0) {
+        changed.push_back(ChangedLine { static_cast<uint32_t>(j), lines[j] });
+      }
+    }
+  }
+  header.removedCount = 0; // an eviction moves a line into the gap rather than closing it
+  header.changedCount = static_cast<uint32_t>(changed.size());
+  header.addedCount = static_cast<uint32_t>(lines.size() - firstAdded);
+  header.majorLineCount = static_cast<uint32_t>(area.unconstrainedDividerLines.size());
+  header.payloadBytes = static_cast<uint32_t>(header.changedCount * sizeof(ChangedLine)
+                                              + header.addedCount * sizeof(ConstrainedDividerLine)
+                                              + header.majorLineCount * sizeof(Line));
+
+  append(header);
+  for (const auto& line : changed) append(line);
+  for (size_t i = firstAdded; i < lines.size(); ++i) append(lines[i]);
+  for (const auto& dl : area.unconstrainedDividerLines) append(Line { dl.start, dl.end });
+  if (chunk.size() >= CHUNK_BYTES) flushChunk();
+
+  previousLines.assign(lines.begin(), lines.end());
+  previousSerials.assign(serials.begin(), serials.end());
+  ++frame;
+  time += dt;
+}
+
+bool GeometryTimelinePlayer::open(const std::string& path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+    ::close(fd);
+    return false;
+  }
+  void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) return false;
+  data = static_cast<const uint8_t*>(mapped);
+  dataSize = static_cast<size_t>(info.st_size);
+  madvise(mapped, dataSize, MADV_SEQUENTIAL);
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.lineSize != sizeof(ConstrainedDividerLine)) {
+    close();
+    return false;
+  }
+  areaSize = header.areaSize;
+
+  // Only the headers are read here, to index the keyframes
+  FrameHeader frameHeader;
+  for (size_t offset = sizeof(FileHeader); readFrameHeader(offset, frameHeader); offset += sizeof(FrameHeader) + frameHeader.payloadBytes) {
+    if (frameHeader.flags & KEYFRAME) keyframes.push_back(Keyframe { frameHeader.frame, offset });
+    frameCount = frameHeader.frame + 1;
+  }
+  nextOffset = sizeof(FileHeader);
+  return true;
+}
+
+void GeometryTimelinePlayer::close() {
+  if (data) munmap(const_cast<uint8_t*>(data), dataSize);
+  data = nullptr;
+  dataSize = 0;
+  keyframes.clear();
+  frameCount = 0;
+  frame = 0;
+  time = 0.0f;
+  lines.clear();
+  majorLines.clear();
+}
+
+bool GeometryTimelinePlayer::readFrameHeader(size_t offset, FrameHeader& header) const {
+  if (!data || offset + sizeof(FrameHeader) > dataSize) return false;
+  std::memcpy(&header, data + offset, sizeof(header));
+  return header.magic == FRAME_MAGIC && offset + sizeof(FrameHeader) + header.payloadBytes <= dataSize;
+}
+
+bool GeometryTimelinePlayer::nextFrame() {
+  FrameHeader header;
+  if (!readFrameHeader(nextOffset, header)) return false;
+  const uint8_t* p = data + nextOffset + sizeof(FrameHeader);
+  // Copied out field by field: nothing in the file is aligned
+  auto read = [&p](auto& value) {
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+  };
+
+  if (header.flags & KEYFRAME) lines.clear();
+  lines.erase(lines.begin(), lines.begin() + std::min<size_t>(header.evictedCount, lines.size()));
+  // Ascending indices into the ring as it was, so removed from the back
+  const uint8_t* removedIndices = p;
+  p += header.removedCount * sizeof(uint32_t);
+  for (uint32_t i = header.removedCount; i-- > 0;) {
+    uint32_t index;
+    std::memcpy(&index, removedIndices + i * sizeof(uint32_t), sizeof(index));
+    if (index < lines.size()) lines.erase(lines.begin() + index);
+  }
+  for (uint32_t i = 0; i < header.changedCount; ++i) {
+    ChangedLine changed;
+    read(changed);
+    if (changed.index < lines.size()) lines[changed.index] = changed.line;
+  }
+  size_t firstAdded = lines.size();
+  lines.resize(firstAdded + header.addedCount);
+  std::memcpy(lines.data() + firstAdded, p, header.addedCount * sizeof(ConstrainedDividerLine));
+  p += header.addedCount * sizeof(ConstrainedDividerLine);
+  majorLines.resize(header.majorLineCount);
+  std::memcpy(majorLines.data(), p, header.majorLineCount * sizeof(Line));
+
+  frame = header.frame;
+  time = header.time;
+  majorLineStyle = static_cast<MajorLineStyle>(header.majorLineStyle);
+  nextOffset += sizeof(FrameHeader) + header.payloadBytes;
+  return true;
+}
+
+bool GeometryTimelinePlayer::seek(uint64_t target) {
+  if (target >= frameCount) return false;
+  auto after = std::upper_bound(keyframes.begin(), keyframes.end(), target,
+                                [](uint64_t frame, const Keyframe& keyframe) { return frame < keyframe.frame; });
+  if (after == keyframes.begin()) return false;
+  nextOffset = std::prev(after)->offset;
+  while (nextFrame()) {
+    if (frame == target) return true;
+  }
+  return false;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "DividerLine.hpp"
+#include "MajorLineStyle.h"
+
+class DividedArea;
+
+// A recording of how an area's lines evolved, for re-rendering a performance
+// offline at any resolution: an append-only file of frames, each holding what
+// changed since the one before.
+//
+// The file is a FileHeader followed by frames. Each frame is a FrameHeader and
+// then its payload, in this order:
+//   removedCount uint32 indices into the ring, ascending, after the eviction
+//     (only in older recordings)
+//   changedCount ChangedLine records (lines edited in place, e.g. by reflow,
+//     or moved into an evicted line's place)
+//   addedCount ConstrainedDividerLines, appended to the ring
+//   majorLineCount Lines, replacing the major lines
+// Every keyframeInterval-th frame is a keyframe, holding the whole ring as
+// added lines, so a player can seek without reading from the start. All
+// values are native-endian.
+namespace geometrytimeline {
+
+constexpr char FILE_MAGIC[8] = { 'D', 'I', 'V', 'T', 'L', 'N', '0', '1' };
+constexpr uint32_t FRAME_MAGIC = 0x4D415246; // "FRAM"
+constexpr uint32_t KEYFRAME = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t lineSize; // sizeof(ConstrainedDividerLine), to refuse foreign layouts
+  uint32_t keyframeInterval;
+  glm::vec2 areaSize;
+};
+
+struct FrameHeader {
+  uint32_t magic;
+  uint32_t flags;
+  uint64_t frame;
+  float time; // seconds since the recording started
+  int32_t majorLineStyle;
+  uint32_t evictedCount; // from the front of the ring, first
+  uint32_t removedCount;
+  uint32_t changedCount;
+  uint32_t addedCount;
+  uint32_t majorLineCount;
+  uint32_t payloadBytes;
+};
+
+struct ChangedLine {
+  uint32_t index;
+  ConstrainedDividerLine line;
+};
+
+}
+
+// Appends a frame per recordFrame call. Frames are gathered into chunks in
+// memory and written by a background thread, so recording never waits on
+// the disk.
+//
+//   GeometryTimelineRecorder recorder;
+//   recorder.open("show.divtl");
+//   // each frame, after the area's updates:
+//   recorder.recordFrame(area);
+class GeometryTimelineRecorder {
+public:
+  static constexpr size_t CHUNK_BYTES = 1 << 20;
+
+  ~GeometryTimelineRecorder() { close(); }
+
+  bool open(const std::string& path, glm::vec2 areaSize, int keyframeInterval = 300);
+  // Writes whatever is still buffered, then closes the file
+  void close();
+  bool isOpen() const { return file != nullptr; }
+  uint64_t getFrameCount() const { return frame; }
+
+  // From the thread that updates the area's geometry, after each frame's
+  // updates; not in async geometry mode
+  void recordFrame(const DividedArea& area, float dt);
+  void recordFrame(const DividedArea& area);
+
+private:
+  template<typename T> void append(const T& value);
+  void flushChunk();
+  void writeChunks();
+
+  FILE* file = nullptr;
+  int keyframeInterval = 300;
+  uint64_t frame = 0;
+  float time = 0.0f;
+
+  // The ring as of the last frame, to find what changed
+  ConstrainedDividerLines previousLines;
+  std::vector<uint64_t> previousSerials;
+  std::vector<geometrytimeline::ChangedLine> changed;
+
+  std::vector<uint8_t> chunk;
+  std::mutex chunkMutex;
+  std::condition_variable chunkCondition;
+  std::deque<std::vector<uint8_t>> fullChunks; // waiting for the writer
+  std::vector<std::vector<uint8_t>> spareChunks;
+  bool closing = false;
+  std::thread writer;
+};
+
+// Plays a recording back from a memory-mapped file, rebuilding the ring frame
+// by frame; memory use is the ring and an entry per keyframe, however long
+// the show. Draw getConstrainedLines as DividedArea draws its own (it's in
+// the same upload-ready layout) or through SoftwareLineRasterizer.
+class GeometryTimelinePlayer {
+public:
+  ~GeometryTimelinePlayer() { close(); }
+
+  // False if the file can't be mapped or isn't a recording. A frame cut
+  // short (by a crash, say) ends the recording.
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() const { return data != nullptr; }
+  uint64_t getFrameCount() const { return frameCount; }
+  glm::vec2 getAreaSize() const { return areaSize; }
+
+  // Applies the next frame; false at the end
+  bool nextFrame();
+  // Rebuilds the ring as of frame, from the keyframe at or before it
+  bool seek(uint64_t frame);
+
+  // As of the last frame applied
+  uint64_t getFrame() const { return frame; }
+  float getTime() const { return time; }
+  const ConstrainedDividerLines& getConstrainedLines() const { return lines; }
+  const std::vector<Line>& getMajorLines() const { return majorLines; }
+  MajorLineStyle getMajorLineStyle() const { return majorLineStyle; }
+
+private:
+  struct Keyframe {
+    uint64_t frame;
+    size_t offset;
+  };
+
+  bool readFrameHeader(size_t offset, geometrytimeline::FrameHeader& header) const;
+
+  const uint8_t* data = nullptr;
+  size_t dataSize = 0;
+  glm::vec2 areaSize { 0.0f, 0.0f };
+  std::vector<Keyframe> keyframes;
+  uint64_t frameCount = 0;
+  size_t nextOffset = 0; // of the frame nextFrame applies
+
+  uint64_t frame = 0;
+  float time = 0.0f;
+  ConstrainedDividerLines lines;
+  std::vector<Line> majorLines;
+  MajorLineStyle majorLineStyle = MajorLineStyle::Solid;
+};
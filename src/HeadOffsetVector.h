@@ -0,0 +1,89 @@
+//
+//  HeadOffsetVector.h
+//  ofxDividedArea
+//
+//  A contiguous vector whose oldest elements can be dropped without moving
+//  the rest, for stores that are only ever trimmed from the front.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Elements erased from the front stay in storage ahead of a head offset
+// until there are as many of them as live elements, when the live ones move
+// down in one go; so dropping the oldest costs nothing and compacting is
+// amortized over the drops that led to it. Indices are the live elements';
+// getHead maps them into storage, for mirrors (a GPU buffer) kept in the
+// same layout. Erasing anywhere else shifts what follows, as a vector does.
+template<typename T>
+class HeadOffsetVector {
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  size_t size() const { return storage.size() - head; }
+  bool empty() const { return storage.size() == head; }
+
+  T& operator[](size_t index) { return storage[head + index]; }
+  const T& operator[](size_t index) const { return storage[head + index]; }
+  T& front() { return storage[head]; }
+  const T& front() const { return storage[head]; }
+  T& back() { return storage.back(); }
+  const T& back() const { return storage.back(); }
+  T* data() { return storage.data() + head; }
+  const T* data() const { return storage.data() + head; }
+  iterator begin() { return data(); }
+  iterator end() { return storage.data() + storage.size(); }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return storage.data() + storage.size(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  void push_back(const T& value) { storage.push_back(value); }
+  void push_back(T&& value) { storage.push_back(std::move(value)); }
+  void resize(size_t count) { storage.resize(head + count); }
+  void clear() {
+    storage.clear();
+    head = 0;
+  }
+  // Room for count live elements and as many dropped ones ahead of them, so
+  // trimming and refilling never reallocates
+  void reserve(size_t count) { storage.reserve(2 * count); }
+
+  // True if the live elements were moved down to the start of storage
+  bool eraseFront(size_t count) {
+    head += std::min(count, size());
+    if (head == 0 || head < size()) return false;
+    storage.erase(storage.begin(), storage.begin() + head);
+    head = 0;
+    return true;
+  }
+  void erase(size_t index) {
+    if (index == 0) {
+      eraseFront(1);
+      return;
+    }
+    storage.erase(storage.begin() + head + index);
+  }
+
+  size_t getHead() const { return head; }
+  // Dropped elements included
+  size_t getStorageSize() const { return storage.size(); }
+  T* getStorage() { return storage.data(); }
+  const T* getStorage() const { return storage.data(); }
+  // Takes on another's layout, for a copy kept up to date in place; what's
+  // in storage is left for the caller to fill
+  void resizeStorage(size_t storageSize, size_t newHead) {
+    storage.resize(storageSize);
+    head = std::min(newHead, storageSize);
+  }
+
+private:
+  std::vector<T> storage;
+  size_t head = 0;
+};
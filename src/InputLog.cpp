@@ -0,0 +1,377 @@
+#include "InputLog.hpp"
+#include <chrono>
+#include <cstring>
+#include <typeinfo>
+
+using namespace inputlog;
+
+const char* inputlog::getRecordName(Record record) {
+  switch (record) {
+    case Record::MajorRefPoints: return "updateUnconstrainedDividerLines";
+    case Record::IdentifiedRefPoints: return "updateUnconstrainedDividerLines (ids)";
+    case Record::UnconstrainedDividerLine: return "addUnconstrainedDividerLine";
+    case Record::ConstrainedDividerLine: return "addConstrainedDividerLine";
+    case Record::DeleteEarlyConstrainedDividerLines: return "deleteEarlyConstrainedDividerLines";
+    case Record::EvictConstrainedDividerLine: return "evictConstrainedDividerLine";
+    case Record::ClearConstrainedDividerLines: return "clearConstrainedDividerLines";
+    case Record::FloatParameter: return "float parameter";
+    case Record::IntParameter: return "int parameter";
+    case Record::QualityLevel: return "quality level";
+    case Record::LiveReflow: return "live reflow";
+    case Record::SmoothnessOverride: return "smoothness override";
+    case Record::Checkpoint: return "checkpoint";
+    default: return "unknown";
+  }
+}
+
+uint64_t inputlog::hashLineSet(const DividedArea& area) {
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+  };
+  uint64_t count = area.constrainedDividerLines.size();
+  add(&count, sizeof(count));
+  add(area.constrainedDividerLines.data(), count * sizeof(ConstrainedDividerLine));
+  for (const auto& dl : area.unconstrainedDividerLines) {
+    add(&dl.start, sizeof(dl.start));
+    add(&dl.end, sizeof(dl.end));
+  }
+  return hash;
+}
+
+static std::array<uint8_t, 4> getParameterValue(ofAbstractParameter& parameter, bool isFloat) {
+  std::array<uint8_t, 4> value;
+  if (isFloat) {
+    float v = parameter.cast<float>().get();
+    std::memcpy(value.data(), &v, sizeof(v));
+  } else {
+    int32_t v = parameter.cast<int>().get();
+    std::memcpy(value.data(), &v, sizeof(v));
+  }
+  return value;
+}
+
+bool InputLogRecorder::open(const std::string& path, DividedArea& newArea) {
+  close();
+  if (!newArea.constrainedDividerLines.empty() || !newArea.unconstrainedDividerLines.empty()) return false;
+  file = std::fopen(path.c_str(), "wb");
+  if (!file) return false;
+  area = &newArea;
+  buffer.clear();
+  buffer.reserve(BUFFER_BYTES * 2);
+
+  Header header;
+  std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+  header.areaSize = area->size;
+  header.maxUnconstrainedDividerLines = area->maxUnconstrainedDividerLines;
+  write(header);
+
+  // Everything is logged to start with; the replay's area may differ from
+  // this one in anything set since it was made. The style shaders' groups
+  // don't touch the geometry, so only the area's own values are tracked.
+  parameters.clear();
+  for (auto& parameter : area->getParameterGroup()) {
+    bool isFloat = (parameter->valueType() == typeid(float).name());
+    if (!isFloat && parameter->valueType() != typeid(int).name()) continue;
+    parameters.push_back(TrackedParameter { parameter, isFloat, getParameterValue(*parameter, isFloat) });
+    recordParameter(parameters.back());
+  }
+  qualityLevel = area->getQualityLevel();
+  write(Record::QualityLevel);
+  write(static_cast<int32_t>(qualityLevel));
+  liveReflow = area->isLiveReflow();
+  write(Record::LiveReflow);
+  write(static_cast<uint8_t>(liveReflow));
+  const auto& overrides = area->getParameterOverrides();
+  smoothnessOverridden = overrides.unconstrainedSmoothness.has_value();
+  smoothnessOverride = overrides.unconstrainedSmoothness.value_or(0.0f);
+  write(Record::SmoothnessOverride);
+  write(static_cast<uint8_t>(smoothnessOverridden));
+  write(smoothnessOverride);
+
+  area->setInputRecorder(this);
+  return true;
+}
+
+void InputLogRecorder::close() {
+  if (!file) return;
+  checkpoint();
+  writeBuffer();
+  std::fclose(file);
+  file = nullptr;
+  area->setInputRecorder(nullptr);
+  area = nullptr;
+}
+
+void InputLogRecorder::checkpoint() {
+  if (!file) return;
+  write(Record::Checkpoint);
+  write(hashLineSet(*area));
+}
+
+template<typename T>
+void InputLogRecorder::write(const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void InputLogRecorder::writeBuffer() {
+  if (buffer.empty()) return;
+  std::fwrite(buffer.data(), 1, buffer.size(), file);
+  buffer.clear();
+}
+
+void InputLogRecorder::recordParameter(const TrackedParameter& parameter) {
+  const std::string& name = parameter.parameter->getName();
+  write(parameter.isFloat ? Record::FloatParameter : Record::IntParameter);
+  write(static_cast<uint16_t>(name.size()));
+  buffer.insert(buffer.end(), name.begin(), name.end());
+  write(parameter.value);
+}
+
+// Compared bit for bit, so a replay sees exactly the values this area did
+void InputLogRecorder::recordChangedSettings() {
+  for (auto& parameter : parameters) {
+    auto value = getParameterValue(*parameter.parameter, parameter.isFloat);
+    if (value == parameter.value) continue;
+    parameter.value = value;
+    recordParameter(parameter);
+  }
+  if (area->getQualityLevel() != qualityLevel) {
+    qualityLevel = area->getQualityLevel();
+    write(Record::QualityLevel);
+    write(static_cast<int32_t>(qualityLevel));
+  }
+  if (area->isLiveReflow() != liveReflow) {
+    liveReflow = area->isLiveReflow();
+    write(Record::LiveReflow);
+    write(static_cast<uint8_t>(liveReflow));
+  }
+  const auto& overrides = area->getParameterOverrides();
+  float smoothness = overrides.unconstrainedSmoothness.value_or(0.0f);
+  if (overrides.unconstrainedSmoothness.has_value() != smoothnessOverridden || std::memcmp(&smoothness, &smoothnessOverride, sizeof(float)) != 0) {
+    smoothnessOverridden = overrides.unconstrainedSmoothness.has_value();
+    smoothnessOverride = smoothness;
+    write(Record::SmoothnessOverride);
+    write(static_cast<uint8_t>(smoothnessOverridden));
+    write(smoothnessOverride);
+  }
+}
+
+void InputLogRecorder::beginCall(Record record) {
+  if (buffer.size() >= BUFFER_BYTES) writeBuffer();
+  recordChangedSettings();
+  write(record);
+}
+
+void InputLogRecorder::recordMajorRefPoints(geom::PointView majorRefPoints, float dt) {
+  beginCall(Record::MajorRefPoints);
+  write(dt);
+  write(static_cast<uint32_t>(majorRefPoints.size()));
+  for (size_t i = 0; i < majorRefPoints.size(); ++i) write(majorRefPoints[i]);
+}
+
+void InputLogRecorder::recordIdentifiedRefPoints(const std::vector<IdentifiedRefPoint>& majorRefPoints, float dt) {
+  beginCall(Record::IdentifiedRefPoints);
+  write(dt);
+  write(static_cast<uint32_t>(majorRefPoints.size()));
+  for (const auto& refPoint : majorRefPoints) {
+    write(static_cast<int32_t>(refPoint.id));
+    write(refPoint.position);
+  }
+}
+
+void InputLogRecorder::recordUnconstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2) {
+  beginCall(Record::UnconstrainedDividerLine);
+  write(ref1);
+  write(ref2);
+}
+
+void InputLogRecorder::recordConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2, const ofFloatColor& color, float overriddenWidth, bool taper) {
+  beginCall(Record::ConstrainedDividerLine);
+  write(ref1);
+  write(ref2);
+  write(std::array<float, 4> { color.r, color.g, color.b, color.a });
+  write(overriddenWidth);
+  write(static_cast<uint8_t>(taper));
+}
+
+void InputLogRecorder::recordDeleteEarlyConstrainedDividerLines(size_t count) {
+  beginCall(Record::DeleteEarlyConstrainedDividerLines);
+  write(static_cast<uint64_t>(count));
+}
+
+void InputLogRecorder::recordEvictConstrainedDividerLine(size_t index) {
+  beginCall(Record::EvictConstrainedDividerLine);
+  write(static_cast<uint64_t>(index));
+}
+
+void InputLogRecorder::recordClearConstrainedDividerLines() {
+  beginCall(Record::ClearConstrainedDividerLines);
+}
+
+bool InputLogPlayer::open(const std::string& path) {
+  data.clear();
+  offset = 0;
+  for (auto& callDurations : durations) callDurations.clear();
+  checkpoints = 0;
+  checkpointMismatches = 0;
+
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) return false;
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  if (size > 0) {
+    data.resize(static_cast<size_t>(size));
+    data.resize(std::fread(data.data(), 1, data.size(), file));
+  }
+  std::fclose(file);
+  if (!read(header) || std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0) {
+    data.clear();
+    return false;
+  }
+  return true;
+}
+
+bool InputLogPlayer::readBytes(void* to, size_t count) {
+  if (count > data.size() - offset) return false;
+  std::memcpy(to, data.data() + offset, count);
+  offset += count;
+  return true;
+}
+
+template<typename T>
+bool InputLogPlayer::read(T& value) {
+  return readBytes(&value, sizeof(T));
+}
+
+// Each record is read whole before it's applied, so one cut short isn't half applied
+bool InputLogPlayer::step(DividedArea& area) {
+  using Clock = std::chrono::steady_clock;
+  Record record;
+  if (!read(record)) return false;
+  auto timed = [&](auto&& call) {
+    Clock::time_point start = Clock::now();
+    call();
+    durations[static_cast<size_t>(record)].push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+  };
+  auto fail = [this]() {
+    offset = data.size();
+    return false;
+  };
+
+  switch (record) {
+    case Record::MajorRefPoints: {
+      float dt;
+      uint32_t count;
+      if (!read(dt) || !read(count) || count > (data.size() - offset) / sizeof(glm::vec2)) return fail();
+      points.resize(count);
+      readBytes(points.data(), count * sizeof(glm::vec2));
+      timed([&] { area.updateUnconstrainedDividerLines(points, dt); });
+      return true;
+    }
+    case Record::IdentifiedRefPoints: {
+      float dt;
+      uint32_t count;
+      if (!read(dt) || !read(count) || count > (data.size() - offset) / (sizeof(int32_t) + sizeof(glm::vec2))) return fail();
+      identifiedPoints.resize(count);
+      for (auto& refPoint : identifiedPoints) {
+        int32_t id;
+        read(id);
+        read(refPoint.position);
+        refPoint.id = id;
+      }
+      timed([&] { area.updateUnconstrainedDividerLines(identifiedPoints, dt); });
+      return true;
+    }
+    case Record::UnconstrainedDividerLine: {
+      glm::vec2 ref1, ref2;
+      if (!read(ref1) || !read(ref2)) return fail();
+      timed([&] { area.addUnconstrainedDividerLine(ref1, ref2); });
+      return true;
+    }
+    case Record::ConstrainedDividerLine: {
+      glm::vec2 ref1, ref2;
+      std::array<float, 4> color;
+      float overriddenWidth;
+      uint8_t taper;
+      if (!read(ref1) || !read(ref2) || !read(color) || !read(overriddenWidth) || !read(taper)) return fail();
+      timed([&] { area.addConstrainedDividerLine(ref1, ref2, ofFloatColor(color[0], color[1], color[2], color[3]), overriddenWidth, taper != 0); });
+      return true;
+    }
+    case Record::DeleteEarlyConstrainedDividerLines: {
+      uint64_t count;
+      if (!read(count)) return fail();
+      timed([&] { area.deleteEarlyConstrainedDividerLines(static_cast<size_t>(count)); });
+      return true;
+    }
+    case Record::EvictConstrainedDividerLine: {
+      uint64_t index;
+      if (!read(index)) return fail();
+      timed([&] { area.evictConstrainedDividerLine(static_cast<size_t>(index)); });
+      return true;
+    }
+    case Record::ClearConstrainedDividerLines:
+      timed([&] { area.clearConstrainedDividerLines(); });
+      return true;
+    case Record::FloatParameter:
+    case Record::IntParameter: {
+      uint16_t length;
+      if (!read(length)) return fail();
+      std::string name(length, '\0');
+      float floatValue;
+      int32_t intValue;
+      bool isFloat = (record == Record::FloatParameter);
+      if (!readBytes(&name[0], length) || !(isFloat ? read(floatValue) : read(intValue))) return fail();
+      ofParameterGroup& group = area.getParameterGroup();
+      if (!group.contains(name)) return true; // since renamed or removed
+      if (isFloat) {
+        group.getFloat(name).set(floatValue);
+      } else {
+        group.getInt(name).set(intValue);
+      }
+      return true;
+    }
+    case Record::QualityLevel: {
+      int32_t level;
+      if (!read(level)) return fail();
+      area.setQualityLevel(level);
+      return true;
+    }
+    case Record::LiveReflow: {
+      uint8_t enabled;
+      if (!read(enabled)) return fail();
+      area.setLiveReflow(enabled != 0);
+      return true;
+    }
+    case Record::SmoothnessOverride: {
+      uint8_t present;
+      float value;
+      if (!read(present) || !read(value)) return fail();
+      DividedArea::ParameterOverrides overrides;
+      if (present) overrides.unconstrainedSmoothness = value;
+      area.setParameterOverrides(overrides);
+      return true;
+    }
+    case Record::Checkpoint: {
+      uint64_t hash;
+      if (!read(hash)) return fail();
+      ++checkpoints;
+      if (hashLineSet(area) != hash) ++checkpointMismatches;
+      return true;
+    }
+    default:
+      return fail();
+  }
+}
+
+size_t InputLogPlayer::play(DividedArea& area) {
+  size_t records = 0;
+  while (step(area)) ++records;
+  return records;
+}
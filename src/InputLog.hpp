@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "ofxDividedArea.h"
+
+// A log of the calls that shaped an area's geometry, for replaying a show's
+// input offline: to time the geometry code against real data, and to bisect
+// a performance change by replaying the same log on either side of it.
+//
+// The file is a Header followed by records, each a Record byte and then its
+// fields, unpadded and native-endian:
+//   MajorRefPoints dt, count, count vec2s
+//   IdentifiedRefPoints dt, count, count (int32 id, vec2)s
+//   UnconstrainedDividerLine ref1, ref2
+//   ConstrainedDividerLine ref1, ref2, color, overriddenWidth, taper (uint8)
+//   DeleteEarlyConstrainedDividerLines count (uint64)
+//   EvictConstrainedDividerLine index (uint64)
+//   ClearConstrainedDividerLines
+//   FloatParameter, IntParameter name length (uint16), name, value
+//   QualityLevel level (int32)
+//   LiveReflow enabled (uint8)
+//   SmoothnessOverride present (uint8), value
+//   Checkpoint hashLineSet of the area (uint64)
+// Parameters and the other settings are logged as they change, ahead of the
+// call that first sees them.
+namespace inputlog {
+
+constexpr char FILE_MAGIC[8] = { 'D', 'I', 'V', 'I', 'N', 'P', '0', '1' };
+
+struct Header {
+  char magic[8];
+  glm::vec2 areaSize;
+  int32_t maxUnconstrainedDividerLines;
+};
+
+enum class Record : uint8_t {
+  MajorRefPoints,
+  IdentifiedRefPoints,
+  UnconstrainedDividerLine,
+  ConstrainedDividerLine,
+  DeleteEarlyConstrainedDividerLines,
+  EvictConstrainedDividerLine,
+  ClearConstrainedDividerLines,
+  FloatParameter,
+  IntParameter,
+  QualityLevel,
+  LiveReflow,
+  SmoothnessOverride,
+  Checkpoint,
+  Count
+};
+
+// The records that are calls into the area, which the player times
+constexpr size_t CALL_COUNT = static_cast<size_t>(Record::ClearConstrainedDividerLines) + 1;
+const char* getRecordName(Record record);
+
+// FNV-1a over the constrained lines and the major lines' endpoints, bit for bit
+uint64_t hashLineSet(const DividedArea& area);
+
+}
+
+// Logs an area's geometry calls while attached to it. Only the calls made
+// from outside the area are logged, whichever way they arrive
+// (drainInputs, processInsertions and the async geometry thread included),
+// on the thread that makes them.
+//
+//   InputLogRecorder recorder;
+//   recorder.open("show.divin", area); // on a new or cleared area
+//   ...
+//   recorder.checkpoint(); // now and then, to verify replays against
+//   recorder.close();
+class InputLogRecorder {
+public:
+  static constexpr size_t BUFFER_BYTES = 1 << 16;
+
+  InputLogRecorder() = default;
+  InputLogRecorder(const InputLogRecorder&) = delete;
+  InputLogRecorder& operator=(const InputLogRecorder&) = delete;
+  ~InputLogRecorder() { close(); }
+
+  // False if the file can't be opened, or the area already has lines: a
+  // replay starts from an empty area
+  bool open(const std::string& path, DividedArea& area);
+  // Logs a final checkpoint and detaches from the area
+  void close();
+  bool isOpen() const { return file != nullptr; }
+  // From the thread that runs the area's geometry
+  void checkpoint();
+
+  // Called by the area
+  void recordMajorRefPoints(geom::PointView majorRefPoints, float dt);
+  void recordIdentifiedRefPoints(const std::vector<IdentifiedRefPoint>& majorRefPoints, float dt);
+  void recordUnconstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2);
+  void recordConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2, const ofFloatColor& color, float overriddenWidth, bool taper);
+  void recordDeleteEarlyConstrainedDividerLines(size_t count);
+  void recordEvictConstrainedDividerLine(size_t index);
+  void recordClearConstrainedDividerLines();
+
+private:
+  struct TrackedParameter {
+    std::shared_ptr<ofAbstractParameter> parameter;
+    bool isFloat;
+    std::array<uint8_t, 4> value;
+  };
+
+  // Logs the settings that changed since the last call, then starts the call's record
+  void beginCall(inputlog::Record record);
+  void recordChangedSettings();
+  void recordParameter(const TrackedParameter& parameter);
+  template<typename T> void write(const T& value);
+  void writeBuffer();
+
+  FILE* file = nullptr;
+  DividedArea* area = nullptr;
+  std::vector<uint8_t> buffer;
+  std::vector<TrackedParameter> parameters;
+  int qualityLevel = 0;
+  bool liveReflow = false;
+  bool smoothnessOverridden = false;
+  float smoothnessOverride = 0.0f;
+};
+
+// Feeds a log back into an area as fast as it can, timing each call. Make
+// the area with the log's size and maxUnconstrainedDividerLines and leave it
+// otherwise as constructed; its line sets then come out as recorded, which
+// the log's checkpoints confirm.
+class InputLogPlayer {
+public:
+  // False if the file can't be read or isn't a log. A record cut short (by a
+  // crash, say) ends the log.
+  bool open(const std::string& path);
+  glm::vec2 getAreaSize() const { return header.areaSize; }
+  int getMaxUnconstrainedDividerLines() const { return header.maxUnconstrainedDividerLines; }
+
+  // Applies the next record; false at the end or at an unknown record
+  bool step(DividedArea& area);
+  // Applies every remaining record, returning how many there were
+  size_t play(DividedArea& area);
+
+  // Milliseconds taken by each call of a kind, in log order
+  const std::vector<double>& getDurations(inputlog::Record call) const { return durations[static_cast<size_t>(call)]; }
+  size_t getCheckpointCount() const { return checkpoints; }
+  size_t getCheckpointMismatchCount() const { return checkpointMismatches; }
+
+private:
+  template<typename T> bool read(T& value);
+  bool readBytes(void* to, size_t count);
+
+  std::vector<uint8_t> data;
+  size_t offset = 0;
+  inputlog::Header header {};
+  std::array<std::vector<double>, inputlog::CALL_COUNT> durations;
+  size_t checkpoints = 0;
+  size_t checkpointMismatches = 0;
+  std::vector<glm::vec2> points;
+  std::vector<IdentifiedRefPoint> identifiedPoints;
+};
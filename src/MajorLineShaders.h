@@ -274,6 +274,7 @@ public:
   ofParameter<float> refractiveReflectionOffsetParameter { "refractiveReflectionOffset", 0.05, 0.0, 1.0 };
   ofParameter<float> refractiveFresnelStrengthParameter { "refractiveFresnelStrength", 0.05, 0.0, 1.0 };
   ofParameter<float> refractiveFresnelFalloffParameter { "refractiveFresnelFalloff", 10.0, 0.0, 20.0 };
+  ofParameter<int> refractiveBackgroundLevelParameter { "refractiveBackgroundLevel", 0, 0, 3 }; // BackgroundPyramid level sampled; 0 = full resolution
   
   ofParameterGroup& getParameterGroup() {
     if (parameters.size() == 0) {
@@ -285,6 +286,7 @@ public:
       parameters.add(refractiveReflectionOffsetParameter);
       parameters.add(refractiveFresnelStrengthParameter);
       parameters.add(refractiveFresnelFalloffParameter);
+      parameters.add(refractiveBackgroundLevelParameter);
     }
     return parameters;
   }
@@ -414,12 +416,14 @@ class ChromaticAberrationLineShader : public MajorLineShaderBase {
 public:
   ofParameter<float> chromaticAberrationStrengthParameter { "chromaticAberrationStrength", 0.03, 0.0, 0.1 };
   ofParameter<float> chromaticAberrationEdgeThicknessParameter { "chromaticAberrationEdgeThickness", 0.5, 0.0, 1.0 };
+  ofParameter<int> chromaticAberrationBackgroundLevelParameter { "chromaticAberrationBackgroundLevel", 0, 0, 3 }; // BackgroundPyramid level sampled; 0 = full resolution
   
   ofParameterGroup& getParameterGroup() {
     if (parameters.size() == 0) {
       parameters.setName("Style: Chromatic Aberration");
       parameters.add(chromaticAberrationStrengthParameter);
       parameters.add(chromaticAberrationEdgeThicknessParameter);
+      parameters.add(chromaticAberrationBackgroundLevelParameter);
     }
     return parameters;
   }
@@ -490,10 +494,12 @@ private:
   ofParameterGroup parameters;
 };
 
-// Blur/refraction shader - screen-space blur with mild refraction near edges
+// Blur/refraction shader - screen-space blur with mild refraction near edges.
+// The blur comes from sampling a BackgroundPyramid level, so backgroundFbo
+// should be the level for blurRefractionBlurRadius (see levelForBlurRadius).
 class BlurRefractionLineShader : public MajorLineShaderBase {
 public:
-  ofParameter<float> blurRefractionBlurRadiusParameter { "blurRefractionBlurRadius", 1.5, 0.0, 8.0 }; // in pixels
+  ofParameter<float> blurRefractionBlurRadiusParameter { "blurRefractionBlurRadius", 1.5, 0.0, 8.0 }; // in background pixels, to the nearest pyramid level
   ofParameter<float> blurRefractionStrengthParameter { "blurRefractionStrength", 0.015, 0.0, 0.1 };
 
   ofParameterGroup& getParameterGroup() {
@@ -514,7 +520,6 @@ public:
 
     shader.begin();
     shader.setUniformTexture("backgroundTex", backgroundFbo->getTexture(), 0);
-    shader.setUniform2f("invResolution", 1.0f / backgroundFbo->getWidth(), 1.0f / backgroundFbo->getHeight());
     setUniforms(color, width, length, backgroundFbo);
     quadMesh.draw(center, { length, width }, angle);
     shader.end();
@@ -524,7 +529,6 @@ protected:
   void setUniforms(const ofFloatColor& color, float width, float length,
                    const ofFbo* backgroundFbo) override {
     MajorLineShaderBase::setUniforms(color, width, length, backgroundFbo);
-    shader.setUniform1f("blurRadius", blurRefractionBlurRadiusParameter);
     shader.setUniform1f("refractStrength", blurRefractionStrengthParameter);
   }
 
@@ -535,8 +539,6 @@ protected:
       out vec4 fragColor;
       
       uniform sampler2D backgroundTex;
-      uniform vec2 invResolution;
-      uniform float blurRadius;
       uniform float refractStrength;
 
       void main() {
@@ -549,16 +551,8 @@ protected:
         vec2 normalLocal = (absLocal.x < absLocal.y) ? vec2(sign(localPos.x), 0.0) : vec2(0.0, sign(localPos.y));
         vec2 refractUV = fragTexCoord + normalLocal * refractStrength * edgeFactor;
 
-        // 9-tap box blur around refracted UV
-        vec2 texel = invResolution * blurRadius;
-        vec4 sum = vec4(0.0);
-        for (int dx = -1; dx <= 1; ++dx) {
-          for (int dy = -1; dy <= 1; ++dy) {
-            sum += texture(backgroundTex, refractUV + vec2(dx, dy) * texel);
-          }
-        }
-        vec4 blurred = sum / 9.0;
-        fragColor = blurred;
+        // Already blurred by the pyramid
+        fragColor = texture(backgroundTex, refractUV);
       }
     );
   }
@@ -0,0 +1,64 @@
+#include "OcclusionRaster.hpp"
+#include "GeomUtils.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr float PI = 3.14159265358979323846f;
+
+void OcclusionRaster::reset(glm::vec2 areaSize, int newResolution) {
+  resolution = std::max(1, newResolution);
+  cellSize = std::max(areaSize.x, areaSize.y) / static_cast<float>(resolution);
+  if (!(cellSize > 0.0f)) cellSize = 1.0f;
+  width = std::max(1, static_cast<int>(std::ceil(areaSize.x / cellSize)));
+  height = std::max(1, static_cast<int>(std::ceil(areaSize.y / cellSize)));
+  cells.assign(width * height, Cell {});
+}
+
+void OcclusionRaster::clear() {
+  std::fill(cells.begin(), cells.end(), Cell {});
+}
+
+int OcclusionRaster::directionBin(glm::vec2 direction) {
+  float angle = std::atan2(direction.y, direction.x);
+  if (angle < 0.0f) angle += PI; // a line's direction is only defined over half a turn
+  int bin = static_cast<int>(angle / PI * DIRECTION_BINS);
+  return std::min(bin, DIRECTION_BINS - 1);
+}
+
+template<typename F>
+void OcclusionRaster::forEachCell(glm::vec2 start, glm::vec2 end, F&& fn) const {
+  geom::forEachGridCell(start / cellSize, end / cellSize, width, height, [&](int x, int y) { fn(y * width + x); });
+}
+
+void OcclusionRaster::addLine(glm::vec2 start, glm::vec2 end) {
+  if (cells.empty() || start == end) return;
+  uint16_t bit = static_cast<uint16_t>(1u << directionBin(end - start));
+  forEachCell(start, end, [&](int cell) {
+    Cell& c = cells[cell];
+    if (c.count < UINT16_MAX) ++c.count;
+    c.directions |= bit;
+  });
+}
+
+void OcclusionRaster::removeLine(glm::vec2 start, glm::vec2 end) {
+  if (cells.empty() || start == end) return;
+  forEachCell(start, end, [&](int cell) {
+    Cell& c = cells[cell];
+    if (c.count > 0 && --c.count == 0) c.directions = 0;
+  });
+}
+
+float OcclusionRaster::getCoverage(glm::vec2 start, glm::vec2 end) const {
+  if (cells.empty() || start == end) return 0.0f;
+  int bin = directionBin(end - start);
+  // The bin either side too, wrapping round since bins 0 and 15 are neighbours
+  uint16_t compatible = static_cast<uint16_t>((1u << bin)
+                                              | (1u << ((bin + 1) % DIRECTION_BINS))
+                                              | (1u << ((bin + DIRECTION_BINS - 1) % DIRECTION_BINS)));
+  int total = 0, covered = 0;
+  forEachCell(start, end, [&](int cell) {
+    ++total;
+    if (cells[cell].directions & compatible) ++covered;
+  });
+  return (total > 0) ? static_cast<float>(covered) / static_cast<float>(total) : 0.0f;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/vec2.hpp"
+
+// Coarse occupancy bitmap over an area for approximate line occlusion. Each
+// cell counts the lines crossing it and records which of 16 direction bins
+// (over half a turn) they fall in. Lines are walked cell by cell (DDA), so
+// adding, removing and testing a line cost its length in cells, however many
+// lines there are.
+//
+// Removing a line only clears a cell's directions once no lines are left in
+// it, so a cell shared by lines of different directions can go on matching a
+// removed line's direction until then.
+class OcclusionRaster {
+public:
+  static constexpr int DIRECTION_BINS = 16;
+
+  // Square cells, resolution of them along the longer side
+  void reset(glm::vec2 areaSize, int resolution);
+  void clear();
+  bool isAllocated() const { return !cells.empty(); }
+  int getResolution() const { return resolution; }
+
+  void addLine(glm::vec2 start, glm::vec2 end);
+  void removeLine(glm::vec2 start, glm::vec2 end);
+
+  // The fraction of the line's cells already holding a line within one
+  // direction bin of it
+  float getCoverage(glm::vec2 start, glm::vec2 end) const;
+
+private:
+  struct Cell {
+    uint16_t count = 0;
+    uint16_t directions = 0; // bit per direction bin
+  };
+
+  static int directionBin(glm::vec2 direction);
+  template<typename F> void forEachCell(glm::vec2 start, glm::vec2 end, F&& fn) const;
+
+  std::vector<Cell> cells;
+  int width = 0, height = 0;
+  int resolution = 0;
+  float cellSize = 1.0f;
+};
@@ -0,0 +1,571 @@
+#include "PlanarSubdivision.hpp"
+#include "GeomUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace geom;
+
+static constexpr float TWO_PI = 6.28318530717958647692f;
+
+static float wrapAngle(float angle) {
+  angle = std::fmod(angle, TWO_PI);
+  return (angle < 0.0f) ? angle + TWO_PI : angle;
+}
+
+void PlanarSubdivision::reset(glm::vec2 minCorner, glm::vec2 maxCorner, int newGridSize, float newTolerance) {
+  gridSize = std::max(1, newGridSize);
+  gridMin = minCorner;
+  cellSize = (maxCorner - minCorner) / static_cast<float>(gridSize);
+  if (!(cellSize.x > 0.0f)) cellSize.x = 1.0f;
+  if (!(cellSize.y > 0.0f)) cellSize.y = 1.0f;
+  tolerance = newTolerance;
+  cells.assign(gridSize * gridSize, {});
+  clear();
+}
+
+void PlanarSubdivision::clear() {
+  vertices.clear();
+  halfEdges.clear();
+  faces.assign(1, Face {});
+  for (auto& cell : cells) cell.clear();
+  edgeStamps.clear();
+  halfEdgeStamps.clear();
+  changedFaces.clear();
+  faceChanged.assign(1, false);
+  ++generation;
+}
+
+void PlanarSubdivision::markFaceChanged(int face) {
+  if (face == NONE) return;
+  if (faceChanged.size() < faces.size()) faceChanged.resize(faces.size(), false);
+  if (faceChanged[face]) return;
+  faceChanged[face] = true;
+  changedFaces.push_back(face);
+}
+
+void PlanarSubdivision::takeChangedFaces(std::vector<int>& changed) {
+  changed.clear();
+  changed.swap(changedFaces);
+  for (int face : changed) faceChanged[face] = false;
+}
+
+// Split a b at every crossing with the existing edges, then connect the pieces
+// in order. Each piece lies inside a single face, so connecting it either cuts
+// that face in two, joins two of its cycles, or extends a cycle as an antenna.
+void PlanarSubdivision::insertSegment(glm::vec2 a, glm::vec2 b, uint32_t line) {
+  float length = len(b - a);
+  if (length <= tolerance) return;
+  float tTolerance = tolerance / length;
+
+  collectHits(a, b);
+  std::sort(hits.begin(), hits.end(), [](const Hit& h1, const Hit& h2) { return h1.t < h2.t; });
+
+  // Hits closer than the tolerance are the same point; prefer an existing vertex
+  std::vector<Hit> stops;
+  stops.reserve(hits.size() + 2);
+  for (const auto& hit : hits) {
+    if (!stops.empty() && hit.t - stops.back().t <= tTolerance) {
+      if (stops.back().vertex == NONE && hit.vertex != NONE) stops.back() = hit;
+      continue;
+    }
+    stops.push_back(hit);
+  }
+  if (stops.empty() || stops.front().t > tTolerance) stops.insert(stops.begin(), Hit { 0.0f, NONE, NONE, a });
+  if (stops.back().t < 1.0f - tTolerance) stops.push_back(Hit { 1.0f, NONE, NONE, b });
+
+  std::vector<int> chain;
+  chain.reserve(stops.size());
+  splitLog.clear();
+  for (const auto& stop : stops) {
+    if (stop.vertex != NONE) {
+      chain.push_back(stop.vertex);
+    } else if (stop.edge != NONE) {
+      // A collinear segment can land twice on one edge, so find the piece it's on now
+      int edge = stop.edge;
+      float bestDistance = pointToSegmentDistance(stop.position, getOrigin(2 * edge), getDestination(2 * edge));
+      for (const auto& split : splitLog) {
+        if (split.first != stop.edge) continue;
+        float distance = pointToSegmentDistance(stop.position, getOrigin(2 * split.second), getDestination(2 * split.second));
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          edge = split.second;
+        }
+      }
+      int vertex = splitEdge(edge, stop.position);
+      splitLog.emplace_back(stop.edge, vertices[vertex].outgoing / 2);
+      chain.push_back(vertex);
+    } else {
+      chain.push_back(addVertex(stop.position));
+    }
+  }
+
+  for (size_t i = 0; i + 1 < chain.size(); ++i) {
+    if (chain[i] == chain[i + 1] || findHalfEdge(chain[i], chain[i + 1]) != NONE) continue;
+    connect(chain[i], chain[i + 1], line);
+  }
+}
+
+void PlanarSubdivision::collectHits(glm::vec2 a, glm::vec2 b) {
+  hits.clear();
+  glm::vec2 d = b - a;
+  float length = len(d);
+  float tTolerance = tolerance / length;
+  float tolerance2 = tolerance * tolerance;
+  uint32_t visit = ++stamp;
+
+  forEachCellOnSegment(a, b, [&](int cell) {
+    for (const auto& gridEdge : cells[cell]) {
+      int edge = gridEdge.edge;
+      if (edgeStamps[edge] == visit) continue;
+      edgeStamps[edge] = visit;
+
+      int v0 = halfEdges[2 * edge].origin;
+      int v1 = halfEdges[2 * edge + 1].origin;
+      glm::vec2 p0 = vertices[v0].position;
+      glm::vec2 p1 = vertices[v1].position;
+      glm::vec2 s = p1 - p0;
+      glm::vec2 ap = p0 - a;
+      float sLength = len(s);
+      float denominator = cross2(d, s);
+
+      if (std::fabs(denominator) <= 1e-6f * length * sLength) {
+        // Parallel: only a collinear overlap matters. The overlap is bounded by
+        // the edge's ends lying on the segment and the segment's ends lying on
+        // the edge, which split it so the shared part isn't added twice.
+        if (std::fabs(cross2(d, ap)) > tolerance * length) continue;
+        for (int v : { v0, v1 }) {
+          float t = dot2(vertices[v].position - a, d) / (length * length);
+          if (t >= -tTolerance && t <= 1.0f + tTolerance) {
+            hits.push_back(Hit { std::clamp(t, 0.0f, 1.0f), v, NONE, vertices[v].position });
+          }
+        }
+        float uTolerance = tolerance / sLength;
+        for (float t : { 0.0f, 1.0f }) {
+          float u = dot2(a + t * d - p0, s) / (sLength * sLength);
+          if (u > uTolerance && u < 1.0f - uTolerance) {
+            hits.push_back(Hit { t, NONE, edge, p0 + u * s });
+          }
+        }
+        continue;
+      }
+
+      float t = cross2(ap, s) / denominator;
+      float u = cross2(ap, d) / denominator;
+      float uTolerance = tolerance / sLength;
+      if (t < -tTolerance || t > 1.0f + tTolerance || u < -uTolerance || u > 1.0f + uTolerance) continue;
+
+      // Take the point on the existing edge so the existing geometry doesn't drift
+      glm::vec2 p = p0 + std::clamp(u, 0.0f, 1.0f) * s;
+      t = std::clamp(t, 0.0f, 1.0f);
+      if (glm::distance2(p, p0) <= tolerance2) {
+        hits.push_back(Hit { t, v0, NONE, p0 });
+      } else if (glm::distance2(p, p1) <= tolerance2) {
+        hits.push_back(Hit { t, v1, NONE, p1 });
+      } else {
+        hits.push_back(Hit { t, NONE, edge, p });
+      }
+    }
+  });
+}
+
+int PlanarSubdivision::addVertex(glm::vec2 position) {
+  vertices.push_back(Vertex { position, NONE });
+  return static_cast<int>(vertices.size()) - 1;
+}
+
+int PlanarSubdivision::addEdge(int from, int to, uint32_t line) {
+  int halfEdge = static_cast<int>(halfEdges.size());
+  halfEdges.push_back(HalfEdge { from, NONE, NONE, NONE, line });
+  halfEdges.push_back(HalfEdge { to, NONE, NONE, NONE, line });
+  halfEdgeStamps.resize(halfEdges.size(), 0);
+  edgeStamps.push_back(0);
+  return halfEdge;
+}
+
+static inline void link(std::vector<PlanarSubdivision::HalfEdge>& halfEdges, int from, int to) {
+  halfEdges[from].next = to;
+  halfEdges[to].prev = from;
+}
+
+// a->b becomes a->v->b; the new edge takes the v->b half
+int PlanarSubdivision::splitEdge(int edge, glm::vec2 position) {
+  removeEdgeFromGrid(edge);
+  int h = 2 * edge;
+  int t = h + 1;
+  int b = halfEdges[t].origin;
+  int hNext = halfEdges[h].next;
+  int tPrev = halfEdges[t].prev;
+
+  int v = addVertex(position);
+  int h2 = addEdge(v, b, halfEdges[h].line);
+  int t2 = h2 + 1;
+  halfEdges[h2].face = halfEdges[h].face;
+  halfEdges[t2].face = halfEdges[t].face;
+  halfEdges[t].origin = v;
+
+  link(halfEdges, h, h2);
+  if (hNext == t) {
+    link(halfEdges, h2, t2); // b was a dangling end
+  } else {
+    link(halfEdges, h2, hNext);
+    link(halfEdges, tPrev, t2);
+  }
+  link(halfEdges, t2, t);
+  markFaceChanged(halfEdges[h].face);
+  markFaceChanged(halfEdges[t].face);
+
+  if (vertices[b].outgoing == t) vertices[b].outgoing = t2;
+  vertices[v].outgoing = h2;
+  addEdgeToGrid(edge);
+  addEdgeToGrid(h2 / 2);
+  return v;
+}
+
+int PlanarSubdivision::findHalfEdge(int from, int to) const {
+  int start = vertices[from].outgoing;
+  if (start == NONE) return NONE;
+  int outgoing = start;
+  do {
+    if (halfEdges[outgoing ^ 1].origin == to) return outgoing;
+    outgoing = halfEdges[outgoing].prev ^ 1; // next outgoing counter-clockwise
+  } while (outgoing != start);
+  return NONE;
+}
+
+// The incoming half-edge at vertex whose face contains direction: the wedge
+// counter-clockwise from its successor to the next outgoing edge around
+int PlanarSubdivision::findIncomingBefore(int vertex, glm::vec2 direction) const {
+  int start = vertices[vertex].outgoing;
+  glm::vec2 origin = vertices[vertex].position;
+  float directionAngle = std::atan2(direction.y, direction.x);
+  int outgoing = start;
+  do {
+    int incoming = halfEdges[outgoing].prev;
+    int nextOutgoing = incoming ^ 1;
+    glm::vec2 from = getDestination(outgoing) - origin;
+    float fromAngle = std::atan2(from.y, from.x);
+    float wedge = TWO_PI;
+    if (nextOutgoing != outgoing) {
+      glm::vec2 to = getDestination(nextOutgoing) - origin;
+      wedge = wrapAngle(std::atan2(to.y, to.x) - fromAngle);
+    }
+    float angle = wrapAngle(directionAngle - fromAngle);
+    if (angle > 0.0f && angle < wedge) return incoming;
+    outgoing = nextOutgoing;
+  } while (outgoing != start);
+  return halfEdges[start].prev; // along an existing edge; any slot will do
+}
+
+void PlanarSubdivision::connect(int from, int to, uint32_t line) {
+  glm::vec2 p = vertices[from].position;
+  glm::vec2 q = vertices[to].position;
+  int inFrom = (vertices[from].outgoing == NONE) ? NONE : findIncomingBefore(from, q - p);
+  int inTo = (vertices[to].outgoing == NONE) ? NONE : findIncomingBefore(to, p - q);
+
+  int face;
+  if (inFrom != NONE && inTo != NONE) {
+    face = halfEdges[inFrom].face;
+    // Snapping can leave the ends looking into different faces; drop the piece
+    // rather than break the structure
+    if (halfEdges[inTo].face != face) return;
+  } else if (inFrom != NONE) {
+    face = halfEdges[inFrom].face;
+  } else if (inTo != NONE) {
+    face = halfEdges[inTo].face;
+  } else {
+    face = locateFace((p + q) * 0.5f);
+  }
+
+  int n = addEdge(from, to, line);
+  int m = n + 1;
+  halfEdges[n].face = face;
+  halfEdges[m].face = face;
+  markFaceChanged(face);
+  if (inFrom != NONE) {
+    int out = halfEdges[inFrom].next;
+    link(halfEdges, inFrom, n);
+    link(halfEdges, m, out);
+  } else {
+    link(halfEdges, m, n);
+    vertices[from].outgoing = n;
+  }
+  if (inTo != NONE) {
+    int out = halfEdges[inTo].next;
+    link(halfEdges, inTo, m);
+    link(halfEdges, n, out);
+  } else {
+    link(halfEdges, n, m);
+    vertices[to].outgoing = m;
+  }
+  addEdgeToGrid(n / 2);
+
+  if (inFrom == NONE && inTo == NONE) {
+    faces[face].holes.push_back(n); // touches nothing
+    return;
+  }
+  if (inFrom == NONE || inTo == NONE) return; // antenna on an existing cycle
+
+  uint32_t cycleN = markCycle(n);
+  if (halfEdgeStamps[m] == cycleN) {
+    // Two cycles were joined: a hole got connected to the outer cycle or another hole
+    bool joinedOuter = faces[face].outer != NONE && halfEdgeStamps[faces[face].outer] == cycleN;
+    auto& holes = faces[face].holes;
+    holes.erase(std::remove_if(holes.begin(), holes.end(), [&](int hole) { return halfEdgeStamps[hole] == cycleN; }), holes.end());
+    if (!joinedOuter) holes.push_back(n);
+    return;
+  }
+
+  // A cycle was cut in two
+  uint32_t cycleM = markCycle(m);
+  int outer = faces[face].outer;
+  if (outer != NONE && (halfEdgeStamps[outer] == cycleN || halfEdgeStamps[outer] == cycleM)) {
+    int newCycle = (halfEdgeStamps[outer] == cycleN) ? m : n;
+    int newFace = addFace(newCycle);
+    moveHolesInside(face, newFace, newCycle);
+    return;
+  }
+
+  // A hole was cut: the part it now encloses is a new face, the rest stays a hole
+  auto& holes = faces[face].holes;
+  holes.erase(std::remove_if(holes.begin(), holes.end(), [&](int hole) {
+    return halfEdgeStamps[hole] == cycleN || halfEdgeStamps[hole] == cycleM;
+  }), holes.end());
+  // Exactly one side encloses area; compare rather than test the sign, since a
+  // zero-area remainder can come out slightly positive
+  int newCycle = (getSignedArea(n) > getSignedArea(m)) ? n : m;
+  int newFace = addFace(newCycle);
+  moveHolesInside(face, newFace, newCycle);
+  faces[face].holes.push_back(newCycle == n ? m : n);
+}
+
+int PlanarSubdivision::addFace(int outer) {
+  faces.push_back(Face { outer, {} });
+  int face = static_cast<int>(faces.size()) - 1;
+  setCycleFace(outer, face);
+  markFaceChanged(face);
+  return face;
+}
+
+void PlanarSubdivision::setCycleFace(int cycle, int face) {
+  int halfEdge = cycle;
+  do {
+    halfEdges[halfEdge].face = face;
+    halfEdge = halfEdges[halfEdge].next;
+  } while (halfEdge != cycle);
+}
+
+void PlanarSubdivision::moveHolesInside(int from, int to, int cycle) {
+  auto& holes = faces[from].holes;
+  for (size_t i = 0; i < holes.size(); ) {
+    if (isInsideCycle(getOrigin(holes[i]), cycle)) {
+      setCycleFace(holes[i], to);
+      faces[to].holes.push_back(holes[i]);
+      holes[i] = holes.back();
+      holes.pop_back();
+    } else {
+      ++i;
+    }
+  }
+}
+
+uint32_t PlanarSubdivision::markCycle(int cycle) {
+  uint32_t mark = ++stamp;
+  forEachCycleHalfEdge(cycle, [&](int halfEdge) { halfEdgeStamps[halfEdge] = mark; });
+  return mark;
+}
+
+// Dropping antennas can break a cycle into several loops, nested like brackets
+// in the walk (a loop hanging off another by an antenna is walked in full
+// before the other resumes), so pieces are stacked until they close.
+void PlanarSubdivision::getFaceLoops(int face, std::vector<std::vector<glm::vec2>>& loops) const {
+  loops.clear();
+  struct Piece { int start; int end; std::vector<glm::vec2> positions; };
+  std::vector<Piece> pieces;
+  auto walk = [&](int cycle) {
+    pieces.clear();
+    forEachCycleHalfEdge(cycle, [&](int halfEdge) {
+      if (halfEdges[halfEdge ^ 1].face == face) return; // antenna
+      int origin = halfEdges[halfEdge].origin;
+      if (pieces.empty() || pieces.back().end != origin) pieces.push_back(Piece { origin, origin, {} });
+      Piece& piece = pieces.back();
+      piece.positions.push_back(vertices[origin].position);
+      piece.end = halfEdges[halfEdge ^ 1].origin;
+      if (piece.end == piece.start) {
+        loops.push_back(std::move(piece.positions));
+        pieces.pop_back();
+      }
+    });
+  };
+  const Face& f = faces[face];
+  if (f.outer != NONE) walk(f.outer);
+  for (int hole : f.holes) walk(hole);
+}
+
+float PlanarSubdivision::getSignedArea(int cycle) const {
+  // Relative to a point on the cycle, so small faces far from the origin keep their sign
+  glm::vec2 reference = getOrigin(cycle);
+  float area = 0.0f;
+  forEachCycleHalfEdge(cycle, [&](int halfEdge) {
+    area += cross2(getOrigin(halfEdge) - reference, getDestination(halfEdge) - reference);
+  });
+  return area * 0.5f;
+}
+
+bool PlanarSubdivision::isInsideCycle(glm::vec2 p, int cycle) const {
+  bool inside = false;
+  forEachCycleHalfEdge(cycle, [&](int halfEdge) {
+    glm::vec2 a = getOrigin(halfEdge);
+    glm::vec2 b = getDestination(halfEdge);
+    if ((a.y <= p.y) != (b.y <= p.y)) {
+      float x = a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y);
+      if (x > p.x) inside = !inside;
+    }
+  });
+  return inside;
+}
+
+int PlanarSubdivision::locateFace(glm::vec2 p) const {
+  int row = rowOf(p.y);
+  int bestEdge = NONE;
+  float bestX = std::numeric_limits<float>::infinity();
+  float bestInverseSlope = 0.0f;
+  for (int column = columnOf(p.x); column < gridSize; ++column) {
+    for (const auto& gridEdge : cells[row * gridSize + column]) {
+      glm::vec2 p0 = gridEdge.p0;
+      glm::vec2 p1 = gridEdge.p1;
+      // Half-open in y, so a ray through a vertex counts each edge consistently
+      bool below0 = p0.y <= p.y;
+      if (below0 == (p1.y <= p.y)) continue;
+      glm::vec2 lower = below0 ? p0 : p1;
+      glm::vec2 upper = below0 ? p1 : p0;
+      float inverseSlope = (upper.x - lower.x) / (upper.y - lower.y);
+      float x = lower.x + (p.y - lower.y) * inverseSlope;
+      if (x < p.x) continue;
+      // Edges meeting at the hit vertex: the ray sits just above it, so take the leftmost there
+      if (x < bestX || (x == bestX && inverseSlope < bestInverseSlope)) {
+        bestEdge = gridEdge.edge;
+        bestX = x;
+        bestInverseSlope = inverseSlope;
+      }
+    }
+    // Anything hit further right is registered in a later column only if its hit is right of this one
+    if (bestEdge != NONE && bestX <= columnRight(column)) break;
+  }
+  if (bestEdge == NONE) return UNBOUNDED_FACE;
+  // The half-edge pointing up has the ray's side on its left
+  int halfEdge = 2 * bestEdge;
+  if (!(getOrigin(halfEdge).y <= p.y)) halfEdge ^= 1;
+  return halfEdges[halfEdge].face;
+}
+
+int PlanarSubdivision::rowOf(float y) const {
+  float row = std::floor((y - gridMin.y) / cellSize.y);
+  if (!(row > 0.0f)) return 0;
+  if (row >= static_cast<float>(gridSize - 1)) return gridSize - 1;
+  return static_cast<int>(row);
+}
+
+int PlanarSubdivision::columnOf(float x) const {
+  float column = std::floor((x - gridMin.x) / cellSize.x);
+  if (!(column > 0.0f)) return 0;
+  if (column >= static_cast<float>(gridSize - 1)) return gridSize - 1;
+  return static_cast<int>(column);
+}
+
+// The outer rows and columns stretch to infinity so everything lands somewhere
+float PlanarSubdivision::rowBottom(int row) const {
+  return (row == 0) ? -std::numeric_limits<float>::infinity() : gridMin.y + row * cellSize.y;
+}
+
+float PlanarSubdivision::rowTop(int row) const {
+  return (row == gridSize - 1) ? std::numeric_limits<float>::infinity() : gridMin.y + (row + 1) * cellSize.y;
+}
+
+float PlanarSubdivision::columnRight(int column) const {
+  return (column == gridSize - 1) ? std::numeric_limits<float>::infinity() : gridMin.x + (column + 1) * cellSize.x;
+}
+
+// Every cell the segment passes through, padded by the tolerance so rounding
+// never leaves an edge out of a cell it touches
+template<typename F>
+void PlanarSubdivision::forEachCellOnSegment(glm::vec2 a, glm::vec2 b, F&& fn) const {
+  if (a.y > b.y) std::swap(a, b);
+  float pad = tolerance;
+  float dy = b.y - a.y;
+  float inverseSlope = (dy > 0.0f) ? (b.x - a.x) / dy : 0.0f;
+  int lastRow = rowOf(b.y + pad);
+  for (int row = rowOf(a.y - pad); row <= lastRow; ++row) {
+    float x0 = a.x, x1 = b.x;
+    if (dy > 0.0f) {
+      float y0 = std::max(a.y, rowBottom(row) - pad);
+      float y1 = std::min(b.y, rowTop(row) + pad);
+      x0 = a.x + (y0 - a.y) * inverseSlope;
+      x1 = a.x + (y1 - a.y) * inverseSlope;
+    }
+    if (x0 > x1) std::swap(x0, x1);
+    int lastColumn = columnOf(x1 + pad);
+    for (int column = columnOf(x0 - pad); column <= lastColumn; ++column) {
+      fn(row * gridSize + column);
+    }
+  }
+}
+
+void PlanarSubdivision::addEdgeToGrid(int edge) {
+  glm::vec2 p0 = getOrigin(2 * edge);
+  glm::vec2 p1 = getDestination(2 * edge);
+  forEachCellOnSegment(p0, p1, [&](int cell) {
+    cells[cell].push_back(GridEdge { edge, p0, p1 });
+  });
+}
+
+void PlanarSubdivision::removeEdgeFromGrid(int edge) {
+  forEachCellOnSegment(getOrigin(2 * edge), getDestination(2 * edge), [&](int cell) {
+    auto& cellEdges = cells[cell];
+    auto iter = std::find_if(cellEdges.begin(), cellEdges.end(), [&](const GridEdge& gridEdge) { return gridEdge.edge == edge; });
+    if (iter != cellEdges.end()) {
+      *iter = cellEdges.back();
+      cellEdges.pop_back();
+    }
+  });
+}
+
+bool PlanarSubdivision::isValid() const {
+  int halfEdgeCount = static_cast<int>(halfEdges.size());
+  for (int h = 0; h < halfEdgeCount; ++h) {
+    const HalfEdge& e = halfEdges[h];
+    if (e.next < 0 || e.next >= halfEdgeCount || e.prev < 0 || e.prev >= halfEdgeCount) return false;
+    if (e.face < 0 || e.face >= static_cast<int>(faces.size())) return false;
+    if (halfEdges[e.next].prev != h || halfEdges[e.prev].next != h) return false;
+    if (halfEdges[e.next].origin != halfEdges[h ^ 1].origin) return false;
+    if (halfEdges[e.next].face != e.face) return false;
+  }
+
+  // Each cycle belongs to exactly one face record, labelled and oriented to match
+  std::vector<int> owner(halfEdges.size(), NONE);
+  auto claimCycle = [&](int cycle, int face) {
+    int halfEdge = cycle;
+    int steps = 0;
+    do {
+      if (owner[halfEdge] != NONE || halfEdges[halfEdge].face != face || ++steps > halfEdgeCount) return false;
+      owner[halfEdge] = face;
+      halfEdge = halfEdges[halfEdge].next;
+    } while (halfEdge != cycle);
+    return true;
+  };
+  // Holes enclose nothing, up to rounding over their length
+  auto isHoleCycle = [&](int cycle) {
+    float perimeter = 0.0f;
+    forEachCycleHalfEdge(cycle, [&](int halfEdge) { perimeter += glm::distance(getOrigin(halfEdge), getDestination(halfEdge)); });
+    return getSignedArea(cycle) <= tolerance * perimeter;
+  };
+  for (int face = 0; face < static_cast<int>(faces.size()); ++face) {
+    const Face& f = faces[face];
+    if ((face == UNBOUNDED_FACE) != (f.outer == NONE)) return false;
+    if (f.outer != NONE && (!claimCycle(f.outer, face) || getSignedArea(f.outer) <= 0.0f)) return false;
+    for (int hole : f.holes) {
+      if (!claimCycle(hole, face) || !isHoleCycle(hole)) return false;
+    }
+  }
+  return std::none_of(owner.begin(), owner.end(), [](int face) { return face == NONE; });
+}
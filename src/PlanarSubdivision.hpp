@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "glm/vec2.hpp"
+
+// Half-edge (DCEL) planar subdivision built from line segments. Each inserted
+// segment is split where it crosses existing edges, so faces are exactly the
+// regions the segments cut the plane into. Dangling segment ends become
+// antennas inside their face, and segments touching nothing else become holes.
+// Bounded faces have one counter-clockwise outer cycle plus any hole cycles;
+// face 0 is the unbounded face. Faces lie to the left of their half-edges.
+//
+// A uniform grid over the edges keeps point location and insertion local:
+// both only look at edges near the query, so their cost follows the size of
+// the faces involved rather than the number of segments.
+//
+// Segments can only be added. Callers rebuild (reset + insert) when segments
+// move or are removed.
+class PlanarSubdivision {
+public:
+  static constexpr int NONE = -1;
+  static constexpr int UNBOUNDED_FACE = 0;
+
+  struct Vertex {
+    glm::vec2 position;
+    int outgoing = NONE;
+  };
+
+  // Half-edges come in pairs: the twin of h is h ^ 1, so edge e is made of
+  // half-edges 2e and 2e + 1
+  struct HalfEdge {
+    int origin;
+    int next;
+    int prev;
+    int face;
+    uint32_t line; // caller's tag for the segment this edge is part of
+  };
+
+  struct Face {
+    int outer = NONE; // a half-edge on the outer cycle; NONE for the unbounded face
+    std::vector<int> holes; // a half-edge on each inner cycle
+  };
+
+  // Drop everything and grid [minCorner, maxCorner] into gridSize x gridSize
+  // cells. Points closer than tolerance are treated as coincident. Segments may
+  // extend outside the grid; they're just less local there.
+  void reset(glm::vec2 minCorner, glm::vec2 maxCorner, int gridSize, float tolerance);
+  void clear();
+
+  void insertSegment(glm::vec2 a, glm::vec2 b, uint32_t line);
+
+  // The face containing p: a ray cast along +x from p through the grid row
+  // finds the nearest edge, whose left-facing half-edge bounds the face
+  int locateFace(glm::vec2 p) const;
+
+  static int twin(int halfEdge) { return halfEdge ^ 1; }
+  const Vertex& getVertex(int vertex) const { return vertices[vertex]; }
+  const HalfEdge& getHalfEdge(int halfEdge) const { return halfEdges[halfEdge]; }
+  const Face& getFace(int face) const { return faces[face]; }
+  glm::vec2 getOrigin(int halfEdge) const { return vertices[halfEdges[halfEdge].origin].position; }
+  glm::vec2 getDestination(int halfEdge) const { return vertices[halfEdges[halfEdge ^ 1].origin].position; }
+  size_t getVertexCount() const { return vertices.size(); }
+  size_t getHalfEdgeCount() const { return halfEdges.size(); }
+  size_t getFaceCount() const { return faces.size(); }
+
+  template<typename F> void forEachCycleHalfEdge(int start, F&& fn) const {
+    int halfEdge = start;
+    do {
+      fn(halfEdge);
+      halfEdge = halfEdges[halfEdge].next;
+    } while (halfEdge != start);
+  }
+
+  // Every half-edge bounding a face: its outer cycle, then its holes
+  template<typename F> void forEachBoundaryHalfEdge(int face, F&& fn) const {
+    const Face& f = faces[face];
+    if (f.outer != NONE) forEachCycleHalfEdge(f.outer, fn);
+    for (int hole : f.holes) forEachCycleHalfEdge(hole, fn);
+  }
+
+  // The closed loops bounding a face, with antennas (edges with the face on
+  // both sides) left out: counter-clockwise loops enclose the face,
+  // clockwise ones are holes in it
+  void getFaceLoops(int face, std::vector<std::vector<glm::vec2>>& loops) const;
+
+  // Faces whose boundary changed since the last call, each listed once. A face
+  // that's split keeps its index for one side and the other side is a new face.
+  void takeChangedFaces(std::vector<int>& changed);
+  // Bumped by reset and clear, which renumber every face
+  uint64_t getGeneration() const { return generation; }
+
+  float getSignedArea(int cycle) const;
+  bool isInsideCycle(glm::vec2 p, int cycle) const;
+
+  // Checks the structural invariants (links, face labels, cycle orientation)
+  bool isValid() const;
+
+private:
+  struct Hit {
+    float t; // along the inserted segment
+    int vertex; // an existing vertex, or NONE
+    int edge; // an existing edge to split, or NONE for a free end
+    glm::vec2 position;
+  };
+
+  int addVertex(glm::vec2 position);
+  int addEdge(int from, int to, uint32_t line);
+  int splitEdge(int edge, glm::vec2 position);
+  int findHalfEdge(int from, int to) const;
+  int findIncomingBefore(int vertex, glm::vec2 direction) const;
+  void connect(int from, int to, uint32_t line);
+  int addFace(int outer);
+  void setCycleFace(int cycle, int face);
+  void moveHolesInside(int from, int to, int cycle);
+  uint32_t markCycle(int cycle);
+  void markFaceChanged(int face);
+  void collectHits(glm::vec2 a, glm::vec2 b);
+
+  int rowOf(float y) const;
+  int columnOf(float x) const;
+  float rowBottom(int row) const;
+  float rowTop(int row) const;
+  float columnRight(int column) const;
+  template<typename F> void forEachCellOnSegment(glm::vec2 a, glm::vec2 b, F&& fn) const;
+  void addEdgeToGrid(int edge);
+  void removeEdgeFromGrid(int edge);
+
+  std::vector<Vertex> vertices;
+  std::vector<HalfEdge> halfEdges;
+  std::vector<Face> faces { Face {} };
+
+  glm::vec2 gridMin { 0.0f, 0.0f };
+  glm::vec2 cellSize { 1.0f, 1.0f };
+  int gridSize = 1;
+  float tolerance = 1e-6f;
+  // Edges per cell, row-major, with their end points copied in so point
+  // location reads one array rather than chasing edges to vertices
+  struct GridEdge {
+    int edge;
+    glm::vec2 p0, p1; // origin and destination of half-edge 2 * edge
+  };
+  std::vector<std::vector<GridEdge>> cells;
+
+  // Scratch for insertion: visit stamps and hits
+  uint32_t stamp = 0;
+  std::vector<uint32_t> edgeStamps;
+  std::vector<uint32_t> halfEdgeStamps;
+  std::vector<Hit> hits;
+  std::vector<std::pair<int, int>> splitLog; // (edge hit, edge split off it) during one insertion
+
+  uint64_t generation = 0;
+  std::vector<int> changedFaces;
+  std::vector<bool> faceChanged;
+};
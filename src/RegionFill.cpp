@@ -0,0 +1,245 @@
+#include "RegionFill.hpp"
+#include "GeomUtils.h"
+#include "ofGraphics.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+using namespace geom;
+
+// Spare vertices per slot, so a region that gains a triangle stays put
+static constexpr int SLOT_SLACK = 6;
+
+void RegionFillRenderer::setColorFunction(ColorFunction newColorFunction) {
+  colorFunction = std::move(newColorFunction);
+  colorFunctionChanged = true;
+}
+
+void RegionFillRenderer::update(DividedArea& dividedArea) {
+  const auto& regions = dividedArea.getRegions();
+  dirtyBegin = static_cast<int>(vertices.size());
+  dirtyEnd = 0;
+
+  if (colorFunctionChanged || regionsGeneration != dividedArea.getRegionsGeneration()) {
+    regionsGeneration = dividedArea.getRegionsGeneration();
+    colorFunctionChanged = false;
+    layOut(regions, dividedArea.size);
+  } else {
+    slots.resize(regions.size());
+    for (size_t region = 0; region < regions.size(); ++region) {
+      if (slots[region].version == regions[region].version) continue;
+      fillSlot(static_cast<int>(region), regions[region], dividedArea.size, true);
+    }
+    if (abandonedVertices > static_cast<int>(vertices.size()) / 2) layOut(regions, dividedArea.size);
+  }
+
+  if (static_cast<int>(vertices.size()) > allocatedVertices) {
+    allocatedVertices = std::max(1024, static_cast<int>(vertices.size()) * 2);
+    buffer.allocate(allocatedVertices * sizeof(RegionFillVertex), nullptr, GL_DYNAMIC_DRAW);
+    int stride = sizeof(RegionFillVertex);
+    vbo.setVertexBuffer(buffer, 2, stride, offsetof(RegionFillVertex, position));
+    vbo.setTexCoordBuffer(buffer, stride, offsetof(RegionFillVertex, texCoord));
+    vbo.setColorBuffer(buffer, stride, offsetof(RegionFillVertex, color));
+    dirtyBegin = 0;
+    dirtyEnd = static_cast<int>(vertices.size());
+  }
+  if (dirtyEnd > dirtyBegin) {
+    buffer.updateData(dirtyBegin * sizeof(RegionFillVertex), (dirtyEnd - dirtyBegin) * sizeof(RegionFillVertex), &vertices[dirtyBegin]);
+  }
+}
+
+void RegionFillRenderer::layOut(const std::vector<DividedAreaRegion>& regions, glm::vec2 areaSize) {
+  vertices.clear();
+  abandonedVertices = 0;
+  slots.assign(regions.size(), Slot {});
+  for (size_t region = 0; region < regions.size(); ++region) {
+    fillSlot(static_cast<int>(region), regions[region], areaSize, false);
+  }
+  dirtyBegin = 0;
+  dirtyEnd = static_cast<int>(vertices.size());
+}
+
+void RegionFillRenderer::fillSlot(int region, const DividedAreaRegion& r, glm::vec2 areaSize, bool allowMove) {
+  Slot& slot = slots[region];
+  slot.version = r.version;
+  triangles.clear();
+  triangulate(r, triangles);
+  int count = static_cast<int>(triangles.size());
+
+  if (count > slot.capacity) {
+    // Leave the old slot as degenerate triangles and take a new one at the end
+    if (allowMove) {
+      std::fill(vertices.begin() + slot.first, vertices.begin() + slot.first + slot.capacity, RegionFillVertex {});
+      dirtyBegin = std::min(dirtyBegin, slot.first);
+      dirtyEnd = std::max(dirtyEnd, slot.first + slot.capacity);
+      abandonedVertices += slot.capacity;
+    }
+    slot.first = static_cast<int>(vertices.size());
+    slot.capacity = (count == 0) ? 0 : count + SLOT_SLACK;
+    vertices.resize(vertices.size() + slot.capacity);
+  }
+
+  ofFloatColor color = colorFunction ? colorFunction(region, r) : ofFloatColor(1.0f);
+  for (int i = 0; i < count; ++i) {
+    vertices[slot.first + i] = RegionFillVertex { triangles[i], triangles[i] / areaSize, color };
+  }
+  std::fill(vertices.begin() + slot.first + count, vertices.begin() + slot.first + slot.capacity, RegionFillVertex {});
+  dirtyBegin = std::min(dirtyBegin, slot.first);
+  dirtyEnd = std::max(dirtyEnd, slot.first + slot.capacity);
+}
+
+void RegionFillRenderer::draw(float scale) const {
+  if (vertices.empty()) return;
+  ofPushMatrix();
+  ofScale(scale);
+  vbo.draw(GL_TRIANGLES, 0, static_cast<int>(vertices.size()));
+  ofPopMatrix();
+}
+
+// Drops repeated and collinear points, which would only make degenerate ears
+static void simplifyLoop(const std::vector<glm::vec2>& loop, std::vector<glm::vec2>& simplified) {
+  simplified.clear();
+  for (const auto& p : loop) {
+    while (simplified.size() >= 2) {
+      glm::vec2 a = simplified[simplified.size() - 2];
+      glm::vec2 b = simplified.back();
+      if (std::fabs(cross2(b - a, p - b)) > EPS * len(p - a) * len(p - a)) break;
+      simplified.pop_back();
+    }
+    if (simplified.empty() || simplified.back() != p) simplified.push_back(p);
+  }
+  // Close around the seam the same way
+  while (simplified.size() >= 3) {
+    size_t n = simplified.size();
+    glm::vec2 a = simplified[n - 2], b = simplified[n - 1], c = simplified[0];
+    if (std::fabs(cross2(b - a, c - b)) > EPS * len(c - a) * len(c - a)) break;
+    simplified.pop_back();
+  }
+  while (simplified.size() >= 3) {
+    size_t n = simplified.size();
+    glm::vec2 a = simplified[n - 1], b = simplified[0], c = simplified[1];
+    if (std::fabs(cross2(b - a, c - b)) > EPS * len(c - a) * len(c - a)) break;
+    simplified.erase(simplified.begin());
+  }
+}
+
+static bool isInTriangle(glm::vec2 p, glm::vec2 a, glm::vec2 b, glm::vec2 c) {
+  return cross2(b - a, p - a) >= 0.0f && cross2(c - b, p - b) >= 0.0f && cross2(a - c, p - c) >= 0.0f;
+}
+
+// Joins a clockwise hole into the counter-clockwise polygon with a pair of
+// coincident edges to a polygon vertex it can see (Eberly's method: cast a
+// ray from the hole's rightmost point, then prefer any reflex vertex that
+// shadows the hit)
+static void bridgeHole(std::vector<glm::vec2>& polygon, const std::vector<glm::vec2>& hole) {
+  size_t m = std::max_element(hole.begin(), hole.end(), [](glm::vec2 a, glm::vec2 b) { return a.x < b.x; }) - hole.begin();
+  glm::vec2 M = hole[m];
+
+  float nearestX = std::numeric_limits<float>::max();
+  size_t visible = polygon.size();
+  size_t n = polygon.size();
+  for (size_t i = 0; i < n; ++i) {
+    glm::vec2 a = polygon[i], b = polygon[(i + 1) % n];
+    if ((a.y > M.y) == (b.y > M.y)) continue;
+    float x = a.x + (M.y - a.y) * (b.x - a.x) / (b.y - a.y);
+    if (x < M.x || x >= nearestX) continue;
+    nearestX = x;
+    visible = (a.x > b.x) ? i : (i + 1) % n;
+  }
+  if (visible == n) return;
+
+  glm::vec2 I { nearestX, M.y };
+  glm::vec2 P = polygon[visible];
+  float bestCos = -2.0f;
+  for (size_t i = 0; i < n; ++i) {
+    glm::vec2 p = polygon[i];
+    if (i == visible || p.x < M.x) continue;
+    bool reflex = cross2(p - polygon[(i + n - 1) % n], polygon[(i + 1) % n] - p) < 0.0f;
+    if (!reflex) continue;
+    bool inside = (P.y > M.y) ? isInTriangle(p, M, I, P) : isInTriangle(p, M, P, I);
+    if (!inside) continue;
+    glm::vec2 d = p - M;
+    float cosine = d.x / len(d);
+    if (cosine > bestCos) {
+      bestCos = cosine;
+      visible = i;
+    }
+  }
+
+  std::vector<glm::vec2> bridged;
+  bridged.reserve(n + hole.size() + 2);
+  bridged.insert(bridged.end(), polygon.begin(), polygon.begin() + visible + 1);
+  for (size_t i = 0; i <= hole.size(); ++i) bridged.push_back(hole[(m + i) % hole.size()]);
+  bridged.insert(bridged.end(), polygon.begin() + visible, polygon.end());
+  polygon.swap(bridged);
+}
+
+// Ear clipping. Regions are nearly always convex, where every vertex is an
+// ear and there are no reflex vertices to test against.
+static void clipEars(const std::vector<glm::vec2>& polygon, std::vector<glm::vec2>& triangles) {
+  int n = static_cast<int>(polygon.size());
+  if (n < 3) return;
+  std::vector<int> prev(n), next(n);
+  for (int i = 0; i < n; ++i) {
+    prev[i] = (i + n - 1) % n;
+    next[i] = (i + 1) % n;
+  }
+  auto isReflex = [&](int i) { return cross2(polygon[i] - polygon[prev[i]], polygon[next[i]] - polygon[i]) <= 0.0f; };
+  bool anyReflex = false;
+  for (int i = 0; i < n && !anyReflex; ++i) anyReflex = isReflex(i);
+
+  auto isEar = [&](int i) {
+    if (isReflex(i)) return false;
+    if (!anyReflex) return true;
+    glm::vec2 a = polygon[prev[i]], b = polygon[i], c = polygon[next[i]];
+    for (int j = next[next[i]]; j != prev[i]; j = next[j]) {
+      glm::vec2 p = polygon[j];
+      if (p == a || p == b || p == c) continue; // bridge ends appear twice
+      if (isReflex(j) && isInTriangle(p, a, b, c)) return false;
+    }
+    return true;
+  };
+
+  int remaining = n;
+  int i = 0;
+  int sinceLastEar = 0;
+  while (remaining > 3) {
+    if (isEar(i) || sinceLastEar > remaining) {
+      // (past a full lap without an ear the rest is degenerate; clip anyway)
+      triangles.push_back(polygon[prev[i]]);
+      triangles.push_back(polygon[i]);
+      triangles.push_back(polygon[next[i]]);
+      next[prev[i]] = next[i];
+      prev[next[i]] = prev[i];
+      --remaining;
+      sinceLastEar = 0;
+      i = prev[i];
+    } else {
+      i = next[i];
+      ++sinceLastEar;
+    }
+  }
+  triangles.push_back(polygon[prev[i]]);
+  triangles.push_back(polygon[i]);
+  triangles.push_back(polygon[next[i]]);
+}
+
+void RegionFillRenderer::triangulate(const DividedAreaRegion& region, std::vector<glm::vec2>& triangles) {
+  std::vector<glm::vec2> polygon;
+  simplifyLoop(region.outline, polygon);
+  if (polygon.size() < 3) return;
+
+  if (!region.holes.empty()) {
+    std::vector<std::vector<glm::vec2>> holes(region.holes.size());
+    for (size_t i = 0; i < holes.size(); ++i) simplifyLoop(region.holes[i], holes[i]);
+    holes.erase(std::remove_if(holes.begin(), holes.end(), [](const auto& hole) { return hole.size() < 3; }), holes.end());
+    // Rightmost first, so each bridge only has to see past the holes already joined
+    auto maxX = [](const std::vector<glm::vec2>& loop) {
+      return std::max_element(loop.begin(), loop.end(), [](glm::vec2 a, glm::vec2 b) { return a.x < b.x; })->x;
+    };
+    std::sort(holes.begin(), holes.end(), [&](const auto& a, const auto& b) { return maxX(a) > maxX(b); });
+    for (const auto& hole : holes) bridgeHole(polygon, hole);
+  }
+
+  clipEars(polygon, triangles);
+}
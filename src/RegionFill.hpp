@@ -0,0 +1,60 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "ofColor.h"
+#include "ofVbo.h"
+#include "ofBufferObject.h"
+#include "ofxDividedArea.h"
+
+struct RegionFillVertex {
+  glm::vec2 position;
+  glm::vec2 texCoord; // 0..1 across the area
+  ofFloatColor color;
+};
+
+// Fills the regions of a DividedArea (see DividedArea::getRegions) from one
+// vertex buffer with a single draw. Each region owns a slot of triangle
+// vertices; update re-triangulates only the regions whose version changed and
+// uploads just the span of the buffer those slots cover. A region that
+// outgrows its slot moves to the end of the buffer, and the buffer is packed
+// again when abandoned slots make up too much of it, or when the area's
+// regions were rebuilt.
+class RegionFillRenderer {
+public:
+  using ColorFunction = std::function<ofFloatColor(int region, const DividedAreaRegion& r)>;
+  // Called once per region each time it's re-triangulated. Defaults to white.
+  void setColorFunction(ColorFunction colorFunction);
+
+  void update(DividedArea& dividedArea);
+  // Bind a texture (or a shader) around this for textured fills
+  void draw(float scale = 1.0f) const;
+  size_t getVertexCount() const { return vertices.size(); }
+
+  // Appends the triangles covering the region: its outline less its holes
+  static void triangulate(const DividedAreaRegion& region, std::vector<glm::vec2>& triangles);
+
+private:
+  struct Slot {
+    int first = 0;
+    int capacity = 0;
+    uint64_t version = 0;
+  };
+  void layOut(const std::vector<DividedAreaRegion>& regions, glm::vec2 areaSize);
+  void fillSlot(int region, const DividedAreaRegion& r, glm::vec2 areaSize, bool allowMove);
+
+  ColorFunction colorFunction;
+  bool colorFunctionChanged = false;
+  uint64_t regionsGeneration = 0;
+  std::vector<Slot> slots; // by region id
+  std::vector<RegionFillVertex> vertices; // CPU copy of the buffer
+  int abandonedVertices = 0;
+  int dirtyBegin = 0, dirtyEnd = 0; // vertex range to upload
+  std::vector<glm::vec2> triangles;
+
+  mutable ofBufferObject buffer;
+  mutable ofVbo vbo;
+  int allocatedVertices = 0;
+};
@@ -0,0 +1,150 @@
+#include "SharedLineSet.hpp"
+#include "ofxDividedArea.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace sharedlineset;
+
+size_t sharedlineset::getSlotBytes(uint32_t constrainedLineCapacity, uint32_t majorLineCapacity) {
+  size_t bytes = constrainedLineCapacity * sizeof(ConstrainedDividerLine) + majorLineCapacity * sizeof(Line);
+  return (bytes + 63) & ~size_t(63);
+}
+
+size_t sharedlineset::getRegionBytes(uint32_t constrainedLineCapacity, uint32_t majorLineCapacity) {
+  return sizeof(Header) + 2 * getSlotBytes(constrainedLineCapacity, majorLineCapacity);
+}
+
+static const uint8_t* getSlotLines(const Header* header, int slot) {
+  return reinterpret_cast<const uint8_t*>(header) + sizeof(Header) + slot * getSlotBytes(header->constrainedLineCapacity, header->majorLineCapacity);
+}
+
+bool SharedLineSetPublisher::open(const std::string& newName, glm::vec2 areaSize, uint32_t constrainedLineCapacity, uint32_t majorLineCapacity) {
+  close();
+  // A fresh region, so readers of one left behind don't see this one's writes
+  shm_unlink(newName.c_str());
+  int fd = shm_open(newName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) return false;
+  size_t bytes = getRegionBytes(constrainedLineCapacity, majorLineCapacity);
+  void* mapped = (ftruncate(fd, bytes) == 0) ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    shm_unlink(newName.c_str());
+    return false;
+  }
+
+  header = new (mapped) Header();
+  header->lineSize = sizeof(ConstrainedDividerLine);
+  header->constrainedLineCapacity = constrainedLineCapacity;
+  header->majorLineCapacity = majorLineCapacity;
+  header->areaSize = areaSize;
+  header->publisherOpen.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, MAGIC, sizeof(header->magic));
+  name = newName;
+  regionBytes = bytes;
+  return true;
+}
+
+void SharedLineSetPublisher::close() {
+  if (!header) return;
+  header->publisherOpen.store(0, std::memory_order_release);
+  munmap(header, regionBytes);
+  shm_unlink(name.c_str());
+  header = nullptr;
+}
+
+// The slot written is the one before the latest, which readers have had a
+// whole publish to finish with
+void SharedLineSetPublisher::publish(const DividedArea& area) {
+  if (!header) return;
+  uint64_t generation = header->generation.load(std::memory_order_relaxed) + 1;
+  int slotIndex = static_cast<int>(generation % 2);
+  Slot& slot = header->slots[slotIndex];
+  uint8_t* lines = const_cast<uint8_t*>(getSlotLines(header, slotIndex));
+
+  uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const ConstrainedLineStore& constrainedLines = area.constrainedDividerLines;
+  size_t constrainedCount = std::min<size_t>(constrainedLines.size(), header->constrainedLineCapacity);
+  std::memcpy(lines, constrainedLines.data() + constrainedLines.size() - constrainedCount, constrainedCount * sizeof(ConstrainedDividerLine));
+  Line* majorLines = reinterpret_cast<Line*>(lines + header->constrainedLineCapacity * sizeof(ConstrainedDividerLine));
+  size_t majorCount = std::min<size_t>(area.unconstrainedDividerLines.size(), header->majorLineCapacity);
+  for (size_t i = 0; i < majorCount; ++i) {
+    majorLines[i] = Line { area.unconstrainedDividerLines[i].start, area.unconstrainedDividerLines[i].end };
+  }
+  slot.generation = generation;
+  slot.constrainedLineCount = static_cast<uint32_t>(constrainedCount);
+  slot.majorLineCount = static_cast<uint32_t>(majorCount);
+  slot.majorLineStyle = static_cast<int32_t>(area.getEffectiveMajorLineStyle());
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  header->generation.store(generation, std::memory_order_release);
+}
+
+bool SharedLineSetReader::open(const std::string& name) {
+  close();
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(Header))) {
+    ::close(fd);
+    return false;
+  }
+  void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) return false;
+  header = static_cast<const Header*>(mapped);
+  regionBytes = static_cast<size_t>(info.st_size);
+
+  bool valid = std::memcmp(header->magic, MAGIC, sizeof(header->magic)) == 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!valid || header->lineSize != sizeof(ConstrainedDividerLine)
+      || getRegionBytes(header->constrainedLineCapacity, header->majorLineCapacity) > regionBytes) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void SharedLineSetReader::close() {
+  if (header) munmap(const_cast<Header*>(header), regionBytes);
+  header = nullptr;
+  regionBytes = 0;
+}
+
+bool SharedLineSetReader::isPublisherOpen() const {
+  return header && header->publisherOpen.load(std::memory_order_acquire) != 0;
+}
+
+bool SharedLineSetReader::acquire(Snapshot& snapshot) const {
+  if (!header) return false;
+  uint64_t generation = header->generation.load(std::memory_order_acquire);
+  if (generation == 0) return false;
+  snapshot.slot = static_cast<int>(generation % 2);
+  const Slot& slot = header->slots[snapshot.slot];
+  snapshot.sequence = slot.sequence.load(std::memory_order_acquire);
+  if (snapshot.sequence & 1) return false;
+
+  // Clamped, so even counts torn by a publish stay inside the region
+  const uint8_t* lines = getSlotLines(header, snapshot.slot);
+  snapshot.generation = slot.generation;
+  snapshot.constrainedLines = reinterpret_cast<const ConstrainedDividerLine*>(lines);
+  snapshot.constrainedLineCount = std::min(slot.constrainedLineCount, header->constrainedLineCapacity);
+  snapshot.majorLines = reinterpret_cast<const Line*>(lines + header->constrainedLineCapacity * sizeof(ConstrainedDividerLine));
+  snapshot.majorLineCount = std::min(slot.majorLineCount, header->majorLineCapacity);
+  snapshot.majorLineStyle = static_cast<MajorLineStyle>(slot.majorLineStyle);
+  return validate(snapshot);
+}
+
+bool SharedLineSetReader::validate(const Snapshot& snapshot) const {
+  if (!header) return false;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return header->slots[snapshot.slot].sequence.load(std::memory_order_relaxed) == snapshot.sequence;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "glm/vec2.hpp"
+#include "DividerLine.hpp"
+#include "MajorLineStyle.h"
+
+class DividedArea;
+
+// An area's constrained lines and major line endpoints in POSIX shared
+// memory, for other processes (a compositor, a lighting controller) to read
+// in place each frame without copies or syscalls.
+//
+// The region is a Header and then two slots' worth of lines, each slot
+// constrainedLineCapacity ConstrainedDividerLines then majorLineCapacity
+// Lines. Publishes alternate between the slots, so the one readers are on
+// is only written again a publish later. Each slot has a seqlock sequence,
+// odd while it's being written, which a reader checks after reading the
+// lines in place to know they weren't changed under it.
+namespace sharedlineset {
+
+constexpr char MAGIC[8] = { 'D', 'I', 'V', 'S', 'H', 'M', '0', '1' };
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the seqlock must work across processes");
+
+struct alignas(64) Slot {
+  std::atomic<uint64_t> sequence;
+  uint64_t generation;
+  uint32_t constrainedLineCount;
+  uint32_t majorLineCount;
+  int32_t majorLineStyle;
+};
+
+struct alignas(64) Header {
+  char magic[8]; // written last, once the rest is set up
+  uint32_t lineSize; // sizeof(ConstrainedDividerLine), to refuse foreign layouts
+  uint32_t constrainedLineCapacity;
+  uint32_t majorLineCapacity;
+  glm::vec2 areaSize;
+  std::atomic<uint32_t> publisherOpen;
+  std::atomic<uint64_t> generation; // publishes so far; the latest is in slots[generation % 2]
+  Slot slots[2];
+};
+
+size_t getSlotBytes(uint32_t constrainedLineCapacity, uint32_t majorLineCapacity);
+size_t getRegionBytes(uint32_t constrainedLineCapacity, uint32_t majorLineCapacity);
+
+}
+
+// Creates the region and copies the area's lines into it on each publish.
+// Past constrainedLineCapacity, only the newest lines are published.
+//
+//   SharedLineSetPublisher publisher;
+//   publisher.open("/dividedarea", area.size);
+//   // each frame, after the area's updates:
+//   publisher.publish(area);
+class SharedLineSetPublisher {
+public:
+  static constexpr uint32_t DEFAULT_CONSTRAINED_LINE_CAPACITY = 10000; // maxConstrainedLines at most
+  static constexpr uint32_t DEFAULT_MAJOR_LINE_CAPACITY = 64;
+
+  SharedLineSetPublisher() = default;
+  SharedLineSetPublisher(const SharedLineSetPublisher&) = delete;
+  SharedLineSetPublisher& operator=(const SharedLineSetPublisher&) = delete;
+  ~SharedLineSetPublisher() { close(); }
+
+  // name as for shm_open ("/something"); replaces any region of that name
+  bool open(const std::string& name, glm::vec2 areaSize,
+            uint32_t constrainedLineCapacity = DEFAULT_CONSTRAINED_LINE_CAPACITY,
+            uint32_t majorLineCapacity = DEFAULT_MAJOR_LINE_CAPACITY);
+  // Unlinks the region; readers still mapping it see isPublisherOpen go false
+  void close();
+  bool isOpen() const { return header != nullptr; }
+
+  // From the thread that updates the area's geometry; not in async geometry mode
+  void publish(const DividedArea& area);
+  uint64_t getGeneration() const { return header ? header->generation.load(std::memory_order_relaxed) : 0; }
+
+private:
+  std::string name;
+  sharedlineset::Header* header = nullptr;
+  size_t regionBytes = 0;
+};
+
+// Maps a publisher's region read-only. A snapshot points straight into it:
+// acquire, read what's needed, then validate, and discard the reads if that
+// fails (the publisher lapped the reader; acquire again).
+//
+//   SharedLineSetReader reader;
+//   reader.open("/dividedarea");
+//   SharedLineSetReader::Snapshot snapshot;
+//   if (reader.acquire(snapshot)) {
+//     ... read snapshot.constrainedLines ...
+//     if (!reader.validate(snapshot)) ... discard and retry ...
+//   }
+class SharedLineSetReader {
+public:
+  struct Snapshot {
+    uint64_t generation = 0;
+    const ConstrainedDividerLine* constrainedLines = nullptr;
+    size_t constrainedLineCount = 0;
+    const Line* majorLines = nullptr;
+    size_t majorLineCount = 0;
+    MajorLineStyle majorLineStyle = MajorLineStyle::Solid;
+    // For validate
+    int slot = 0;
+    uint64_t sequence = 0;
+  };
+
+  SharedLineSetReader() = default;
+  SharedLineSetReader(const SharedLineSetReader&) = delete;
+  SharedLineSetReader& operator=(const SharedLineSetReader&) = delete;
+  ~SharedLineSetReader() { close(); }
+
+  // False if there's no such region or it isn't a publisher's
+  bool open(const std::string& name);
+  void close();
+  bool isOpen() const { return header != nullptr; }
+  // False once the publisher has closed; open again for its next region
+  bool isPublisherOpen() const;
+  glm::vec2 getAreaSize() const { return header ? header->areaSize : glm::vec2 { 0.0f, 0.0f }; }
+  uint64_t getGeneration() const { return header ? header->generation.load(std::memory_order_acquire) : 0; }
+
+  // The latest publish, in place. False before the first, or while the
+  // publisher is (rarely) still writing that slot.
+  bool acquire(Snapshot& snapshot) const;
+  // True if the snapshot's lines haven't changed since acquire
+  bool validate(const Snapshot& snapshot) const;
+
+private:
+  const sharedlineset::Header* header = nullptr;
+  size_t regionBytes = 0;
+};
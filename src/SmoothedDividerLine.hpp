@@ -40,6 +40,14 @@ public:
     // Deletion hysteresis: line must have no match for N frames before removal
     int framesWithoutMatch = 0;
     
+    // Persistent ids of the ref points this line runs between, when the input
+    // carries them (see DividedArea::IdentifiedRefPoint); -1 when untracked
+    int refId1 = -1;
+    int refId2 = -1;
+    
+    // Assigned by DividedArea when the line is added; unique among its majors
+    uint32_t serial = 0;
+    
     // Initialize from a regular DividerLine (for new lines)
     void initializeFrom(const DividerLine& dl);
     
@@ -0,0 +1,184 @@
+#include "SoftwareLineRasterizer.hpp"
+#include "GeomUtils.h"
+#include "ofImage.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+SoftwareLineRasterizer::SoftwareLineRasterizer(size_t threadCount) : pool(threadCount) {}
+
+void SoftwareLineRasterizer::allocate(int newWidth, int newHeight) {
+  width = std::max(1, newWidth);
+  height = std::max(1, newHeight);
+  pixels.allocate(width, height, OF_PIXELS_RGBA);
+  tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+  tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+  bins.assign(tilesX * tilesY, {});
+  clear();
+}
+
+void SoftwareLineRasterizer::clear(ofFloatColor color) {
+  float* p = pixels.getData();
+  for (size_t i = 0, n = static_cast<size_t>(width) * height; i < n; ++i, p += 4) {
+    p[0] = color.r;
+    p[1] = color.g;
+    p[2] = color.b;
+    p[3] = color.a;
+  }
+}
+
+ofFloatColor SoftwareLineRasterizer::getColor(int x, int y) const {
+  if (x < 0 || y < 0 || x >= width || y >= height) return ofFloatColor(0.0f, 0.0f, 0.0f, 0.0f);
+  const float* p = pixels.getData() + (static_cast<size_t>(y) * width + x) * 4;
+  return ofFloatColor(p[0], p[1], p[2], p[3]);
+}
+
+bool SoftwareLineRasterizer::save(const std::string& path) const {
+  ofPixels bytes;
+  bytes.allocate(width, height, OF_PIXELS_RGBA);
+  const float* from = pixels.getData();
+  unsigned char* to = bytes.getData();
+  for (size_t i = 0, n = static_cast<size_t>(width) * height * 4; i < n; ++i) {
+    to[i] = static_cast<unsigned char>(std::clamp(from[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+  return ofSaveImage(bytes, path);
+}
+
+void SoftwareLineRasterizer::draw(const ConstrainedDividerLine* lines, size_t count, const DividerLineShape& shape, float scale) {
+  if (bins.empty()) return;
+  quads.clear();
+  quads.reserve(count);
+  Quad quad;
+  for (size_t i = 0; i < count; ++i) {
+    if (makeQuad(lines[i], shape, scale, quad)) quads.push_back(quad);
+  }
+  binQuads();
+  pool.parallelFor(bins.size(), [this](size_t tile) { fillTile(tile); });
+}
+
+bool SoftwareLineRasterizer::makeQuad(const ConstrainedDividerLine& line, const DividerLineShape& shape, float scale, Quad& quad) const {
+  if (!(line.color.a > 0.0f)) return false;
+  DividerLineQuad shaped = shapeDividerLine(shape, line.start, line.end, line.width, line.style);
+  quad.start = shaped.start * scale;
+  quad.end = shaped.end * scale;
+  glm::vec2 d = quad.end - quad.start;
+  quad.length = glm::length(d);
+  if (!(quad.length > 0.0f)) return false; // the shader's quad is degenerate too
+  quad.along = d / quad.length;
+  quad.across = glm::vec2 { -quad.along.y, quad.along.x };
+  quad.startHalfWidth = std::fabs(shaped.startWidth * scale) * 0.5f;
+  quad.endHalfWidth = std::fabs(shaped.endWidth * scale) * 0.5f;
+  if (!(quad.startHalfWidth > 0.0f || quad.endHalfWidth > 0.0f)) return false;
+  quad.color = line.color;
+
+  glm::vec2 startAcross = quad.across * (quad.startHalfWidth + 1.0f);
+  glm::vec2 endAcross = quad.across * (quad.endHalfWidth + 1.0f);
+  quad.corners[0] = quad.start - quad.along - startAcross;
+  quad.corners[1] = quad.end + quad.along - endAcross;
+  quad.corners[2] = quad.end + quad.along + endAcross;
+  quad.corners[3] = quad.start - quad.along + startAcross;
+  quad.boundsMin = quad.boundsMax = quad.corners[0];
+  for (const auto& corner : quad.corners) {
+    quad.boundsMin = glm::min(quad.boundsMin, corner);
+    quad.boundsMax = glm::max(quad.boundsMax, corner);
+  }
+  return quad.boundsMax.x > 0.0f && quad.boundsMax.y > 0.0f && quad.boundsMin.x < width && quad.boundsMin.y < height;
+}
+
+void SoftwareLineRasterizer::binQuads() {
+  for (auto& bin : bins) bin.clear();
+  // Long diagonal lines have bounds covering many tiles they never come near
+  const float tileReach = TILE_SIZE * 0.7072f;
+  for (uint32_t i = 0; i < quads.size(); ++i) {
+    const Quad& quad = quads[i];
+    int tx0 = std::clamp(static_cast<int>(quad.boundsMin.x) / TILE_SIZE, 0, tilesX - 1);
+    int tx1 = std::clamp(static_cast<int>(quad.boundsMax.x) / TILE_SIZE, 0, tilesX - 1);
+    int ty0 = std::clamp(static_cast<int>(quad.boundsMin.y) / TILE_SIZE, 0, tilesY - 1);
+    int ty1 = std::clamp(static_cast<int>(quad.boundsMax.y) / TILE_SIZE, 0, tilesY - 1);
+    float reach = tileReach + std::max(quad.startHalfWidth, quad.endHalfWidth) + 1.5f;
+    bool oneTileWide = (tx0 == tx1 || ty0 == ty1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        glm::vec2 tileCenter { (tx + 0.5f) * TILE_SIZE, (ty + 0.5f) * TILE_SIZE };
+        if (!oneTileWide && geom::pointToSegmentDistance(tileCenter, quad.start, quad.end) > reach) continue;
+        bins[ty * tilesX + tx].push_back(i);
+      }
+    }
+  }
+}
+
+// The x extent within the band y0..y1 of a convex polygon, which is that of
+// its edges within the band
+static bool rowExtent(const glm::vec2 (&corners)[4], float y0, float y1, float& xMin, float& xMax) {
+  xMin = std::numeric_limits<float>::max();
+  xMax = std::numeric_limits<float>::lowest();
+  for (int i = 0; i < 4; ++i) {
+    glm::vec2 a = corners[i], b = corners[(i + 1) % 4];
+    float low = std::min(a.y, b.y), high = std::max(a.y, b.y);
+    if (high < y0 || low > y1) continue;
+    if (a.y == b.y) {
+      xMin = std::min(xMin, std::min(a.x, b.x));
+      xMax = std::max(xMax, std::max(a.x, b.x));
+      continue;
+    }
+    for (float y : { std::clamp(y0, low, high), std::clamp(y1, low, high) }) {
+      float x = a.x + (b.x - a.x) * (y - a.y) / (b.y - a.y);
+      xMin = std::min(xMin, x);
+      xMax = std::max(xMax, x);
+    }
+  }
+  return xMin <= xMax;
+}
+
+void SoftwareLineRasterizer::fillTile(size_t tile) {
+  int tileX0 = static_cast<int>(tile % tilesX) * TILE_SIZE;
+  int tileY0 = static_cast<int>(tile / tilesX) * TILE_SIZE;
+  int tileX1 = std::min(width, tileX0 + TILE_SIZE);
+  int tileY1 = std::min(height, tileY0 + TILE_SIZE);
+  for (uint32_t index : bins[tile]) {
+    const Quad& quad = quads[index];
+    int y0 = std::max(tileY0, static_cast<int>(std::floor(quad.boundsMin.y)));
+    int y1 = std::min(tileY1, static_cast<int>(std::ceil(quad.boundsMax.y)));
+    for (int y = y0; y < y1; ++y) {
+      float xMin, xMax;
+      if (!rowExtent(quad.corners, static_cast<float>(y), static_cast<float>(y + 1), xMin, xMax)) continue;
+      int x0 = std::max(tileX0, static_cast<int>(std::floor(xMin)));
+      int x1 = std::min(tileX1, static_cast<int>(std::ceil(xMax)));
+      if (x0 < x1) fillSpan(quad, y, x0, x1);
+    }
+  }
+}
+
+// By value, unlike std::min etc, so loops using them vectorise
+static inline float minf(float a, float b) { return (a < b) ? a : b; }
+static inline float maxf(float a, float b) { return (a > b) ? a : b; }
+static inline float clamp01(float v) { return minf(maxf(v, 0.0f), 1.0f); }
+
+// Coverage is the overlap of the pixel's extent with the line's, across and
+// along the line separately, which is exact for axis-aligned lines. Spans
+// never cross a tile, so the coverage fits a fixed array; both loops are
+// branch-free so the compiler can vectorise them.
+void SoftwareLineRasterizer::fillSpan(const Quad& quad, int y, int x0, int x1) {
+  float coverage[TILE_SIZE];
+  glm::vec2 d = glm::vec2 { x0 + 0.5f, y + 0.5f } - quad.start;
+  const float u0 = glm::dot(d, quad.along), s0 = glm::dot(d, quad.across);
+  const float du = quad.along.x, ds = quad.across.x;
+  const float length = quad.length, invLength = 1.0f / quad.length;
+  const float halfWidth0 = quad.startHalfWidth, halfWidthSlope = quad.endHalfWidth - quad.startHalfWidth;
+  const float alpha = quad.color.a;
+  const int count = x1 - x0;
+  for (int i = 0; i < count; ++i) {
+    float u = u0 + du * i, s = s0 + ds * i;
+    float alongCoverage = clamp01(minf(u + 0.5f, length) - maxf(u - 0.5f, 0.0f));
+    float halfWidth = halfWidth0 + halfWidthSlope * clamp01(u * invLength);
+    float acrossCoverage = clamp01(minf(s + 0.5f, halfWidth) - maxf(s - 0.5f, -halfWidth));
+    coverage[i] = alpha * alongCoverage * acrossCoverage;
+  }
+
+  // Alpha blending, with the destination alpha accumulating as src + dst * (1 - src)
+  const float color[4] = { quad.color.r, quad.color.g, quad.color.b, 1.0f };
+  float* p = pixels.getData() + (static_cast<size_t>(y) * width + x0) * 4;
+  for (int i = 0; i < count; ++i) {
+    for (int c = 0; c < 4; ++c) p[i * 4 + c] += (color[c] - p[i * 4 + c]) * coverage[i];
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "ofColor.h"
+#include "ofPixels.h"
+#include "DividerLine.hpp"
+#include "DividerLineShape.h"
+#include "WorkStealingPool.hpp"
+
+// Draws constrained lines into an RGBA float buffer on the CPU, for rendering
+// without a GL context (render nodes, CI). Each line takes the shape
+// DividerLineShader would give it (see shapeDividerLine) and is blended as
+// OF_BLENDMODE_ALPHA blends, but with anti-aliased edges: a pixel's coverage
+// is how much of its square the line's quad overlaps, across and along the
+// line.
+//
+// The buffer is split into square tiles and each line is binned into the
+// tiles it can touch; the tiles are then filled in parallel, each drawing its
+// lines in order, so the result doesn't depend on the thread count.
+//
+//   SoftwareLineRasterizer rasterizer;
+//   rasterizer.allocate(1024, 1024);
+//   rasterizer.draw(area.constrainedDividerLines, area.getDividerLineShape(), 1024.0f);
+//   rasterizer.save("still.png");
+class SoftwareLineRasterizer {
+public:
+  static constexpr int TILE_SIZE = 64;
+
+  // threadCount as for WorkStealingPool
+  explicit SoftwareLineRasterizer(size_t threadCount = 0);
+
+  void allocate(int width, int height);
+  void clear(ofFloatColor color = ofFloatColor(0.0f, 0.0f, 0.0f, 0.0f));
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+
+  // Positions and widths are multiplied by scale to give pixels, as
+  // drawInstanced's scale does
+  void draw(const ConstrainedDividerLine* lines, size_t count, const DividerLineShape& shape, float scale = 1.0f);
+  void draw(const ConstrainedDividerLines& lines, const DividerLineShape& shape, float scale = 1.0f) { draw(lines.data(), lines.size(), shape, scale); }
+  void draw(const ConstrainedLineStore& lines, const DividerLineShape& shape, float scale = 1.0f) { draw(lines.data(), lines.size(), shape, scale); }
+
+  const ofFloatPixels& getPixels() const { return pixels; }
+  ofFloatColor getColor(int x, int y) const;
+  // Clamped to 8 bits a channel, in whatever format the path's extension names
+  bool save(const std::string& path) const;
+
+private:
+  struct Quad {
+    glm::vec2 start, end; // in pixels
+    glm::vec2 along, across; // unit
+    float length;
+    float startHalfWidth, endHalfWidth;
+    ofFloatColor color;
+    glm::vec2 corners[4]; // padded by a pixel all round
+    glm::vec2 boundsMin, boundsMax;
+  };
+
+  bool makeQuad(const ConstrainedDividerLine& line, const DividerLineShape& shape, float scale, Quad& quad) const;
+  void binQuads();
+  void fillTile(size_t tile);
+  void fillSpan(const Quad& quad, int y, int x0, int x1);
+
+  WorkStealingPool pool;
+  ofFloatPixels pixels;
+  int width = 0, height = 0;
+  int tilesX = 0, tilesY = 0;
+  std::vector<Quad> quads;
+  std::vector<std::vector<uint32_t>> bins; // quad indices by tile, in draw order
+};
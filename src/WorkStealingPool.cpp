@@ -0,0 +1,120 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t threadCount) {
+  if (threadCount == 0) {
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    threadCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+  }
+  for (size_t i = 0; i < threadCount + 1; ++i) {
+    queues.push_back(std::make_unique<TaskQueue>());
+  }
+  for (size_t i = 0; i < threadCount; ++i) {
+    workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stopping = true;
+  }
+  wakeCondition.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+  if (count == 0) return;
+  if (workers.empty() || count == 1) {
+    for (size_t i = 0; i < count; ++i) fn(i);
+    return;
+  }
+
+  std::lock_guard<std::mutex> jobLock(jobMutex);
+  job = &fn;
+  remaining.store(count);
+  failed.store(false);
+
+  // Deal tasks round-robin so every thread starts with local work
+  for (size_t i = 0; i < count; ++i) {
+    auto& queue = *queues[i % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(i);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    ++generation;
+  }
+  wakeCondition.notify_all();
+
+  // The caller works too, then waits for stragglers still running stolen tasks
+  runTasks(queues.size() - 1);
+  {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    doneCondition.wait(lock, [&]{ return remaining.load() == 0; });
+  }
+  job = nullptr;
+  if (failed.load()) {
+    std::exception_ptr thrown;
+    std::swap(thrown, exception);
+    std::rethrow_exception(thrown);
+  }
+}
+
+void WorkStealingPool::workerLoop(size_t queueIndex) {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(wakeMutex);
+      wakeCondition.wait(lock, [&]{ return stopping || generation != seenGeneration; });
+      if (stopping) return;
+      seenGeneration = generation;
+    }
+    runTasks(queueIndex);
+  }
+}
+
+void WorkStealingPool::runTasks(size_t queueIndex) {
+  size_t task;
+  while (popOrSteal(queueIndex, task)) {
+    // Caught here so the count still reaches zero; parallelFor rethrows it
+    if (!failed.load(std::memory_order_relaxed)) {
+      try {
+        (*job)(task);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(exceptionMutex);
+        if (!failed.exchange(true)) exception = std::current_exception();
+      }
+    }
+    if (remaining.fetch_sub(1) == 1) {
+      std::lock_guard<std::mutex> lock(wakeMutex);
+      doneCondition.notify_all();
+    }
+  }
+}
+
+// Own queue from the back (most recently dealt), others from the front
+bool WorkStealingPool::popOrSteal(size_t queueIndex, size_t& task) {
+  {
+    auto& own = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t offset = 1; offset < queues.size(); ++offset) {
+    auto& victim = *queues[(queueIndex + offset) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small fixed-size thread pool for fork/join CPU work (no GL).
+//
+// parallelFor() deals task indices round-robin onto one deque per worker (plus
+// one for the calling thread, which also does work). Each thread pops from the
+// back of its own deque and, when that runs dry, steals from the front of the
+// others. That keeps uneven tasks (e.g. one busy DividedArea among many idle
+// ones) from leaving cores idle at the end of a frame.
+//
+// Only one parallelFor() runs at a time; concurrent callers are serialised.
+class WorkStealingPool {
+public:
+  // threadCount = 0 uses std::thread::hardware_concurrency() - 1 workers (the
+  // calling thread makes up the last one).
+  explicit WorkStealingPool(size_t threadCount = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  size_t getThreadCount() const { return workers.size(); }
+
+  // Runs fn(i) for every i in [0, count) and returns when all have completed.
+  // Tasks with different i must not share mutable state. If fn throws, the
+  // tasks not yet started are skipped, and the first exception is rethrown
+  // here once those already running have finished.
+  void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  void workerLoop(size_t queueIndex);
+  void runTasks(size_t queueIndex);
+  bool popOrSteal(size_t queueIndex, size_t& task);
+
+  std::vector<std::thread> workers;
+  std::vector<std::unique_ptr<TaskQueue>> queues; // one per worker, last one for the caller
+
+  std::mutex jobMutex; // serialises parallelFor calls
+  const std::function<void(size_t)>* job = nullptr;
+  std::atomic<size_t> remaining { 0 };
+  std::atomic<bool> failed { false };
+  std::mutex exceptionMutex;
+  std::exception_ptr exception; // the first fn threw
+
+  std::mutex wakeMutex;
+  std::condition_variable wakeCondition;
+  std::condition_variable doneCondition;
+  uint64_t generation = 0;
+  bool stopping = false;
+};
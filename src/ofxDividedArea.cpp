@@ -5,7 +5,12 @@
 #include "ofMain.h"
 #include "LineGeom.h"
 #include "GeomUtils.h"
+#include "InputLog.hpp"
 #include <algorithm>
+#include <chrono>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 static constexpr int ATTR_LOC_POS = 0;
 static constexpr int ATTR_LOC_P0 = 1;
@@ -14,6 +19,33 @@ static constexpr int ATTR_LOC_WIDTH = 3;
 static constexpr int ATTR_LOC_STYLE = 4;
 static constexpr int ATTR_LOC_COLOR = 5;
 
+// Adds the time spent in its scope to the frame's cost while adaptive quality is on
+struct DividedArea::QualityCostTimer {
+  using Clock = std::chrono::steady_clock;
+  std::atomic<int64_t>* cost;
+  Clock::time_point start;
+  explicit QualityCostTimer(const DividedArea& area)
+      : cost(area.isAdaptiveQuality() ? &area.qualityFrameCost : nullptr),
+        start(cost ? Clock::now() : Clock::time_point {}) {}
+  ~QualityCostTimer() {
+    if (!cost) return;
+    cost->fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(), std::memory_order_relaxed);
+  }
+};
+
+// Hands the recorder, if any, to the outermost geometry call only
+struct DividedArea::InputRecordScope {
+  DividedArea& area;
+  explicit InputRecordScope(DividedArea& area_) : area(area_) { ++area.inputCallDepth; }
+  ~InputRecordScope() { --area.inputCallDepth; }
+  InputLogRecorder* getRecorder() const { return (area.inputCallDepth == 1) ? area.inputRecorder : nullptr; }
+};
+
+void DividedArea::setInputRecorder(InputLogRecorder* recorder) {
+  inputRecorder = recorder;
+  if (recorder) evictionRandom.seed(std::minstd_rand::default_seed);
+}
+
 ofParameterGroup& DividedArea::getParameterGroup() {
   if (parameters.size() == 0) {
     parameters.setName(getParameterGroupName());
@@ -25,6 +57,12 @@ ofParameterGroup& DividedArea::getParameterGroup() {
     parameters.add(constrainedOcclusionDistanceParameter);
     parameters.add(occlusionAngleParameter);
     parameters.add(maxConstrainedLinesParameter);
+    parameters.add(constrainedEvictionPolicyParameter);
+    parameters.add(densityGridResolutionParameter);
+    parameters.add(densitySaturationParameter);
+    parameters.add(maxInsertionAgeParameter);
+    parameters.add(maxInsertionAttemptsParameter);
+    parameters.add(frameTimeTargetParameter);
     parameters.add(maxTaperLengthParameter);
     parameters.add(minWidthFactorStartParameter);
     parameters.add(maxWidthFactorStartParameter);
@@ -39,6 +77,9 @@ ofParameterGroup& DividedArea::getParameterGroup() {
     parameters.add(linePositionEdgeFactorParameter);
     parameters.add(linePositionCenterFactorParameter);
     parameters.add(constrainedWidthParameter);
+    parameters.add(constrainedOcclusionModeParameter);
+    parameters.add(occlusionRasterResolutionParameter);
+    parameters.add(occlusionRasterCoverageParameter);
     parameters.add(majorLineStyleParameter);
     
     // Add nested shader parameter groups
@@ -57,7 +98,15 @@ size(size_),
 maxUnconstrainedDividerLines(maxUnconstrainedDividerLines_)
 {
   setupInstancedDraw(maxConstrainedLinesParameter);
+  densityGrid.reset(size, densityGridResolutionParameter);
   shader.load();
+  for (ofParameter<float>* shapeParameter : { &maxTaperLengthParameter, &minWidthFactorStartParameter, &maxWidthFactorStartParameter,
+                                              &minWidthFactorEndParameter, &maxWidthFactorEndParameter, &edgeFadeWidthParameter,
+                                              &edgeWidthFactorParameter, &centerWidthFactorParameter, &extendBeyondCanvasParameter,
+                                              &lineLengthMinFactorParameter, &linePositionFadeWidthParameter,
+                                              &linePositionEdgeFactorParameter, &linePositionCenterFactorParameter }) {
+    shapeParameterListeners.push(shapeParameter->newListener([this](float&) { shapeBufferStale = true; }));
+  }
   
   // Create and load all style shaders upfront so their parameters are available
   solidLineShader = std::make_unique<SolidLineShader>();
@@ -97,6 +146,8 @@ float DividedArea::getUnconstrainedSmoothnessEffective() const {
 }
 
 bool DividedArea::addUnconstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2) {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordUnconstrainedDividerLine(ref1, ref2);
   if (maxUnconstrainedDividerLines < 0 || static_cast<int>(unconstrainedDividerLines.size()) >= maxUnconstrainedDividerLines) return false;
   if (ref1 == ref2) return false;
   
@@ -109,7 +160,9 @@ bool DividedArea::addUnconstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2) {
   
   SmoothedDividerLine smoothedLine;
   smoothedLine.initializeFrom(dividerLine);
+  smoothedLine.serial = nextMajorSerial++;
   unconstrainedDividerLines.push_back(smoothedLine);
+  onMajorLinesChanged();
   return true;
 }
 
@@ -128,25 +181,62 @@ bool DividedArea::addUnconstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2) {
 // being removed, preventing flicker during brief cluster instability.
 template<typename PT, typename A>
 bool DividedArea::updateUnconstrainedDividerLines(const std::vector<PT, A>& majorRefPoints) {
-  float occlusionDistance = unconstrainedOcclusionDistanceParameter * size.x;
+  return updateUnconstrainedDividerLines(geom::PointView(majorRefPoints), getFrameDeltaTime());
+}
+
+template<typename PT, typename A>
+bool DividedArea::updateUnconstrainedDividerLines(const std::vector<PT, A>& majorRefPoints, float dt) {
+  return updateUnconstrainedDividerLines(geom::PointView(majorRefPoints), dt);
+}
+
+bool DividedArea::updateUnconstrainedDividerLines(geom::PointView majorRefPoints) {
+  return updateUnconstrainedDividerLines(majorRefPoints, getFrameDeltaTime());
+}
+
+// Frame-rate independent physics
+float DividedArea::getFrameDeltaTime() {
+  float dt = ofGetLastFrameTime();
+  if (dt <= 0.0f || dt > 0.1f) dt = 1.0f / 60.0f; // clamp to reasonable range
+  return dt;
+}
+
+DividedArea::MajorLineTracking DividedArea::getMajorLineTracking(float dt) const {
+  MajorLineTracking tracking;
   float closePointDistance = closePointDistanceParameter * size.x;
-  float endpointMatchThreshold2 = closePointDistance * closePointDistance * 4.0f; // squared threshold for endpoint matching
-  float minRefPointDistance = minRefPointDistanceParameter * size.x;
+  tracking.occlusionDistance = unconstrainedOcclusionDistanceParameter * size.x;
+  tracking.endpointMatchThreshold2 = closePointDistance * closePointDistance * 4.0f;
+  tracking.minRefPointDistance = minRefPointDistanceParameter * size.x;
   
   // Stability radius for zone-based hysteresis: proposals within this distance
   // of the zone center are accumulated for centroid calculation
-  float stabilityRadius = closePointDistance * 0.5f;
+  tracking.stabilityRadius = closePointDistance * 0.5f;
   
   // Get smoothing parameters from the single smoothness control
   float smoothness = getUnconstrainedSmoothnessEffective();
-  float springStrength = SmoothedDividerLine::smoothnessToSpringStrength(smoothness);
-  float damping = SmoothedDividerLine::smoothnessToDamping(smoothness);
-  int hysteresisFrames = SmoothedDividerLine::smoothnessToHysteresisFrames(smoothness);
-  int deleteHysteresisFrames = SmoothedDividerLine::smoothnessToDeleteHysteresisFrames(smoothness);
+  tracking.springStrength = SmoothedDividerLine::smoothnessToSpringStrength(smoothness);
+  tracking.damping = SmoothedDividerLine::smoothnessToDamping(smoothness);
+  tracking.hysteresisFrames = SmoothedDividerLine::smoothnessToHysteresisFrames(smoothness);
+  tracking.deleteHysteresisFrames = SmoothedDividerLine::smoothnessToDeleteHysteresisFrames(smoothness);
   
-  // Frame-rate independent physics
-  float dt = ofGetLastFrameTime();
   if (dt <= 0.0f || dt > 0.1f) dt = 1.0f / 60.0f; // clamp to reasonable range
+  tracking.dt = dt;
+  return tracking;
+}
+
+bool DividedArea::updateUnconstrainedDividerLines(geom::PointView majorRefPoints, float dt) {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordMajorRefPoints(majorRefPoints, dt);
+  QualityCostTimer timer(*this);
+  const MajorLineTracking tracking = getMajorLineTracking(dt);
+  float occlusionDistance = tracking.occlusionDistance;
+  float endpointMatchThreshold2 = tracking.endpointMatchThreshold2;
+  float minRefPointDistance = tracking.minRefPointDistance;
+  float stabilityRadius = tracking.stabilityRadius;
+  float springStrength = tracking.springStrength;
+  float damping = tracking.damping;
+  int hysteresisFrames = tracking.hysteresisFrames;
+  int deleteHysteresisFrames = tracking.deleteHysteresisFrames;
+  dt = tracking.dt;
   
   bool linesChanged = false;
   
@@ -161,9 +251,9 @@ bool DividedArea::updateUnconstrainedDividerLines(const std::vector<PT, A>& majo
   candidates.reserve(majorRefPoints.size() * (majorRefPoints.size() - 1) / 2);
   
   for (size_t i = 0; i < majorRefPoints.size(); ++i) {
+    glm::vec2 r1 = majorRefPoints[i];
     for (size_t j = i + 1; j < majorRefPoints.size(); ++j) {
-      glm::vec2 r1 = glm::vec2(majorRefPoints[i]);
-      glm::vec2 r2 = glm::vec2(majorRefPoints[j]);
+      glm::vec2 r2 = majorRefPoints[j];
       if (r1 == r2) continue;
       
       Line enclosed = DividerLine::findEnclosedLine(r1, r2, areaConstraints);
@@ -220,6 +310,7 @@ bool DividedArea::updateUnconstrainedDividerLines(const std::vector<PT, A>& majo
       // Update ref points to track the new candidate
       line.ref1 = bestCandidate->ref1;
       line.ref2 = bestCandidate->ref2;
+      line.refId1 = line.refId2 = -1;
       
       // Propose new target (subject to zone-based hysteresis)
       line.proposeTarget(targetStart, targetEnd, stabilityRadius);
@@ -265,6 +356,7 @@ bool DividedArea::updateUnconstrainedDividerLines(const std::vector<PT, A>& majo
       if (!newLine.isOccludedByAnyOf(unconstrainedDividerLines, occlusionDistance, occlusionAngleParameter)) {
         SmoothedDividerLine smoothedLine;
         smoothedLine.initializeFrom(newLine);
+        smoothedLine.serial = nextMajorSerial++;
         unconstrainedDividerLines.push_back(smoothedLine);
         linesChanged = true;
         break; // add max one per call
@@ -272,63 +364,878 @@ bool DividedArea::updateUnconstrainedDividerLines(const std::vector<PT, A>& majo
     }
   }
   
+  if (linesChanged) onMajorLinesChanged();
+  return linesChanged;
+}
+
+static uint64_t refIdPairKey(int id1, int id2) {
+  if (id1 > id2) std::swap(id1, id2);
+  return (static_cast<uint64_t>(static_cast<uint32_t>(id1)) << 32) | static_cast<uint32_t>(id2);
+}
+
+// Same physics and hysteresis as the id-less update; only the matching differs.
+bool DividedArea::updateUnconstrainedDividerLines(const std::vector<IdentifiedRefPoint>& majorRefPoints, float dt) {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordIdentifiedRefPoints(majorRefPoints, dt);
+  QualityCostTimer timer(*this);
+  const MajorLineTracking tracking = getMajorLineTracking(dt);
+  bool linesChanged = false;
+  
+  std::unordered_map<int, glm::vec2> positionsById;
+  positionsById.reserve(majorRefPoints.size());
+  for (const auto& refPoint : majorRefPoints) {
+    positionsById.emplace(refPoint.id, refPoint.position);
+  }
+  
+  auto enclose = [&](glm::vec2 r1, glm::vec2 r2, Line& enclosed) {
+    if (r1 == r2) return false;
+    enclosed = DividerLine::findEnclosedLine(r1, r2, areaConstraints);
+    return !(enclosed.start == longestLine.start && enclosed.end == longestLine.end);
+  };
+  
+  struct Match {
+    bool found = false;
+    int id1, id2;
+    glm::vec2 ref1, ref2;
+    Line enclosed;
+  };
+  std::vector<Match> matches(unconstrainedDividerLines.size());
+  std::unordered_set<uint64_t> trackedPairs;
+  
+  // 1. Lines whose ref point ids are both still present: direct lookup
+  bool anyUnmatched = false;
+  for (size_t i = 0; i < unconstrainedDividerLines.size(); ++i) {
+    const auto& line = unconstrainedDividerLines[i];
+    Match& match = matches[i];
+    if (line.refId1 >= 0 && line.refId2 >= 0) {
+      auto p1 = positionsById.find(line.refId1);
+      auto p2 = positionsById.find(line.refId2);
+      if (p1 != positionsById.end() && p2 != positionsById.end()
+          && trackedPairs.insert(refIdPairKey(line.refId1, line.refId2)).second) {
+        match = { true, line.refId1, line.refId2, p1->second, p2->second, Line {} };
+        if (!enclose(match.ref1, match.ref2, match.enclosed)) match.found = false;
+      }
+    }
+    anyUnmatched = anyUnmatched || !match.found;
+  }
+  
+  // 2. Endpoint matching, as in the id-less update, for the rest against the
+  // pairs no line is tracking
+  if (anyUnmatched) {
+    struct CandidateLine {
+      int id1, id2;
+      glm::vec2 ref1, ref2;
+      Line enclosed;
+      bool used = false;
+    };
+    std::vector<CandidateLine> candidates;
+    for (size_t i = 0; i < majorRefPoints.size(); ++i) {
+      for (size_t j = i + 1; j < majorRefPoints.size(); ++j) {
+        const auto& a = majorRefPoints[i];
+        const auto& b = majorRefPoints[j];
+        if (trackedPairs.count(refIdPairKey(a.id, b.id))) continue;
+        CandidateLine candidate { a.id, b.id, a.position, b.position, Line {}, false };
+        if (enclose(a.position, b.position, candidate.enclosed)) candidates.push_back(candidate);
+      }
+    }
+    for (size_t i = 0; i < unconstrainedDividerLines.size(); ++i) {
+      if (matches[i].found) continue;
+      const auto& line = unconstrainedDividerLines[i];
+      float bestScore = std::numeric_limits<float>::max();
+      CandidateLine* bestCandidate = nullptr;
+      for (auto& candidate : candidates) {
+        if (candidate.used) continue;
+        float score = std::min(glm::distance2(line.start, candidate.enclosed.start) + glm::distance2(line.end, candidate.enclosed.end),
+                               glm::distance2(line.start, candidate.enclosed.end) + glm::distance2(line.end, candidate.enclosed.start));
+        if (score < bestScore) {
+          bestScore = score;
+          bestCandidate = &candidate;
+        }
+      }
+      if (bestCandidate && bestScore < tracking.endpointMatchThreshold2) {
+        bestCandidate->used = true;
+        trackedPairs.insert(refIdPairKey(bestCandidate->id1, bestCandidate->id2));
+        matches[i] = { true, bestCandidate->id1, bestCandidate->id2, bestCandidate->ref1, bestCandidate->ref2, bestCandidate->enclosed };
+      }
+    }
+  }
+  
+  // 3. Apply matches with physics, occlusion and deletion hysteresis
+  int keptCount = 0;
+  size_t matchIndex = 0;
+  for (auto iter = unconstrainedDividerLines.begin(); iter != unconstrainedDividerLines.end(); ++matchIndex) {
+    if (maxUnconstrainedDividerLines >= 0 && keptCount >= maxUnconstrainedDividerLines) {
+      iter = unconstrainedDividerLines.erase(iter);
+      linesChanged = true;
+      continue;
+    }
+    
+    auto& line = *iter;
+    const Match& match = matches[matchIndex];
+    if (match.found) {
+      // Keep the line's orientation so its endpoints don't swap over
+      bool flipped = glm::distance2(line.start, match.enclosed.end) + glm::distance2(line.end, match.enclosed.start)
+          < glm::distance2(line.start, match.enclosed.start) + glm::distance2(line.end, match.enclosed.end);
+      line.refId1 = match.id1;
+      line.refId2 = match.id2;
+      line.ref1 = match.ref1;
+      line.ref2 = match.ref2;
+      line.proposeTarget(flipped ? match.enclosed.end : match.enclosed.start,
+                         flipped ? match.enclosed.start : match.enclosed.end,
+                         tracking.stabilityRadius);
+      line.updateSmoothed(tracking.dt, tracking.springStrength, tracking.damping, tracking.hysteresisFrames,
+                          glm::distance(match.ref1, match.ref2), tracking.minRefPointDistance);
+      
+      if (line.isOccludedByAnyOf(unconstrainedDividerLines, tracking.occlusionDistance, occlusionAngleParameter)) {
+        iter = unconstrainedDividerLines.erase(iter);
+        linesChanged = true;
+        continue;
+      }
+      
+      linesChanged = true;
+      ++keptCount;
+      ++iter;
+    } else {
+      line.framesWithoutMatch++;
+      
+      if (line.framesWithoutMatch >= tracking.deleteHysteresisFrames) {
+        iter = unconstrainedDividerLines.erase(iter);
+        linesChanged = true;
+      } else {
+        line.updateSmoothed(tracking.dt, tracking.springStrength, tracking.damping, tracking.hysteresisFrames,
+                            tracking.minRefPointDistance, tracking.minRefPointDistance);
+        ++keptCount;
+        ++iter;
+      }
+    }
+  }
+  
+  // 4. Add one new line from the first untracked pair that fits (if under max)
+  if (maxUnconstrainedDividerLines < 0 || static_cast<int>(unconstrainedDividerLines.size()) < maxUnconstrainedDividerLines) {
+    for (size_t i = 0; i < majorRefPoints.size(); ++i) {
+      for (size_t j = i + 1; j < majorRefPoints.size(); ++j) {
+        const auto& a = majorRefPoints[i];
+        const auto& b = majorRefPoints[j];
+        if (trackedPairs.count(refIdPairKey(a.id, b.id))) continue;
+        Line enclosed;
+        if (!enclose(a.position, b.position, enclosed)) continue;
+        
+        DividerLine newLine { a.position, b.position, enclosed.start, enclosed.end };
+        if (!newLine.isOccludedByAnyOf(unconstrainedDividerLines, tracking.occlusionDistance, occlusionAngleParameter)) {
+          SmoothedDividerLine smoothedLine;
+          smoothedLine.initializeFrom(newLine);
+          smoothedLine.refId1 = a.id;
+          smoothedLine.refId2 = b.id;
+          smoothedLine.serial = nextMajorSerial++;
+          unconstrainedDividerLines.push_back(smoothedLine);
+          onMajorLinesChanged();
+          return true; // add max one per call
+        }
+      }
+    }
+  }
+  
+  if (linesChanged) onMajorLinesChanged();
   return linesChanged;
 }
 
 template bool DividedArea::updateUnconstrainedDividerLines<glm::vec2>(const std::vector<glm::vec2>& majorRefPoints);
 template bool DividedArea::updateUnconstrainedDividerLines<glm::vec3>(const std::vector<glm::vec3>& majorRefPoints);
 template bool DividedArea::updateUnconstrainedDividerLines<glm::vec4>(const std::vector<glm::vec4>& majorRefPoints);
+template bool DividedArea::updateUnconstrainedDividerLines<glm::vec2>(const std::vector<glm::vec2>& majorRefPoints, float dt);
+template bool DividedArea::updateUnconstrainedDividerLines<glm::vec3>(const std::vector<glm::vec3>& majorRefPoints, float dt);
+template bool DividedArea::updateUnconstrainedDividerLines<glm::vec4>(const std::vector<glm::vec4>& majorRefPoints, float dt);
 
 void DividedArea::clearConstrainedDividerLines() {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordClearConstrainedDividerLines();
   constrainedDividerLines.clear();
+  constrainedLineSerials.clear();
+  constrainedLinesInSerialOrder = true;
+  constrainedLineSlots.clear();
+  firstPendingSlot = 0;
+  densityGrid.clear();
+  if (occlusionRasterCurrent) occlusionRaster.clear();
+  constrainedLineSupports.clear();
+  invalidateSubdivision();
+  markConstrainedLinesChanged(0);
 }
 
 void DividedArea::deleteEarlyConstrainedDividerLines(size_t count) {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordDeleteEarlyConstrainedDividerLines(count);
   if (count == 0) return;
   if (count > constrainedDividerLines.size()) count = constrainedDividerLines.size();
-  constrainedDividerLines.erase(constrainedDividerLines.begin(),
-                                constrainedDividerLines.begin() + count);
-  // Also advance the instance ring buffer past the removed entries — the
-  // instance buffer holds only constrained lines (major lines render from
-  // unconstrainedDividerLines directly), and addConstrainedDividerLine
-  // appends to both vector and ring in lockstep, so removing the front N
-  // from the vector matches removing the front N from the ring.
-  // Without this, deleted lines would keep being drawn each frame until
-  // the ring naturally wrapped.
-  if (instanceCount > 0 && instanceCapacity > 0) {
-    int toRemove = static_cast<int>(std::min<size_t>(count, static_cast<size_t>(instanceCount)));
-    head = (head + toRemove) % instanceCapacity;
-    instanceCount -= toRemove;
-    instancesDirty = true;
+  // The oldest have to be at the front
+  restoreConstrainedLineOrder();
+  for (size_t i = 0; i < count; ++i) {
+    const ConstrainedDividerLine& dl = constrainedDividerLines[i];
+    if (occlusionRasterCurrent) occlusionRaster.removeLine(dl.start, dl.end);
+    densityGrid.removeLine(dl.start, dl.end, constrainedLineSerials[i]);
+  }
+  eraseFrontConstrainedLineSlots(count);
+  invalidateSubdivision();
+}
+
+void DividedArea::evictConstrainedDividerLine(size_t index) {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordEvictConstrainedDividerLine(index);
+  if (index >= constrainedDividerLines.size()) return;
+  const ConstrainedDividerLine& dl = constrainedDividerLines[index];
+  if (occlusionRasterCurrent) occlusionRaster.removeLine(dl.start, dl.end);
+  densityGrid.removeLine(dl.start, dl.end, constrainedLineSerials[index]);
+  if (index > 0) {
+    // The front line fills the gap, so only it moves, rather than everything after
+    if (constrainedLinesInSerialOrder) {
+      for (size_t i = 0; i < constrainedDividerLines.size(); ++i) {
+        constrainedLineSlots[constrainedLineSerials[i]] = constrainedDividerLines.getHead() + i;
+      }
+      constrainedLinesInSerialOrder = false;
+    }
+    constrainedLineSlots.erase(constrainedLineSerials[index]);
+    constrainedLineSlots[constrainedLineSerials[0]] = constrainedDividerLines.getHead() + index;
+    constrainedDividerLines[index] = constrainedDividerLines[0];
+    constrainedLineSerials[index] = constrainedLineSerials[0];
+    if (liveReflow) constrainedLineSupports[index] = constrainedLineSupports[0];
+  } else if (!constrainedLinesInSerialOrder) {
+    constrainedLineSlots.erase(constrainedLineSerials[0]);
+  }
+  eraseFrontConstrainedLineSlots(1);
+  invalidateSubdivision();
+  if (index > 0) markConstrainedLineChanged(index - 1);
+}
+
+// The rest stay where they are, in instanceBO too, unless the store compacts,
+// which moves them all; it then puts them back in serial order, if need be
+void DividedArea::eraseFrontConstrainedLineSlots(size_t count) {
+  size_t dropped = constrainedDividerLines.getHead() + std::min(count, constrainedDividerLines.size());
+  bool compacted = constrainedDividerLines.eraseFront(count);
+  constrainedLineSerials.eraseFront(count);
+  if (liveReflow) constrainedLineSupports.eraseFront(count);
+  if (!compacted) return;
+  firstPendingSlot = (firstPendingSlot > dropped) ? firstPendingSlot - dropped : 0;
+  restoreConstrainedLineOrder();
+  markConstrainedLinesChanged(0);
+}
+
+void DividedArea::restoreConstrainedLineOrder() {
+  if (constrainedLinesInSerialOrder) return;
+  const std::vector<size_t>& order = orderConstrainedDividerLines(nextConstrainedSerial);
+  ConstrainedDividerLines lines;
+  std::vector<uint64_t> serials;
+  std::vector<ReflowSupports> supports;
+  lines.reserve(order.size());
+  serials.reserve(order.size());
+  for (size_t i : order) {
+    lines.push_back(constrainedDividerLines[i]);
+    serials.push_back(constrainedLineSerials[i]);
+    if (liveReflow) supports.push_back(constrainedLineSupports[i]);
+  }
+  for (size_t i = 0; i < lines.size(); ++i) {
+    constrainedDividerLines[i] = lines[i];
+    constrainedLineSerials[i] = serials[i];
+    if (liveReflow) constrainedLineSupports[i] = supports[i];
+  }
+  constrainedLinesInSerialOrder = true;
+  constrainedLineSlots.clear();
+  firstPendingSlot = 0; // the pending lines may be anywhere now
+  invalidateSubdivision();
+  markConstrainedLinesChanged(0);
+}
+
+void DividedArea::updateDensityGridResolution() {
+  if (densityGrid.getResolution() == densityGridResolutionParameter.get()) return;
+  densityGrid.reset(size, densityGridResolutionParameter);
+  for (size_t i = 0; i < constrainedDividerLines.size(); ++i) {
+    densityGrid.addLine(constrainedDividerLines[i].start, constrainedDividerLines[i].end, constrainedLineSerials[i]);
+  }
+}
+
+const DensityGrid& DividedArea::getDensityGrid() {
+  updateDensityGridResolution();
+  return densityGrid;
+}
+
+int DividedArea::getLineDensity(glm::vec2 point) {
+  updateDensityGridResolution();
+  return densityGrid.getCoverage(densityGrid.getCell(point));
+}
+
+bool DividedArea::isSaturated(glm::vec2 point) {
+  return densitySaturationParameter > 0 && getLineDensity(point) >= densitySaturationParameter;
+}
+
+size_t DividedArea::findConstrainedDividerLine(uint64_t serial) const {
+  if (constrainedLinesInSerialOrder) {
+    return std::lower_bound(constrainedLineSerials.begin(), constrainedLineSerials.end(), serial) - constrainedLineSerials.begin();
+  }
+  auto slot = constrainedLineSlots.find(serial);
+  return (slot == constrainedLineSlots.end()) ? constrainedDividerLines.size() : slot->second - constrainedDividerLines.getHead();
+}
+
+const std::vector<size_t>& DividedArea::orderConstrainedDividerLines(uint64_t olderThan) {
+  constrainedLineOrder.clear();
+  for (size_t i = 0; i < constrainedDividerLines.size(); ++i) {
+    if (constrainedLineSerials[i] < olderThan) constrainedLineOrder.push_back(i);
+  }
+  if (!constrainedLinesInSerialOrder) {
+    std::sort(constrainedLineOrder.begin(), constrainedLineOrder.end(), [&](size_t a, size_t b) {
+      return constrainedLineSerials[a] < constrainedLineSerials[b];
+    });
+  }
+  return constrainedLineOrder;
+}
+
+void DividedArea::makeRoomForConstrainedDividerLine() {
+  size_t maxLines = getEffectiveMaxConstrainedLines();
+  ConstrainedEvictionPolicy policy = getConstrainedEvictionPolicy();
+  if (policy == ConstrainedEvictionPolicy::OldestChunk) {
+    if (constrainedDividerLines.size() >= maxLines) deleteEarlyConstrainedDividerLines(maxConstrainedLinesParameter * 0.05);
+    return;
+  }
+  // One out per one in, or two while the cap is coming down, so any excess
+  // drains over a few frames rather than in one go
+  size_t keep = std::max<size_t>(maxLines, 1) - 1;
+  for (int evicted = 0; evicted < 2 && constrainedDividerLines.size() > keep; ++evicted) {
+    switch (policy) {
+      case ConstrainedEvictionPolicy::Densest: {
+        int cell = densityGrid.getDensestCell();
+        evictConstrainedDividerLine((cell < 0) ? 0 : findConstrainedDividerLine(densityGrid.getLineIds(cell).front()));
+        break;
+      }
+      case ConstrainedEvictionPolicy::Random:
+        evictConstrainedDividerLine(std::uniform_int_distribution<size_t>(0, constrainedDividerLines.size() - 1)(evictionRandom));
+        break;
+      default:
+        deleteEarlyConstrainedDividerLines(1);
+        break;
+    }
   }
 }
 
 DividerLine DividedArea::createConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2) const {
   Line lineWithinArea = DividerLine::findEnclosedLine(ref1, ref2, areaConstraints);
   Line lineWithinUnconstrainedDividerLines = DividerLine::findEnclosedLineIn(ref1, ref2, unconstrainedDividerLines, lineWithinArea);
-  return DividerLine::create(ref1, ref2, constrainedDividerLines, lineWithinUnconstrainedDividerLines);
+  Line constrainedLine = DividerLine::findEnclosedLineIn(ref1, ref2, constrainedDividerLines, lineWithinUnconstrainedDividerLines);
+  return DividerLine { ref1, ref2, constrainedLine.start, constrainedLine.end };
+}
+
+// The constrained lines come from the density grid's cells along the line,
+// walked out from the shrink-towards point, so a clip costs the lines near it
+// rather than every line. Each end comes to the nearest hit on its side
+// whatever order the hits are taken in, once the area (or a major) has
+// brought it onto the line; until then, as with a shrink-towards point off
+// the area, they're all taken in order, as createConstrainedDividerLine does.
+DividerLine DividedArea::clipConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2, uint64_t olderThan, ReflowSupports* supports) {
+  updateDensityGridResolution();
+  glm::vec2 shrinkTowards = DividerLine::getShrinkTowardsPoint(ref1, ref2);
+  glm::vec2 start = longestLine.start, end = longestLine.end;
+  if (supports) *supports = ReflowSupports {};
+  auto shrink = [&](glm::vec2 constraintStart, glm::vec2 constraintEnd, DividerLineRef::Kind kind, uint64_t id) {
+    auto intersection = lineToSegmentIntersection(ref1, ref2, constraintStart, constraintEnd);
+    if (!intersection) return;
+    glm::vec2 previousStart = start, previousEnd = end;
+    shrinkLineToIntersectionAroundReferencePoint(start, end, *intersection, shrinkTowards);
+    if (!supports) return;
+    if (start != previousStart) supports->start = ReflowSupport { kind, id };
+    if (end != previousEnd) supports->end = ReflowSupport { kind, id };
+  };
+  auto isSelf = [&](const auto& constraint) {
+    return (ref1 == constraint.ref1 && ref2 == constraint.ref2) || (ref2 == constraint.ref1 && ref1 == constraint.ref2);
+  };
+  for (size_t i = 0; i < areaConstraints.size(); ++i) {
+    if (!isSelf(areaConstraints[i])) shrink(areaConstraints[i].start, areaConstraints[i].end, DividerLineRef::Kind::Area, i);
+  }
+  for (const auto& major : unconstrainedDividerLines) {
+    if (!isSelf(major)) shrink(major.start, major.end, DividerLineRef::Kind::Major, major.serial);
+  }
+
+  bool inside = shrinkTowards.x > 0.0f && shrinkTowards.y > 0.0f && shrinkTowards.x < size.x && shrinkTowards.y < size.y;
+  if (!inside || start == longestLine.start || end == longestLine.end) {
+    auto shrinkByLine = [&](size_t i) {
+      const ConstrainedDividerLine& dl = constrainedDividerLines[i];
+      if (!isSelf(dl)) shrink(dl.start, dl.end, DividerLineRef::Kind::Constrained, constrainedLineSerials[i]);
+    };
+    if (constrainedLinesInSerialOrder) {
+      for (size_t i = 0; i < constrainedDividerLines.size() && constrainedLineSerials[i] < olderThan; ++i) shrinkByLine(i);
+    } else {
+      for (size_t i : orderConstrainedDividerLines(olderThan)) shrinkByLine(i);
+    }
+    return DividerLine { ref1, ref2, start, end };
+  }
+
+  auto shrinkByCrossing = [&](const DensityGrid::Crossing& crossing) {
+    if (crossing.id >= olderThan) return;
+    glm::vec2 previousStart = start, previousEnd = end;
+    ReflowSupports previousSupports = supports ? *supports : ReflowSupports {};
+    shrink(crossing.start, crossing.end, DividerLineRef::Kind::Constrained, crossing.id);
+    if (start == previousStart && end == previousEnd) return;
+    // Only now, as it's rare, check the line isn't this one again
+    if (!isSelf(constrainedDividerLines[findConstrainedDividerLine(crossing.id)])) return;
+    start = previousStart;
+    end = previousEnd;
+    if (supports) *supports = previousSupports;
+  };
+  float cellSize = densityGrid.getCellSize();
+  for (glm::vec2* side : { &start, &end }) {
+    glm::vec2 far = *side;
+    glm::vec2 along = far - shrinkTowards;
+    float length2 = glm::length2(along);
+    if (!(length2 > 0.0f)) continue;
+    float margin = 1e-3f * cellSize / std::sqrt(length2); // of the walk, against rounding at cell edges
+    densityGrid.forEachCellAlong(shrinkTowards, far, [&](int cell) {
+      // Where the walk enters the cell
+      glm::vec2 cellMin = densityGrid.getCellMin(cell);
+      float entry = 0.0f;
+      for (int axis = 0; axis < 2; ++axis) {
+        if (along[axis] == 0.0f) continue;
+        float ta = (cellMin[axis] - shrinkTowards[axis]) / along[axis];
+        float tb = (cellMin[axis] + cellSize - shrinkTowards[axis]) / along[axis];
+        entry = std::max(entry, std::min(ta, tb));
+      }
+      // A hit short of the cell is nearer than any line further on can give
+      if (glm::dot(*side - shrinkTowards, along) / length2 < entry - margin) return false;
+      for (const auto& crossing : densityGrid.getCrossings(cell)) shrinkByCrossing(crossing);
+      return true;
+    });
+  }
+  return DividerLine { ref1, ref2, start, end };
+}
+
+// Relative to the area's size
+static constexpr float REFLOW_TOLERANCE = 1e-5f;
+
+void DividedArea::onMajorLinesChanged() {
+  invalidateSubdivision();
+  if (liveReflow) reflowConstrainedDividerLines();
+}
+
+void DividedArea::setLiveReflow(bool enabled) {
+  if (liveReflow == enabled) return;
+  liveReflow = enabled;
+  constrainedLineSupports.clear();
+  reflowMajorPositions.clear();
+  if (!enabled) return;
+  for (const auto& major : unconstrainedDividerLines) {
+    reflowMajorPositions.push_back({ major.serial, Line { major.start, major.end } });
+  }
+  constrainedLineSupports.resize(constrainedDividerLines.size());
+  lastReflowLineCount = 0;
+  // Oldest first; a copy, as clipping may order the lines again
+  std::vector<size_t> order = orderConstrainedDividerLines(nextConstrainedSerial);
+  for (size_t i : order) {
+    if (reflowConstrainedDividerLine(i)) ++lastReflowLineCount;
+  }
+  if (lastReflowLineCount > 0) invalidateSubdivision();
+}
+
+bool DividedArea::reflowConstrainedDividerLine(size_t index) {
+  ConstrainedDividerLine& dl = constrainedDividerLines[index];
+  DividerLine clipped = clipConstrainedDividerLine(dl.ref1, dl.ref2, constrainedLineSerials[index], &constrainedLineSupports[index]);
+  // Ignore rounding differences from re-intersecting a support whose far end
+  // moved, which would otherwise ripple through every line that depends on it
+  float tolerance2 = REFLOW_TOLERANCE * REFLOW_TOLERANCE * glm::length2(size);
+  if (glm::distance2(clipped.start, dl.start) <= tolerance2 && glm::distance2(clipped.end, dl.end) <= tolerance2) return false;
+  if (occlusionRasterCurrent) {
+    occlusionRaster.removeLine(dl.start, dl.end);
+    occlusionRaster.addLine(clipped.start, clipped.end);
+  }
+  densityGrid.removeLine(dl.start, dl.end, constrainedLineSerials[index]);
+  densityGrid.addLine(clipped.start, clipped.end, constrainedLineSerials[index]);
+  dl.start = clipped.start;
+  dl.end = clipped.end;
+  markConstrainedLineChanged(index);
+  return true;
+}
+
+static bool segmentsCross(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b1) {
+  float d0 = geom::cross2(a1 - a0, b0 - a0), d1 = geom::cross2(a1 - a0, b1 - a0);
+  float d2 = geom::cross2(b1 - b0, a0 - b0), d3 = geom::cross2(b1 - b0, a1 - b0);
+  return ((d0 > 0.0f) != (d1 > 0.0f)) && d0 != 0.0f && d1 != 0.0f
+      && ((d2 > 0.0f) != (d3 > 0.0f)) && d2 != 0.0f && d3 != 0.0f;
+}
+
+// Re-clips, oldest first, the constrained lines that stopped on a major that
+// moved (or went) or that a major now crosses; then those that stopped on or
+// are now crossed by a line that was re-clipped, which are always newer. The
+// candidates are the lines the density grid has along the old and new
+// positions of whatever moved.
+void DividedArea::reflowConstrainedDividerLines() {
+  lastReflowLineCount = 0;
+  std::vector<std::pair<uint32_t, Line>> previousMajors;
+  std::vector<Line> movedMajors;
+  for (const auto& major : unconstrainedDividerLines) {
+    auto previous = std::find_if(reflowMajorPositions.begin(), reflowMajorPositions.end(), [&](const auto& p) { return p.first == major.serial; });
+    if (previous != reflowMajorPositions.end() && previous->second.start == major.start && previous->second.end == major.end) continue;
+    if (previous != reflowMajorPositions.end()) previousMajors.push_back(*previous);
+    movedMajors.push_back(Line { major.start, major.end });
+  }
+  for (const auto& previous : reflowMajorPositions) {
+    bool removed = std::none_of(unconstrainedDividerLines.begin(), unconstrainedDividerLines.end(), [&](const auto& major) { return major.serial == previous.first; });
+    if (removed) previousMajors.push_back(previous);
+  }
+  reflowMajorPositions.clear();
+  for (const auto& major : unconstrainedDividerLines) {
+    reflowMajorPositions.push_back({ major.serial, Line { major.start, major.end } });
+  }
+  if (previousMajors.empty() && movedMajors.empty()) return;
+
+  updateDensityGridResolution();
+  auto stoppedOn = [](const ReflowSupports& supports, DividerLineRef::Kind kind, uint64_t id) {
+    auto isOn = [&](const ReflowSupport& support) { return support.kind == kind && support.id == id; };
+    return isOn(supports.start) || isOn(supports.end);
+  };
+  std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> queue; // serials, oldest first
+  std::unordered_set<uint64_t> queued;
+  auto enqueue = [&](uint64_t serial) {
+    if (queued.insert(serial).second) queue.push(serial);
+  };
+  auto forEachCrossingAlong = [&](const Line& line, auto&& fn) {
+    densityGrid.forEachCellAlong(line.start, line.end, [&](int cell) {
+      for (const auto& crossing : densityGrid.getCrossings(cell)) fn(crossing);
+    });
+  };
+  for (const auto& [serial, position] : previousMajors) {
+    forEachCrossingAlong(position, [&](const DensityGrid::Crossing& crossing) {
+      if (queued.count(crossing.id)) return;
+      if (stoppedOn(constrainedLineSupports[findConstrainedDividerLine(crossing.id)], DividerLineRef::Kind::Major, serial)) enqueue(crossing.id);
+    });
+  }
+  for (const Line& major : movedMajors) {
+    forEachCrossingAlong(major, [&](const DensityGrid::Crossing& crossing) {
+      if (segmentsCross(crossing.start, crossing.end, major.start, major.end)) enqueue(crossing.id);
+    });
+  }
+
+  float tolerance = REFLOW_TOLERANCE * glm::length(size);
+  while (!queue.empty()) {
+    size_t i = findConstrainedDividerLine(queue.top());
+    queue.pop();
+    Line previous { constrainedDividerLines[i].start, constrainedDividerLines[i].end };
+    if (!reflowConstrainedDividerLine(i)) continue;
+    ++lastReflowLineCount;
+    Line reclipped { constrainedDividerLines[i].start, constrainedDividerLines[i].end };
+    uint64_t serial = constrainedLineSerials[i];
+    // An end that stopped on the re-clipped line only needs to move if the line no longer reaches it
+    auto lostSupport = [&](const ReflowSupport& support, glm::vec2 p) {
+      return support.kind == DividerLineRef::Kind::Constrained && support.id == serial
+          && geom::pointToSegmentDistance(p, reclipped.start, reclipped.end) > tolerance;
+    };
+    forEachCrossingAlong(previous, [&](const DensityGrid::Crossing& crossing) {
+      if (crossing.id <= serial || queued.count(crossing.id)) return;
+      const ReflowSupports& supports = constrainedLineSupports[findConstrainedDividerLine(crossing.id)];
+      if (lostSupport(supports.start, crossing.start) || lostSupport(supports.end, crossing.end)) enqueue(crossing.id);
+    });
+    forEachCrossingAlong(reclipped, [&](const DensityGrid::Crossing& crossing) {
+      if (crossing.id > serial && segmentsCross(crossing.start, crossing.end, reclipped.start, reclipped.end)) enqueue(crossing.id);
+    });
+  }
+}
+
+void DividedArea::invalidateSubdivision() {
+  subdivisionStale = true;
+}
+
+// Only the part of a line inside the area bounds any region; lines from ref
+// points outside it can reach far beyond and close off regions out there
+void DividedArea::insertIntoSubdivision(glm::vec2 start, glm::vec2 end, uint32_t line) {
+  glm::vec2 d = end - start;
+  float t0 = 0.0f, t1 = 1.0f;
+  for (int axis = 0; axis < 2; ++axis) {
+    if (d[axis] == 0.0f) {
+      if (start[axis] < 0.0f || start[axis] > size[axis]) return;
+      continue;
+    }
+    float ta = (0.0f - start[axis]) / d[axis];
+    float tb = (size[axis] - start[axis]) / d[axis];
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+  if (t0 >= t1) return;
+  subdivision.insertSegment(start + t0 * d, start + t1 * d, line);
+}
+
+void DividedArea::rebuildSubdivision() {
+  float extent = std::max(size.x, size.y);
+  int gridSize = std::clamp(static_cast<int>(std::sqrt(static_cast<float>(maxConstrainedLinesParameter.get()))), 8, 256);
+  subdivision.reset({ 0.0f, 0.0f }, size, gridSize, extent * 1e-5f);
+  uint32_t line = 0;
+  for (const auto& dl : areaConstraints) insertIntoSubdivision(dl.start, dl.end, line++);
+  for (const auto& dl : unconstrainedDividerLines) insertIntoSubdivision(dl.start, dl.end, line++);
+  for (const auto& dl : constrainedDividerLines) insertIntoSubdivision(dl.start, dl.end, line++);
+  subdivisionStale = false;
+}
+
+const std::vector<DividedAreaRegion>& DividedArea::getRegions() {
+  if (subdivisionStale) rebuildSubdivision();
+  if (regionsGeneration != subdivision.getGeneration()) {
+    regionsGeneration = subdivision.getGeneration();
+    regions.clear();
+  }
+  regions.resize(subdivision.getFaceCount());
+  subdivision.takeChangedFaces(changedRegions);
+  for (int region : changedRegions) updateRegion(region);
+  return regions;
+}
+
+RegionLocation DividedArea::locate(glm::vec2 point) {
+  if (subdivisionStale) rebuildSubdivision();
+  RegionLocation location { subdivision.locateFace(point), {} };
+  getRegionBoundingLines(location.region, location.boundingLines);
+  return location;
+}
+
+void DividedArea::locateBatch(geom::PointView points, std::vector<int>& regions) {
+  if (subdivisionStale) rebuildSubdivision();
+  regions.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    regions[i] = subdivision.locateFace(points[i]);
+  }
+}
+
+void DividedArea::getRegionBoundingLines(int region, std::vector<DividerLineRef>& lines) {
+  lines.clear();
+  if (subdivisionStale) rebuildSubdivision();
+  if (region <= PlanarSubdivision::UNBOUNDED_FACE || region >= static_cast<int>(subdivision.getFaceCount())) return;
+  // Edges are tagged in area, major, constrained order (see rebuildSubdivision)
+  std::vector<uint32_t> tags;
+  subdivision.forEachBoundaryHalfEdge(region, [&](int halfEdge) {
+    if (subdivision.getHalfEdge(halfEdge ^ 1).face == region) return; // a line ending inside the region
+    tags.push_back(subdivision.getHalfEdge(halfEdge).line);
+  });
+  std::sort(tags.begin(), tags.end());
+  tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+  size_t majorsBegin = areaConstraints.size();
+  size_t constrainedBegin = majorsBegin + unconstrainedDividerLines.size();
+  for (uint32_t tag : tags) {
+    if (tag < majorsBegin) {
+      lines.push_back(DividerLineRef { DividerLineRef::Kind::Area, tag });
+    } else if (tag < constrainedBegin) {
+      lines.push_back(DividerLineRef { DividerLineRef::Kind::Major, tag - majorsBegin });
+    } else {
+      lines.push_back(DividerLineRef { DividerLineRef::Kind::Constrained, tag - constrainedBegin });
+    }
+  }
+}
+
+void DividedArea::updateRegion(int region) {
+  DividedAreaRegion& r = regions[region];
+  r.outline.clear();
+  r.holes.clear();
+  r.version = ++lastRegionVersion;
+  if (region == PlanarSubdivision::UNBOUNDED_FACE) return;
+  subdivision.getFaceLoops(region, regionLoops);
+  // Normally one counter-clockwise loop; keep the largest should snapping
+  // have pinched off another
+  float outlineArea = 0.0f;
+  for (auto& loop : regionLoops) {
+    float area = 0.0f;
+    for (size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++) {
+      area += geom::cross2(loop[j] - loop[0], loop[i] - loop[0]);
+    }
+    if (area > outlineArea) {
+      outlineArea = area;
+      r.outline.swap(loop);
+    } else if (area < 0.0f) {
+      r.holes.push_back(std::move(loop));
+    }
+  }
 }
 
 std::optional<DividerLine> DividedArea::addConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2, ofFloatColor color, float overriddenWidth, bool taper) {
+  InputRecordScope recording(*this);
+  if (auto recorder = recording.getRecorder()) recorder->recordConstrainedDividerLine(ref1, ref2, color, overriddenWidth, taper);
   if (ref1 == ref2) return std::nullopt;
-  DividerLine dividerLine = createConstrainedDividerLine(ref1, ref2);
-  float occlusionDistance = constrainedOcclusionDistanceParameter * size.x;
-  if (dividerLine.isOccludedByAny(constrainedDividerLines, occlusionDistance, occlusionAngleParameter)) return std::nullopt;
-  if (constrainedDividerLines.size() > maxConstrainedLinesParameter) deleteEarlyConstrainedDividerLines(maxConstrainedLinesParameter * 0.05);
-  constrainedDividerLines.push_back(dividerLine);
+  QualityCostTimer timer(*this);
+  // Before anything is added, so a shrink evicts from both stores alike
+  if (instanceCapacity != maxConstrainedLinesParameter) setConstrainedLineCapacity(maxConstrainedLinesParameter);
+  if (isSaturated(DividerLine::getShrinkTowardsPoint(ref1, ref2))) {
+    ++saturationRejections;
+    return std::nullopt;
+  }
+  ReflowSupports supports;
+  DividerLine dividerLine = clipConstrainedDividerLine(ref1, ref2, nextConstrainedSerial, liveReflow ? &supports : nullptr);
+  if (isConstrainedLineOccluded(dividerLine)) return std::nullopt;
+  updateDensityGridResolution();
+  makeRoomForConstrainedDividerLine();
   float width = (overriddenWidth > 0.0) ? overriddenWidth : constrainedWidthParameter.get();
-  addDividerInstanced(dividerLine.start, dividerLine.end,
-                      width, taper,
-                      color);
+  constrainedDividerLines.push_back(ConstrainedDividerLine { dividerLine.start, dividerLine.end, width, taper ? 1.0f : 0.0f, color, ref1, ref2 });
+  constrainedLineSerials.push_back(nextConstrainedSerial++);
+  if (!constrainedLinesInSerialOrder) constrainedLineSlots[constrainedLineSerials.back()] = constrainedLineSerials.getStorageSize() - 1;
+  densityGrid.addLine(dividerLine.start, dividerLine.end, constrainedLineSerials.back());
+  if (occlusionRasterCurrent) occlusionRaster.addLine(dividerLine.start, dividerLine.end);
+  if (liveReflow) constrainedLineSupports.push_back(supports);
+  if (!subdivisionStale) {
+    uint32_t line = static_cast<uint32_t>(areaConstraints.size() + unconstrainedDividerLines.size() + constrainedDividerLines.size() - 1);
+    insertIntoSubdivision(dividerLine.start, dividerLine.end, line);
+  }
   return dividerLine;
 }
 
+bool DividedArea::isConstrainedLineOccluded(const DividerLine& dividerLine) {
+  if (getConstrainedOcclusionMode() != ConstrainedOcclusionMode::Raster) {
+    occlusionRasterCurrent = false;
+    float occlusionDistance = constrainedOcclusionDistanceParameter * size.x;
+    return dividerLine.isOccludedByAnyOf(constrainedDividerLines, occlusionDistance, occlusionAngleParameter);
+  }
+  if (!occlusionRasterCurrent || occlusionRaster.getResolution() != occlusionRasterResolutionParameter.get()) {
+    occlusionRaster.reset(size, occlusionRasterResolutionParameter);
+    for (const auto& dl : constrainedDividerLines) occlusionRaster.addLine(dl.start, dl.end);
+    occlusionRasterCurrent = true;
+  }
+  return occlusionRaster.getCoverage(dividerLine.start, dividerLine.end) > occlusionRasterCoverageParameter;
+}
+
+std::optional<DividerLine> DividedArea::addConstrainedDividerLine(const ConstrainedLineRequest& request) {
+  return addConstrainedDividerLine(request.ref1, request.ref2, request.color, request.overriddenWidth, request.taper);
+}
+
+void DividedArea::publishMajorRefPoints(geom::PointView majorRefPoints) {
+  auto& frame = majorRefPointInput.getWriteBuffer();
+  frame.resize(majorRefPoints.size());
+  for (size_t i = 0; i < majorRefPoints.size(); ++i) {
+    frame[i] = majorRefPoints[i];
+  }
+  majorRefPointInput.publish();
+}
+
+bool DividedArea::enqueueConstrainedDividerLine(const ConstrainedLineRequest& request) {
+  if (constrainedLineInput.push(request)) return true;
+  droppedConstrainedLineRequests.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+DividedArea::InputDrainStats DividedArea::drainInputs(float dt) {
+  InputDrainStats stats;
+  if (majorRefPointInput.update()) {
+    stats.majorFrameApplied = true;
+    stats.majorLinesChanged = updateUnconstrainedDividerLines(majorRefPointInput.getReadBuffer(), dt);
+  }
+  // Bounded so producers that keep up with us can't hold the drain forever
+  ConstrainedLineRequest request;
+  for (size_t i = 0; i < constrainedLineInput.capacity() && constrainedLineInput.pop(request); ++i) {
+    ++stats.constrainedLinesApplied;
+    if (addConstrainedDividerLine(request)) ++stats.constrainedLinesAdded;
+  }
+  return stats;
+}
+
+void DividedArea::scheduleConstrainedDividerLine(const ConstrainedLineRequest& request, float priority) {
+  if (scheduledInsertions.empty()) oldestScheduledFrame = insertionFrame;
+  scheduledInsertions.push_back({ request, priority, insertionFrame, nextInsertionSequence++ });
+  std::push_heap(scheduledInsertions.begin(), scheduledInsertions.end());
+}
+
+DividedArea::InsertionStats DividedArea::processInsertions(InsertionClock::time_point deadline) {
+  InsertionStats stats;
+  ++insertionFrame;
+
+  // Sweep out aged candidates only when the oldest one has expired
+  uint64_t maxAge = static_cast<uint64_t>(std::max(1, maxInsertionAgeParameter.get()));
+  if (!scheduledInsertions.empty() && insertionFrame - oldestScheduledFrame > maxAge) {
+    auto expired = [&](const ScheduledInsertion& s) { return insertionFrame - s.frame > maxAge; };
+    auto end = std::remove_if(scheduledInsertions.begin(), scheduledInsertions.end(), expired);
+    stats.dropped = scheduledInsertions.end() - end;
+    scheduledInsertions.erase(end, scheduledInsertions.end());
+    std::make_heap(scheduledInsertions.begin(), scheduledInsertions.end());
+    oldestScheduledFrame = insertionFrame;
+    for (const auto& s : scheduledInsertions) oldestScheduledFrame = std::min(oldestScheduledFrame, s.frame);
+  }
+
+  size_t maxAttempts = getEffectiveMaxInsertionAttempts();
+  std::vector<ScheduledInsertion> deferred;
+  while (!scheduledInsertions.empty() && stats.attempts < maxAttempts && InsertionClock::now() < deadline) {
+    std::pop_heap(scheduledInsertions.begin(), scheduledInsertions.end());
+    const ConstrainedLineRequest& request = scheduledInsertions.back().request;
+    if (request.ref1 != request.ref2 && isSaturated(DividerLine::getShrinkTowardsPoint(request.ref1, request.ref2))) {
+      deferred.push_back(scheduledInsertions.back());
+    } else {
+      ++stats.attempts;
+      if (addConstrainedDividerLine(request)) ++stats.accepts;
+    }
+    scheduledInsertions.pop_back();
+  }
+  stats.deferred = deferred.size();
+  for (auto& insertion : deferred) {
+    scheduledInsertions.push_back(std::move(insertion));
+    std::push_heap(scheduledInsertions.begin(), scheduledInsertions.end());
+  }
+
+  stats.pending = scheduledInsertions.size();
+  lastInsertionStats = stats;
+  return stats;
+}
+
+// Scale on max constrained lines and insertion attempts at each quality level
+static constexpr float QUALITY_SCALES[DividedArea::QUALITY_LEVELS] = { 1.0f, 0.85f, 0.7f, 0.55f, 0.4f, 0.25f };
+static constexpr int QUALITY_STYLE_FALLBACK_LEVEL = 2;
+static constexpr float QUALITY_COST_SMOOTHING = 0.1f; // weight of the newest frame
+static constexpr int QUALITY_DEGRADE_FRAMES = 10; // consecutive frames over target before stepping down
+static constexpr int QUALITY_RESTORE_FRAMES = 90; // ... and under QUALITY_RESTORE_HEADROOM of it before stepping up
+static constexpr float QUALITY_RESTORE_HEADROOM = 0.7f;
+
+void DividedArea::setAdaptiveQuality(bool enabled) {
+  if (enabled == isAdaptiveQuality()) return;
+  adaptiveQuality.store(enabled, std::memory_order_relaxed);
+  qualityLevel.store(0, std::memory_order_relaxed);
+  qualityFrameCost.store(0, std::memory_order_relaxed);
+  smoothedFrameCost = 0.0f;
+  framesOverTarget = 0;
+  framesUnderTarget = 0;
+}
+
+void DividedArea::updateAdaptiveQuality() {
+  if (!isAdaptiveQuality()) return;
+  float frameCost = qualityFrameCost.exchange(0, std::memory_order_relaxed) * 1.0e-6f;
+  smoothedFrameCost += (frameCost - smoothedFrameCost) * QUALITY_COST_SMOOTHING;
+
+  float target = frameTimeTargetParameter;
+  framesOverTarget = (smoothedFrameCost > target) ? framesOverTarget + 1 : 0;
+  framesUnderTarget = (smoothedFrameCost < target * QUALITY_RESTORE_HEADROOM) ? framesUnderTarget + 1 : 0;
+
+  int level = getQualityLevel();
+  if (framesOverTarget >= QUALITY_DEGRADE_FRAMES && level < QUALITY_LEVELS - 1) {
+    ++level;
+  } else if (framesUnderTarget >= QUALITY_RESTORE_FRAMES && level > 0) {
+    --level;
+  } else {
+    return;
+  }
+  qualityLevel.store(level, std::memory_order_relaxed);
+  // Give each step time to show in the smoothed cost before the next
+  framesOverTarget = 0;
+  framesUnderTarget = 0;
+}
+
+void DividedArea::addAdaptiveQualityCost(float milliseconds) {
+  if (!isAdaptiveQuality()) return;
+  qualityFrameCost.fetch_add(static_cast<int64_t>(milliseconds * 1.0e6f), std::memory_order_relaxed);
+}
+
+void DividedArea::setQualityLevel(int level) {
+  qualityLevel.store(std::clamp(level, 0, QUALITY_LEVELS - 1), std::memory_order_relaxed);
+  framesOverTarget = 0;
+  framesUnderTarget = 0;
+}
+
+size_t DividedArea::getEffectiveMaxConstrainedLines() const {
+  return static_cast<size_t>(maxConstrainedLinesParameter * QUALITY_SCALES[getQualityLevel()]);
+}
+
+size_t DividedArea::getEffectiveMaxInsertionAttempts() const {
+  return std::max<size_t>(1, static_cast<size_t>(maxInsertionAttemptsParameter * QUALITY_SCALES[getQualityLevel()]));
+}
+
+MajorLineStyle DividedArea::getEffectiveMajorLineStyle() const {
+  MajorLineStyle style = getMajorLineStyle();
+  if (getQualityLevel() >= QUALITY_STYLE_FALLBACK_LEVEL && majorLineStyleRequiresBackground(style)) return MajorLineStyle::Solid;
+  return style;
+}
+
 void DividedArea::setupInstancedDraw(int newInstanceCapacity) {
   // build unit quad only once — and upload it to both vbos at the same time.
-  // setupInstancedDraw is called both from the constructor (with the
-  // param's DEFAULT value) and from addDividerInstanced when capacity
-  // mismatches the config value. If we let setMesh run twice on pendingVbo
-  // but only once on vbo (asymmetric guard), the second-setup state of
+  // Should setupInstancedDraw run again, letting setMesh run twice on
+  // pendingVbo but only once on vbo (asymmetric guard), the second-setup state of
   // pendingVbo gets into a fragile state — attribute bindings re-apply but
   // the re-uploaded mesh disrupts the VAO and one-shot draws produce
   // nothing visible. Both setMesh calls live inside this lazy-init block.
@@ -345,176 +1252,313 @@ void DividedArea::setupInstancedDraw(int newInstanceCapacity) {
     pendingVbo.setMesh(quad, GL_STATIC_DRAW);
   }
   
-  instanceCapacity = newInstanceCapacity;
-  instances.resize(instanceCapacity);
-  head = std::min(head, instanceCapacity - 1);
-  instanceCount = std::min(instanceCount, instanceCapacity);
-  instancesDirty = true;
-  
-  instanceBO.allocate(instances, GL_DYNAMIC_DRAW);
-  
-  // bind per-instance attributes
-  vbo.bind();
-  GLsizei stride = sizeof(DividerInstance);
-  std::size_t offP0    = offsetof(DividerInstance, p0);
-  std::size_t offP1    = offsetof(DividerInstance, p1);
-  std::size_t offWidth = offsetof(DividerInstance, width);
-  std::size_t offStyle = offsetof(DividerInstance, style);
-  std::size_t offColor = offsetof(DividerInstance, color);
-  vbo.setAttributeBuffer(1, instanceBO, 2, stride, offP0);
-  vbo.setAttributeDivisor(1, 1);
-  vbo.setAttributeBuffer(2, instanceBO, 2, stride, offP1);
-  vbo.setAttributeDivisor(2, 1);
-  vbo.setAttributeBuffer(3, instanceBO, 1, stride, offWidth);
-  vbo.setAttributeDivisor(3, 1);
-  vbo.setAttributeBuffer(4, instanceBO, 1, stride, offStyle);
-  vbo.setAttributeDivisor(4, 1);
-  vbo.setAttributeBuffer(5, instanceBO, 4, stride, offColor);
-  vbo.setAttributeDivisor(5, 1);
-  vbo.unbind();
-
-  // Parallel GPU buffer for OneShotDraw mode. Same per-instance attribute
-  // layout — fed from `pendingInstances` each frame and draws that many.
-  // Sized to match the ring capacity. `pendingVbo.setMesh` is upstairs
-  // in the lazy-init block (once only); we only refresh the instance-attribute
-  // bindings here so they re-bind to the newly-reallocated pendingBO.
-  std::vector<DividerInstance> emptyPending(instanceCapacity);
-  pendingBO.allocate(emptyPending, GL_DYNAMIC_DRAW);
-  pendingVbo.bind();
-  pendingVbo.setAttributeBuffer(1, pendingBO, 2, stride, offP0);
-  pendingVbo.setAttributeDivisor(1, 1);
-  pendingVbo.setAttributeBuffer(2, pendingBO, 2, stride, offP1);
-  pendingVbo.setAttributeDivisor(2, 1);
-  pendingVbo.setAttributeBuffer(3, pendingBO, 1, stride, offWidth);
-  pendingVbo.setAttributeDivisor(3, 1);
-  pendingVbo.setAttributeBuffer(4, pendingBO, 1, stride, offStyle);
-  pendingVbo.setAttributeDivisor(4, 1);
-  pendingVbo.setAttributeBuffer(5, pendingBO, 4, stride, offColor);
-  pendingVbo.setAttributeDivisor(5, 1);
-  pendingVbo.unbind();
-}
-
-void DividedArea::setOneShotDraw(bool enabled) {
+  // The instance buffers wait for drawInstanced, which a batched area never calls
+  setConstrainedLineCapacity(newInstanceCapacity);
+}
+
+// Shrinking evicts the oldest constrained lines past the new capacity
+void DividedArea::setConstrainedLineCapacity(int newCapacity) {
+  newCapacity = std::max(1, newCapacity);
+  if (newCapacity == instanceCapacity) return;
+  if (constrainedDividerLines.size() > static_cast<size_t>(newCapacity)) {
+    deleteEarlyConstrainedDividerLines(constrainedDividerLines.size() - newCapacity);
+  }
+  // Past the cap by one only until makeRoomForConstrainedDividerLine catches up
+  constrainedDividerLines.reserve(newCapacity + 1);
+  constrainedLineSerials.reserve(newCapacity + 1);
+  instanceCapacity = newCapacity;
+}
+
+// Grows the GPU instance buffers (the main one and the one-shot one) to at
+// least requiredCapacity, doubling so a slider being dragged up doesn't
+// reallocate at every step. Their contents are lost when that happens.
+bool DividedArea::reserveInstanceBuffers(int requiredCapacity) {
+  if (requiredCapacity <= allocatedInstanceCapacity) return false;
+  allocatedInstanceCapacity = std::max(requiredCapacity, allocatedInstanceCapacity * 2);
+  size_t bytes = allocatedInstanceCapacity * sizeof(ConstrainedDividerLine);
+  instanceBO.allocate(bytes, nullptr, GL_DYNAMIC_DRAW);
+  bindInstanceAttributes(vbo, instanceBO);
+  // `pendingVbo.setMesh` is upstairs in the lazy-init block (once only); only
+  // the instance-attribute bindings are refreshed here
+  pendingBO.allocate(bytes, nullptr, GL_DYNAMIC_DRAW);
+  bindInstanceAttributes(pendingVbo, pendingBO);
+  instanceBOLost = true;
+  boundInstanceHead = 0;
+  return true;
+}
+
+// bind per-instance attributes; the stride steps over each line's ref points
+void DividedArea::bindInstanceAttributes(ofVbo& instanceVbo, const ofBufferObject& buffer, size_t firstInstance) {
+  instanceVbo.bind();
+  GLsizei stride = sizeof(ConstrainedDividerLine);
+  std::size_t first    = firstInstance * sizeof(ConstrainedDividerLine);
+  std::size_t offP0    = first + offsetof(ConstrainedDividerLine, start);
+  std::size_t offP1    = first + offsetof(ConstrainedDividerLine, end);
+  std::size_t offWidth = first + offsetof(ConstrainedDividerLine, width);
+  std::size_t offStyle = first + offsetof(ConstrainedDividerLine, style);
+  std::size_t offColor = first + offsetof(ConstrainedDividerLine, color);
+  instanceVbo.setAttributeBuffer(ATTR_LOC_P0, buffer, 2, stride, offP0);
+  instanceVbo.setAttributeDivisor(ATTR_LOC_P0, 1);
+  instanceVbo.setAttributeBuffer(ATTR_LOC_P1, buffer, 2, stride, offP1);
+  instanceVbo.setAttributeDivisor(ATTR_LOC_P1, 1);
+  instanceVbo.setAttributeBuffer(ATTR_LOC_WIDTH, buffer, 1, stride, offWidth);
+  instanceVbo.setAttributeDivisor(ATTR_LOC_WIDTH, 1);
+  instanceVbo.setAttributeBuffer(ATTR_LOC_STYLE, buffer, 1, stride, offStyle);
+  instanceVbo.setAttributeDivisor(ATTR_LOC_STYLE, 1);
+  instanceVbo.setAttributeBuffer(ATTR_LOC_COLOR, buffer, 4, stride, offColor);
+  instanceVbo.setAttributeDivisor(ATTR_LOC_COLOR, 1);
+  instanceVbo.unbind();
+}
+
+void DividedArea::applyOneShotDraw(bool enabled) {
   if (oneShotDraw == enabled) return;
   oneShotDraw = enabled;
-  // Drop any queued pending when switching modes so we don't double-draw.
-  pendingInstances.clear();
+  // Only lines added from now on are pending, so switching modes doesn't double-draw
+  skipPendingConstrainedLines();
 }
 
-void DividedArea::addDividerInstanced(const glm::vec2& a, const glm::vec2& b, float width, bool taper, const ofFloatColor& col) {
-  if (instanceCapacity != maxConstrainedLinesParameter) {
-    setupInstancedDraw(maxConstrainedLinesParameter);
+void DividedArea::skipPendingConstrainedLines() {
+  firstPendingSerial = nextConstrainedSerial;
+  firstPendingSlot = constrainedDividerLines.getStorageSize();
+}
+
+// An eviction from the middle may have moved an older line in among the
+// pending ones, or one of them to later in storage, but never earlier
+const ConstrainedDividerLines& DividedArea::takePendingConstrainedLines() {
+  pendingLines.clear();
+  if (constrainedLinesInSerialOrder) {
+    for (size_t i = findConstrainedDividerLine(firstPendingSerial); i < constrainedDividerLines.size(); ++i) {
+      pendingLines.push_back(constrainedDividerLines[i]);
+    }
+  } else {
+    size_t head = constrainedDividerLines.getHead();
+    for (size_t i = std::max(firstPendingSlot, head) - head; i < constrainedDividerLines.size(); ++i) {
+      if (constrainedLineSerials[i] >= firstPendingSerial) pendingLines.push_back(constrainedDividerLines[i]);
+    }
   }
-  
-  if (instanceCount == instanceCapacity) {
-    head = (head + 1) % instanceCapacity;
-    instanceCount--;
+  skipPendingConstrainedLines();
+  return pendingLines;
+}
+
+void DividedArea::drawInstanced(float scale) {
+  QualityCostTimer timer(*this);
+  if (asyncGeometry) {
+    drawInstancedAsync(scale);
+    return;
   }
-  int idx = (head + instanceCount) % instanceCapacity;
-  instances[idx].p0 = a;
-  instances[idx].p1 = b;
-  instances[idx].width = width;
-  instances[idx].style = taper ? 1.0f : 0.0f;
-  instances[idx].color = col;
-  instanceCount++;
-  instancesDirty = true;
 
-  // OneShotDraw: also queue this instance for one-time GPU draw this frame.
-  // The ring entry above is preserved for occlusion-test memory only.
+  reserveInstanceBuffers(getInstanceBufferCapacity());
+
+  // OneShotDraw mode: draw only the lines added since the last flush. Each
+  // line is drawn exactly once in its lifetime — its pixels then persist in
+  // the destination FBO and evolve via whatever Fluid/Fade mechanism the
+  // cell has.
   if (oneShotDraw) {
-    pendingInstances.push_back(instances[idx]);
+    const ConstrainedDividerLines& pending = takePendingConstrainedLines();
+    if (pending.empty()) return;
+
+    const int pendingCount = static_cast<int>(pending.size());
+    reserveInstanceBuffers(pendingCount);
+    pendingBO.updateData(0, pendingCount * sizeof(ConstrainedDividerLine), pending.data());
+    renderStats.uploadedBytes += pendingCount * sizeof(ConstrainedDividerLine);
+    drawInstanceBuffer(pendingVbo, pendingCount, scale);
+    return;
   }
-}
 
-static void syncInstanceBufferIfNeeded(const std::vector<DividerInstance>& instances, int head, int count, int capacity, ofBufferObject& bo) {
-  if (!bo.isAllocated()) return;
-  int tail = (head + count) % capacity;
-  if (head < tail) {
-    bo.updateData(0, count * (int)sizeof(DividerInstance), &instances[head]);
-  } else {
-    int firstCount = capacity - head;
-    bo.updateData(0, firstCount * (int)sizeof(DividerInstance), &instances[head]);
-    bo.updateData(firstCount * (int)sizeof(DividerInstance), tail * (int)sizeof(DividerInstance), &instances[0]);
+  // Otherwise redraw every line each frame, uploading only what changed
+  if (constrainedDividerLines.empty()) return;
+  uploadInstanceChanges();
+  size_t head = constrainedDividerLines.getHead();
+  if (boundInstanceHead != head) {
+    bindInstanceAttributes(vbo, instanceBO, head);
+    boundInstanceHead = head;
   }
+  drawInstanceBuffer(vbo, static_cast<int>(constrainedDividerLines.size()), scale);
 }
 
-void DividedArea::drawInstanced(float scale) {
-  // OneShotDraw mode: draw only instances added since the last flush, then
-  // clear the pending queue. Each instance is drawn exactly once in its
-  // lifetime — its pixels then persist in the destination FBO and evolve via
-  // whatever Fluid/Fade mechanism the cell has.
-  if (oneShotDraw) {
-    if (pendingInstances.empty()) return;
+void DividedArea::drawInstanced(float scale, const ofRectangle& viewport) {
+  if (asyncGeometry || oneShotDraw || !(scale > 0.0f)) {
+    drawInstanced(scale);
+    return;
+  }
+  QualityCostTimer timer(*this);
+  reserveInstanceBuffers(getInstanceBufferCapacity());
+  if (constrainedDividerLines.empty()) return;
+  // Every line, visible or not, so other viewports this frame upload nothing
+  uploadInstanceChanges();
+  updateInstanceBuckets();
 
-    const int pendingCount = static_cast<int>(pendingInstances.size());
-    // Upload pending instances to the dedicated GPU buffer. If we have more
-    // pending than the buffer was sized for (would be unusual), reallocate.
-    if (pendingCount > instanceCapacity) {
-      pendingBO.allocate(pendingInstances, GL_DYNAMIC_DRAW);
+  DividerLineShape shape = getDividerLineShape();
+  float widthFactor = maxDividerLineWidthFactor(shape) * 0.5f;
+  glm::vec2 viewMin { viewport.getMinX() / scale, viewport.getMinY() / scale };
+  glm::vec2 viewMax { viewport.getMaxX() / scale, viewport.getMaxY() / scale };
+  visibleInstanceRanges.clear();
+  size_t head = constrainedDividerLines.getHead();
+  size_t storageSize = constrainedDividerLines.getStorageSize();
+  for (size_t b = head / INSTANCE_BUCKET_SIZE; b < instanceBuckets.size(); ++b) {
+    const InstanceBucket& bucket = instanceBuckets[b];
+    float pad = bucket.maxWidth * widthFactor + shape.extendBeyondCanvas;
+    if (bucket.max.x + pad < viewMin.x || bucket.min.x - pad > viewMax.x
+        || bucket.max.y + pad < viewMin.y || bucket.min.y - pad > viewMax.y) continue;
+    // The head's bucket still bounds the evicted lines before it too
+    size_t first = std::max(b * INSTANCE_BUCKET_SIZE, head);
+    size_t count = std::min((b + 1) * INSTANCE_BUCKET_SIZE, storageSize) - first;
+    if (!visibleInstanceRanges.empty() && visibleInstanceRanges.back().first + visibleInstanceRanges.back().second == first) {
+      visibleInstanceRanges.back().second += count;
     } else {
-      pendingBO.updateData(0, pendingCount * (int)sizeof(DividerInstance), pendingInstances.data());
+      visibleInstanceRanges.emplace_back(first, count);
     }
+  }
+  if (visibleInstanceRanges.empty()) return;
+
+  // No base instance before GL 4.2, so each range moves the attributes along
+  beginInstancedDraw(scale);
+  for (const auto& [first, count] : visibleInstanceRanges) {
+    bindInstanceAttributes(vbo, instanceBO, first);
+    vbo.bind();
+    vbo.drawElementsInstanced(GL_TRIANGLES, quad.getNumIndices(), static_cast<int>(count));
+    vbo.unbind();
+    ++renderStats.drawCalls;
+    renderStats.instances += count;
+  }
+  endInstancedDraw();
+  bindInstanceAttributes(vbo, instanceBO, boundInstanceHead);
+}
 
-    ofPushMatrix();
-    ofScale(scale);
-    ofEnableBlendMode(OF_BLENDMODE_ALPHA);
-    ofFill(); glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); ofDisableDepthTest();
-    shader.begin(maxTaperLengthParameter,
-                 minWidthFactorStartParameter,
-                 maxWidthFactorStartParameter,
-                 minWidthFactorEndParameter,
-                 maxWidthFactorEndParameter,
-                 edgeFadeWidthParameter,
-                 edgeWidthFactorParameter,
-                 centerWidthFactorParameter,
-                 extendBeyondCanvasParameter,
-                 lineLengthMinFactorParameter,
-                 linePositionFadeWidthParameter,
-                 linePositionEdgeFactorParameter,
-                 linePositionCenterFactorParameter);
-    pendingVbo.bind();
-    pendingVbo.drawElementsInstanced(GL_TRIANGLES, quad.getNumIndices(), pendingCount);
-    pendingVbo.unbind();
-    shader.end();
-    ofPopMatrix();
-
-    pendingInstances.clear();
+void DividedArea::markConstrainedLinesChanged(size_t from) {
+  from += constrainedDividerLines.getHead();
+  instancesDirtyFrom = std::min(instancesDirtyFrom, from);
+  instanceBoundsValid = std::min(instanceBoundsValid, from);
+}
+
+void DividedArea::markConstrainedLineChanged(size_t index) {
+  size_t slot = index + constrainedDividerLines.getHead();
+  // Its bucket grows to take the line in, rather than being recomputed
+  if (slot < instanceBoundsValid) {
+    const ConstrainedDividerLine& dl = constrainedDividerLines[index];
+    InstanceBucket& bucket = instanceBuckets[slot / INSTANCE_BUCKET_SIZE];
+    bucket.min = glm::min(bucket.min, glm::min(dl.start, dl.end));
+    bucket.max = glm::max(bucket.max, glm::max(dl.start, dl.end));
+    bucket.maxWidth = std::max(bucket.maxWidth, dl.width);
+  }
+  if (slot >= instancesDirtyFrom) return;
+  if (changedInstances.size() < MAX_CHANGED_INSTANCES) {
+    changedInstances.push_back(slot);
     return;
   }
+  // Too many to go one by one: everything from the first of them
+  instancesDirtyFrom = std::min(slot, *std::min_element(changedInstances.begin(), changedInstances.end()));
+  changedInstances.clear();
+}
 
-  // Legacy mode: redraw the whole ring every frame.
-  if (instanceCount == 0) return;
+// Twice the capacity, for the evicted lines the store holds on to until it compacts
+int DividedArea::getInstanceBufferCapacity() const {
+  return static_cast<int>(std::max<size_t>(2 * static_cast<size_t>(instanceCapacity), constrainedDividerLines.getStorageSize()));
+}
 
-  if (instancesDirty) {
-    syncInstanceBufferIfNeeded(instances, head, instanceCount, instanceCapacity, instanceBO);
-    instancesDirty = false;
+// Consecutive changed lines go up in one update
+void DividedArea::uploadInstanceChanges() {
+  if (instanceBOLost) {
+    instancesDirtyFrom = 0;
+    changedInstances.clear();
   }
+  instanceBOLost = false;
+  takeInstanceChanges(instanceChanges);
+  if (!instanceBO.isAllocated()) return;
+  const ConstrainedDividerLine* lines = constrainedDividerLines.getStorage();
+  auto upload = [&](size_t first, size_t count) {
+    if (count == 0) return;
+    instanceBO.updateData(first * sizeof(ConstrainedDividerLine), count * sizeof(ConstrainedDividerLine), lines + first);
+    renderStats.uploadedBytes += count * sizeof(ConstrainedDividerLine);
+  };
+  instanceChanges.forEachChangedRun(upload);
+  upload(instanceChanges.changedFrom, constrainedDividerLines.getStorageSize() - instanceChanges.changedFrom);
+}
 
+// Recomputes the buckets from the first one holding a line that changed or
+// was added since
+void DividedArea::updateInstanceBuckets() {
+  size_t count = constrainedDividerLines.getStorageSize();
+  const ConstrainedDividerLine* lines = constrainedDividerLines.getStorage();
+  size_t firstBucket = std::min(instanceBoundsValid, count) / INSTANCE_BUCKET_SIZE;
+  instanceBuckets.resize((count + INSTANCE_BUCKET_SIZE - 1) / INSTANCE_BUCKET_SIZE);
+  for (size_t b = firstBucket; b < instanceBuckets.size(); ++b) {
+    InstanceBucket& bucket = instanceBuckets[b];
+    size_t first = b * INSTANCE_BUCKET_SIZE, last = std::min(count, first + INSTANCE_BUCKET_SIZE);
+    bucket.min = glm::min(lines[first].start, lines[first].end);
+    bucket.max = glm::max(lines[first].start, lines[first].end);
+    bucket.maxWidth = 0.0f;
+    for (size_t i = first; i < last; ++i) {
+      const ConstrainedDividerLine& dl = lines[i];
+      bucket.min = glm::min(bucket.min, glm::min(dl.start, dl.end));
+      bucket.max = glm::max(bucket.max, glm::max(dl.start, dl.end));
+      bucket.maxWidth = std::max(bucket.maxWidth, dl.width);
+    }
+  }
+  instanceBoundsValid = count;
+}
+
+void DividedArea::takeInstanceChanges(InstanceChanges& changes) {
+  size_t storageSize = constrainedDividerLines.getStorageSize();
+  changes.head = constrainedDividerLines.getHead();
+  changes.changedFrom = std::clamp(instancesDirtyFrom, changes.head, storageSize);
+  changes.changedLines.clear();
+  for (size_t slot : changedInstances) {
+    if (slot >= changes.head && slot < changes.changedFrom) changes.changedLines.push_back(slot);
+  }
+  std::sort(changes.changedLines.begin(), changes.changedLines.end());
+  changes.changedLines.erase(std::unique(changes.changedLines.begin(), changes.changedLines.end()), changes.changedLines.end());
+  instancesDirtyFrom = storageSize;
+  changedInstances.clear();
+}
+
+DividerLineShape DividedArea::getDividerLineShape() const {
+  DividerLineShape shape;
+  shape.maxTaperLength = maxTaperLengthParameter;
+  shape.minWidthFactorStart = minWidthFactorStartParameter;
+  shape.maxWidthFactorStart = maxWidthFactorStartParameter;
+  shape.minWidthFactorEnd = minWidthFactorEndParameter;
+  shape.maxWidthFactorEnd = maxWidthFactorEndParameter;
+  shape.edgeFadeWidth = edgeFadeWidthParameter;
+  shape.edgeWidthFactor = edgeWidthFactorParameter;
+  shape.centerWidthFactor = centerWidthFactorParameter;
+  shape.extendBeyondCanvas = extendBeyondCanvasParameter;
+  shape.lineLengthMinFactor = lineLengthMinFactorParameter;
+  shape.linePositionFadeWidth = linePositionFadeWidthParameter;
+  shape.linePositionEdgeFactor = linePositionEdgeFactorParameter;
+  shape.linePositionCenterFactor = linePositionCenterFactorParameter;
+  return shape;
+}
+
+void DividedArea::drawInstanceBuffer(const ofVbo& instanceVbo, int count, float scale) {
+  beginInstancedDraw(scale);
+  instanceVbo.bind();
+  instanceVbo.drawElementsInstanced(GL_TRIANGLES, quad.getNumIndices(), count);
+  ++renderStats.drawCalls;
+  renderStats.instances += count;
+  instanceVbo.unbind();
+  endInstancedDraw();
+}
+
+void DividedArea::beginInstancedDraw(float scale) {
   ofPushMatrix();
   ofScale(scale);
   ofEnableBlendMode(OF_BLENDMODE_ALPHA);
   ofFill(); glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); ofDisableDepthTest();
-  shader.begin(maxTaperLengthParameter,
-               minWidthFactorStartParameter,
-               maxWidthFactorStartParameter,
-               minWidthFactorEndParameter,
-               maxWidthFactorEndParameter,
-               edgeFadeWidthParameter,
-               edgeWidthFactorParameter,
-               centerWidthFactorParameter,
-               extendBeyondCanvasParameter,
-               lineLengthMinFactorParameter,
-               linePositionFadeWidthParameter,
-               linePositionEdgeFactorParameter,
-               linePositionCenterFactorParameter);
-  vbo.bind();
-  vbo.drawElementsInstanced(GL_TRIANGLES, quad.getNumIndices(), instanceCount);
-  vbo.unbind();
+  if (shapeBufferStale || !shapeBuffer) {
+    shapeBuffer = DividerLineShader::acquireShapeBuffer(getDividerLineShape());
+    shapeBufferStale = false;
+  }
+  shader.begin(*shapeBuffer);
+}
+
+void DividedArea::endInstancedDraw() {
   shader.end();
   ofPopMatrix();
 }
 
 void DividedArea::draw(LineConfig areaConstraintLineConfig, LineConfig unconstrainedLineConfig, float scale) const {
+  QualityCostTimer timer(*this);
   ofPushMatrix();
   ofScale(scale);
   {
@@ -524,14 +1568,14 @@ void DividedArea::draw(LineConfig areaConstraintLineConfig, LineConfig unconstra
                     areaConstraints.end(),
                     [&](const auto& dl) {
         dl.draw(areaConstraintLineConfig);
+        ++renderStats.drawCalls;
       });
     }
     if (unconstrainedLineConfig.maxWidth > 0.0) {
       unconstrainedLineConfig.scale(scale);
-      std::for_each(unconstrainedDividerLines.begin(),
-                    unconstrainedDividerLines.end(),
-                    [&](const auto& dl) {
+      forEachMajorLineToDraw([&](const auto& dl) {
         dl.draw(unconstrainedLineConfig);
+        ++renderStats.drawCalls;
       });
     }
   }
@@ -539,6 +1583,8 @@ void DividedArea::draw(LineConfig areaConstraintLineConfig, LineConfig unconstra
 }
 
 void DividedArea::draw(LineConfig areaConstraintLineConfig, LineConfig unconstrainedLineConfig, float scale, const ofFbo& backgroundFbo) {
+  QualityCostTimer timer(*this);
+  backgroundPyramid.invalidate(); // the background is redrawn between draws
   ofPushMatrix();
   ofScale(scale);
   ofEnableBlendMode(OF_BLENDMODE_ALPHA);
@@ -551,13 +1597,12 @@ void DividedArea::draw(LineConfig areaConstraintLineConfig, LineConfig unconstra
                     areaConstraints.end(),
                     [&](const auto& dl) {
         dl.draw(areaConstraintLineConfig);
+        ++renderStats.drawCalls;
       });
     }
     if (unconstrainedLineConfig.maxWidth > 0.0) {
       ofFloatColor color = unconstrainedLineConfig.color;
-      std::for_each(unconstrainedDividerLines.begin(),
-                    unconstrainedDividerLines.end(),
-                    [&](const auto& dl) {
+      forEachMajorLineToDraw([&](const auto& dl) {
         drawMajorLine(dl, unconstrainedLineConfig.maxWidth, scale, color, &backgroundFbo);
       });
     }
@@ -567,8 +1612,9 @@ void DividedArea::draw(LineConfig areaConstraintLineConfig, LineConfig unconstra
 
 void DividedArea::drawMajorLine(const DividerLine& dl, float width, float scale,
                                 const ofFloatColor& color, const ofFbo* backgroundFbo) {
-  MajorLineStyle style = getMajorLineStyle();
+  MajorLineStyle style = getEffectiveMajorLineStyle();
   float widthNorm = width / scale;
+  if (backgroundFbo || !majorLineStyleRequiresBackground(style)) ++renderStats.drawCalls;
   
   switch (style) {
     case MajorLineStyle::Solid:
@@ -593,7 +1639,8 @@ void DividedArea::drawMajorLine(const DividerLine& dl, float width, float scale,
           refractiveLineShader = std::make_unique<RefractiveLineShader>();
           refractiveLineShader->load();
         }
-        refractiveLineShader->render(dl.start, dl.end, widthNorm, color, backgroundFbo);
+        const ofFbo& level = backgroundPyramid.getLevel(*backgroundFbo, refractiveLineShader->refractiveBackgroundLevelParameter);
+        refractiveLineShader->render(dl.start, dl.end, widthNorm, color, &level);
       }
       break;
       
@@ -603,13 +1650,15 @@ void DividedArea::drawMajorLine(const DividerLine& dl, float width, float scale,
           chromaticAberrationLineShader = std::make_unique<ChromaticAberrationLineShader>();
           chromaticAberrationLineShader->load();
         }
-        chromaticAberrationLineShader->render(dl.start, dl.end, widthNorm, color, backgroundFbo);
+        const ofFbo& level = backgroundPyramid.getLevel(*backgroundFbo, chromaticAberrationLineShader->chromaticAberrationBackgroundLevelParameter);
+        chromaticAberrationLineShader->render(dl.start, dl.end, widthNorm, color, &level);
       }
       break;
       
     case MajorLineStyle::BlurRefraction:
       if (backgroundFbo) {
-        blurRefractionLineShader->render(dl.start, dl.end, widthNorm, color, backgroundFbo);
+        int blurLevel = BackgroundPyramid::levelForBlurRadius(blurRefractionLineShader->blurRefractionBlurRadiusParameter);
+        blurRefractionLineShader->render(dl.start, dl.end, widthNorm, color, &backgroundPyramid.getLevel(*backgroundFbo, blurLevel));
       }
       break;
       
@@ -621,13 +1670,13 @@ void DividedArea::drawMajorLine(const DividerLine& dl, float width, float scale,
 }
 
 void DividedArea::draw(float areaConstraintLineWidth, float unconstrainedLineWidth, float scale, const ofFbo& backgroundFbo, const ofFloatColor& color) {
+  QualityCostTimer timer(*this);
+  backgroundPyramid.invalidate(); // the background is redrawn between draws
   ofPushMatrix();
   ofScale(scale);
   {
     if (unconstrainedLineWidth > 0) {
-      std::for_each(unconstrainedDividerLines.begin(),
-                    unconstrainedDividerLines.end(),
-                    [&](const auto& dl) {
+      forEachMajorLineToDraw([&](const auto& dl) {
         drawMajorLine(dl, unconstrainedLineWidth, scale, color, &backgroundFbo);
       });
     }
@@ -636,6 +1685,7 @@ void DividedArea::draw(float areaConstraintLineWidth, float unconstrainedLineWid
                     areaConstraints.end(),
                     [&](const auto& dl) {
         dl.draw(areaConstraintLineWidth / scale);
+        ++renderStats.drawCalls;
       });
     }
   }
@@ -644,8 +1694,9 @@ void DividedArea::draw(float areaConstraintLineWidth, float unconstrainedLineWid
 
 void DividedArea::drawMajorLinesWithoutBackground(float unconstrainedLineWidth, float scale, const ofFloatColor& color) {
   if (unconstrainedLineWidth <= 0) return;
+  QualityCostTimer timer(*this);
   
-  MajorLineStyle style = getMajorLineStyle();
+  MajorLineStyle style = getEffectiveMajorLineStyle();
   
   // If current style requires background, log warning and fall back to Solid
   if (majorLineStyleRequiresBackground(style)) {
@@ -663,7 +1714,8 @@ void DividedArea::drawMajorLinesWithoutBackground(float unconstrainedLineWidth,
   
   float widthNorm = unconstrainedLineWidth / scale;
   
-  for (const auto& dl : unconstrainedDividerLines) {
+  forEachMajorLineToDraw([&](const auto& dl) {
+    ++renderStats.drawCalls;
     switch (style) {
       case MajorLineStyle::Solid:
         solidLineShader->render(dl.start, dl.end, widthNorm, color, nullptr);
@@ -686,7 +1738,7 @@ void DividedArea::drawMajorLinesWithoutBackground(float unconstrainedLineWidth,
         dl.draw(widthNorm);
         break;
     }
-  }
+  });
   
   ofPopMatrix();
 }
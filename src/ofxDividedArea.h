@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
+#include <random>
+#include <unordered_map>
 #include <vector>
 
 #include "glm/vec2.hpp"
@@ -13,22 +18,78 @@
 #include "ofBufferObject.h"
 #include "ofShader.h"
 #include "ofMesh.h"
+#include "ofRectangle.h"
 #include "LineGeom.h"
+#include "GeomUtils.h"
 #include "DividerLineShader.h"
 #include "MajorLineStyle.h"
 #include "MajorLineShaders.h"
+#include "BackgroundPyramid.hpp"
+#include "ConcurrentQueues.h"
+#include "PlanarSubdivision.hpp"
+#include "OcclusionRaster.hpp"
+#include "DensityGrid.hpp"
 
-struct DividerInstance {
-  glm::vec2 p0;
-  glm::vec2 p1;
-  float width;
-  float style;
+class InputLogRecorder;
+
+// How a new constrained line is tested against the existing ones
+enum class ConstrainedOcclusionMode {
+  Exact = 0, // geometric test against every line (DividerLine::isOccludedBy)
+  Raster,    // coarse occupancy bitmap: cost follows the line's length, not the line count
+  Count
+};
+
+// Which constrained lines make room for new ones past maxConstrainedLines
+enum class ConstrainedEvictionPolicy {
+  OldestChunk = 0, // the oldest 5% in one go
+  Oldest,          // one out per one in, oldest first
+  Densest,         // one out per one in, the oldest in the busiest cell of a coarse histogram
+  Random,          // one out per one in, any line
+  Count
+};
+
+// A major ref point with an identity that persists across frames, e.g. a
+// tracked cluster centre
+struct IdentifiedRefPoint {
+  int id;
+  glm::vec2 position;
+};
+
+// Arguments for one addConstrainedDividerLine call, for callers that batch
+// or defer them (see DividedAreaGroup)
+struct ConstrainedLineRequest {
+  glm::vec2 ref1, ref2;
   ofFloatColor color;
+  float overriddenWidth = -1.0;
+  bool taper = false;
+};
+
+// A closed region the divider lines cut a DividedArea into
+struct DividedAreaRegion {
+  std::vector<glm::vec2> outline; // counter-clockwise; empty for an unused region id
+  std::vector<std::vector<glm::vec2>> holes; // clockwise
+  uint64_t version = 0; // changes whenever outline or holes do
+};
+
+// Identifies one of a DividedArea's lines: index is into areaConstraints,
+// unconstrainedDividerLines or constrainedDividerLines
+struct DividerLineRef {
+  enum class Kind { Area, Major, Constrained };
+  Kind kind;
+  size_t index;
+};
+
+// Where a point falls: a region id as in DividedArea::getRegions, and the
+// lines bounding that region
+struct RegionLocation {
+  int region;
+  std::vector<DividerLineRef> boundingLines;
 };
 
 class DividedArea {
 public:
   DividedArea(glm::vec2 size = {1.0, 1.0}, int maxUnconstrainedDividerLines = 3);
+  ~DividedArea();
 
   struct ParameterOverrides {
     std::optional<float> unconstrainedSmoothness;
@@ -41,6 +102,7 @@ public:
 
   void setParameterOverrides(const ParameterOverrides& overrides);
   void clearParameterOverrides();
+  const ParameterOverrides& getParameterOverrides() const { return parameterOverrides_; }
 
   glm::vec2 size;
   int maxUnconstrainedDividerLines;
@@ -51,19 +113,40 @@ public:
     {{0.0, size.y}, {0.0, 0.0}, {0.0, size.y}, {0.0, 0.0}}
   };
   std::vector<SmoothedDividerLine> unconstrainedDividerLines; // unconstrained, across the entire area, with velocity-based smoothing
-  DividerLines constrainedDividerLines; // constrained by all other divider lines
+  ConstrainedLineStore constrainedDividerLines; // constrained by all other divider lines, oldest first but for any evictConstrainedDividerLine has moved; also what drawInstanced uploads
   
   bool addUnconstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2);
   template<typename PT, typename A>
   bool updateUnconstrainedDividerLines(const std::vector<PT, A>& majorRefPoints);
+  // As above but with an explicit physics timestep rather than the app's last
+  // frame time, so it can run off the main thread (see DividedAreaGroup).
+  template<typename PT, typename A>
+  bool updateUnconstrainedDividerLines(const std::vector<PT, A>& majorRefPoints, float dt);
+  // Zero-copy input: ref points read in place through a strided view, e.g.
+  // geom::PointView::of(clusters.data(), clusters.size(), &Cluster::position).
+  // The vector overloads forward here, so there's a single hot loop.
+  bool updateUnconstrainedDividerLines(geom::PointView majorRefPoints);
+  bool updateUnconstrainedDividerLines(geom::PointView majorRefPoints, float dt);
+  // Id-aware input: each major line is keyed on the ids of its two ref points,
+  // so lines follow their points however far they jump. Lines whose ids are
+  // both present are updated by hash lookup; endpoint matching only runs for
+  // lines that lost an id (or were created by the id-less overloads), which
+  // then take on the ids of the pair they match. Ids must be non-negative.
+  bool updateUnconstrainedDividerLines(const std::vector<IdentifiedRefPoint>& majorRefPoints, float dt = getFrameDeltaTime());
+  // The timestep updateUnconstrainedDividerLines uses when none is passed
+  static float getFrameDeltaTime();
   
   void clearConstrainedDividerLines();
   void deleteEarlyConstrainedDividerLines(size_t count);
+  // Removes one line from anywhere. The oldest line moves into its place, so
+  // nothing else does; the lines' age order is their serials' from then on.
+  void evictConstrainedDividerLine(size_t index);
   DividerLine createConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2) const;
   // taper = false (default) renders uniform-width rectangles. taper = true renders
   // rhomboids using the maxTaperLength + minWidthFactorStart/End + maxWidthFactorStart/End
   // parameters (see DividerLineShader). Callers opt in explicitly per-call.
   std::optional<DividerLine> addConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2, ofFloatColor color, float overriddenWidth = -1.0, bool taper = false);
+  std::optional<DividerLine> addConstrainedDividerLine(const ConstrainedLineRequest& request);
   
   void draw(float areaConstraintLineWidth, float unconstrainedLineWidth, float scale, const ofFbo& backgroundFbo, const ofFloatColor& color = ofFloatColor(1.0f));
   
@@ -84,6 +167,12 @@ public:
   ofParameter<float> constrainedOcclusionDistanceParameter { "constrainedOcclusionDistance", 0.0015, 0.0, 0.01 };
   ofParameter<float> occlusionAngleParameter { "occlusionAngle", 0.97, 0.0, 1.0 }; // 0.0 if perpendicular, 1.0 if coincident
   ofParameter<int> maxConstrainedLinesParameter { "maxConstrainedLines", 800, 50, 10000 };
+  ofParameter<int> densityGridResolutionParameter { "densityGridResolution", 16, 4, 128 }; // cells along the longer side
+  ofParameter<int> densitySaturationParameter { "densitySaturation", 0, 0, 1000 }; // lines crossing a cell; 0 disables the pre-check
+  ofParameter<int> constrainedEvictionPolicyParameter { "constrainedEvictionPolicy", static_cast<int>(ConstrainedEvictionPolicy::Oldest), 0, static_cast<int>(ConstrainedEvictionPolicy::Count) - 1 };
+  ofParameter<int> maxInsertionAttemptsParameter { "maxInsertionAttempts", 1000, 1, 10000 }; // per processInsertions call
+  ofParameter<float> frameTimeTargetParameter { "frameTimeTarget", 8.0, 0.5, 33.0 }; // milliseconds, for adaptive quality
+  ofParameter<int> maxInsertionAgeParameter { "maxInsertionAge", 30, 1, 600 }; // frames a scheduled constrained line may wait before it's dropped
   ofParameter<float> maxTaperLengthParameter { "maxTaperLength", 0.5, 0.01, 2.0 }; // vary widths over this NORMALISED length. DividerLineShader computes line length from normalised instance positions, so this comparison must also be in normalised units. Was 1000 in pixels which mismatched the shader's normalised len (always ~0..1.4) and forced widthFactor to ~0, collapsing every line to the MIN end of its taper width-factor range (~40-60% of configured PathWidth). Default 0.5 means lines half-screen or longer render at full width; shorter lines taper narrower as designed.
   ofParameter<float> minWidthFactorStartParameter { "minWidthFactorStart", 0.6, 0.0, 1.0 }; // when tapering, minimum width factor at start of taper
   ofParameter<float> maxWidthFactorStartParameter { "maxWidthFactorStart", 1.0, 0.0, 1.0 }; // when tapering, maximum width factor at start of taper
@@ -139,52 +228,311 @@ public:
   //   edge=0.3, center=1 → thinner toward edges (frame-focus)
   ofParameter<float> linePositionCenterFactorParameter { "linePositionCenterFactor", 1.0, 0.0, 4.0 };
   ofParameter<float> constrainedWidthParameter { "constrainedWidth", 1.0/500.0f, 0.0, 0.01 };
+  ofParameter<int> constrainedOcclusionModeParameter { "constrainedOcclusionMode", static_cast<int>(ConstrainedOcclusionMode::Exact), 0, static_cast<int>(ConstrainedOcclusionMode::Count) - 1 };
+  // Raster occlusion: cells along the area's longer side, and the fraction of
+  // a new line's cells that may already hold near-parallel lines before it's
+  // rejected
+  ofParameter<int> occlusionRasterResolutionParameter { "occlusionRasterResolution", 512, 64, 2048 };
+  ofParameter<float> occlusionRasterCoverageParameter { "occlusionRasterCoverage", 0.5, 0.0, 1.0 };
   ofParameter<int> majorLineStyleParameter { "majorLineStyle", static_cast<int>(MajorLineStyle::Refractive), 0, static_cast<int>(MajorLineStyle::Count) - 1 };
 
   ofParameterGroup& getParameterGroup();
   MajorLineStyle getMajorLineStyle() const { return static_cast<MajorLineStyle>(majorLineStyleParameter.get()); }
   void setMajorLineStyle(MajorLineStyle style) { majorLineStyleParameter = static_cast<int>(style); }
+  ConstrainedEvictionPolicy getConstrainedEvictionPolicy() const { return static_cast<ConstrainedEvictionPolicy>(constrainedEvictionPolicyParameter.get()); }
+  void setConstrainedEvictionPolicy(ConstrainedEvictionPolicy policy) { constrainedEvictionPolicyParameter = static_cast<int>(policy); }
+  ConstrainedOcclusionMode getConstrainedOcclusionMode() const { return static_cast<ConstrainedOcclusionMode>(constrainedOcclusionModeParameter.get()); }
+  void setConstrainedOcclusionMode(ConstrainedOcclusionMode mode) { constrainedOcclusionModeParameter = static_cast<int>(mode); }
 
-  // Instanced rendering data
+  // Instanced rendering of the constrained lines
   void drawInstanced(float scale = 1.0f);
-  void addDividerInstanced(const glm::vec2& a, const glm::vec2& b, float width, bool taper, const ofFloatColor& col);
+  // Only submits the lines that can show in viewport, which is in the units
+  // scale gives (the target's pixels, say, for one of several outputs or one
+  // tile of a large still). Lines are culled in runs of INSTANCE_BUCKET_SIZE
+  // by their bounds, padded for their widths and extendBeyondCanvas. In
+  // OneShotDraw and async geometry modes, draws as drawInstanced(scale) does.
+  void drawInstanced(float scale, const ofRectangle& viewport);
+  static constexpr size_t INSTANCE_BUCKET_SIZE = 64;
+  // The parameters below that shape the instanced lines, for drawing them
+  // elsewhere (e.g. SoftwareLineRasterizer)
+  DividerLineShape getDividerLineShape() const;
+
+  // GPU work issued by drawInstanced and the draw calls below since the last
+  // resetRenderStats, for benchmarking
+  struct RenderStats {
+    uint64_t uploadedBytes = 0;
+    uint64_t drawCalls = 0;
+    uint64_t instances = 0; // constrained lines submitted
+  };
+  const RenderStats& getRenderStats() const { return renderStats; }
+  void resetRenderStats() { renderStats = RenderStats {}; }
+
+  // For a renderer keeping its own GPU copy of constrainedDividerLines in
+  // place of this area's (BatchedLineRenderer). The copy is laid out as the
+  // store's storage is, evicted lines included (see HeadOffsetVector), so
+  // evicting the oldest lines moves nothing in it. takeInstanceChanges
+  // reports, in storage indices, what changed since it was last called and
+  // counts it all as uploaded. drawInstanced shares that state, so draw an
+  // area one way or the other; resetInstanceChanges, from the render thread,
+  // has drawInstanced upload every line again after drawing the other way.
+  struct InstanceChanges {
+    size_t head = 0; // the lines before it have been evicted
+    size_t changedFrom = 0; // the lines from here on changed or were added
+    std::vector<size_t> changedLines; // and these before it, ascending
+    // Calls fn(first, count) for each run of consecutive changedLines
+    template<typename F> void forEachChangedRun(F&& fn) const {
+      for (size_t i = 0, run = 0; i < changedLines.size(); i = run) {
+        for (run = i + 1; run < changedLines.size() && changedLines[run] == changedLines[run - 1] + 1; ++run) {}
+        fn(changedLines[i], run - i);
+      }
+    }
+  };
+  void takeInstanceChanges(InstanceChanges& changes);
+  void resetInstanceChanges() { instanceBOLost = true; }
+  int getConstrainedLineCapacity() const { return instanceCapacity; }
+  // The most storage the store takes up at this capacity
+  size_t getConstrainedLineStorageCapacity() const { return 2 * (static_cast<size_t>(std::max(0, instanceCapacity)) + 1); }
+  // A serial per constrained line, that stays with the line while it lives
+  // (GeometryTimelineRecorder); ascending but for lines evicting from the
+  // middle has moved
+  const HeadOffsetVector<uint64_t>& getConstrainedLineSerials() const { return constrainedLineSerials; }
+  bool isOneShotDraw() const { return oneShotDraw.load(std::memory_order_relaxed); }
+  // Points the instance attributes of instanceVbo at a buffer of
+  // ConstrainedDividerLine, at locations 1 to 5
+  static void bindInstanceAttributes(ofVbo& instanceVbo, const ofBufferObject& buffer, size_t firstInstance = 0);
 
-  // OneShotDraw mode: when enabled, each instance is drawn EXACTLY ONCE (the
-  // frame it's added) rather than re-drawn every frame from the ring. The ring
-  // still holds all instances for occlusion-test memory (so new lines don't
-  // overlap existing ones), but the GPU draw path uses a parallel
-  // `pendingInstances` accumulator that's flushed each frame and cleared.
+  // OneShotDraw mode: when enabled, each constrained line is drawn EXACTLY
+  // ONCE (the first drawInstanced after it's added) rather than re-drawn every
+  // frame. The lines are still all kept for occlusion-test memory (so new
+  // lines don't overlap existing ones); each draw uploads only the ones added
+  // since the last, and a line evicted before then is never drawn.
   // Designed for "slab" cells where each minor line is a one-shot deposit into
   // a persistent layer (clearOnUpdate:false), and the cell relies on Fluid
   // dissipation or a FadeMod for natural decay. Disabled by default for
   // backward compatibility with all existing cells.
-  // Side effect: ClearMinorFraction becomes memory-only — removes instances
+  // Side effect: ClearMinorFraction becomes memory-only — removes lines
   // from occlusion memory (freeing space for new non-overlapping lines) but
   // does NOT undo their painted pixels in the FBO. That's appropriate for
   // slab-aesthetic cells; for cells that want visual ClearMinorFraction, leave
   // OneShotDraw disabled.
-  void setOneShotDraw(bool enabled);
+  // In async geometry mode the switch is queued like the submit* calls and
+  // takes effect on the geometry thread; false if the queue is full.
+  bool setOneShotDraw(bool enabled);
+
+  // Async geometry mode (opt-in). While enabled, a dedicated thread owns the
+  // division model: updateUnconstrainedDividerLines and addConstrainedDividerLine
+  // run there, fed by a lock-free SPSC queue filled with the submit* calls
+  // below (from one producer thread). After each batch the geometry thread
+  // publishes an immutable snapshot of the constrained lines and major-line endpoints;
+  // the draw calls render whichever snapshot was latched last, so the renderer
+  // never blocks on geometry and simply redraws the previous snapshot when
+  // geometry falls behind.
+  // While enabled, don't call the geometry methods or touch
+  // unconstrainedDividerLines/constrainedDividerLines directly. Parameters may
+  // still be changed from the GUI; the geometry thread reads them as it goes.
+  // Disabling stops the thread after applying anything still queued.
+  void setAsyncGeometry(bool enabled);
+  bool isAsyncGeometry() const { return asyncGeometry != nullptr; }
+  // Return false (dropping the input) if the queue is full
+  bool submitMajorRefPoints(std::vector<glm::vec2> majorRefPoints, float dt = getFrameDeltaTime());
+  bool submitConstrainedDividerLine(const ConstrainedLineRequest& request);
+  // Lock-free input ingestion for analysis threads. Major ref points travel as
+  // whole frames where only the latest one matters: publishMajorRefPoints
+  // (one producer thread) overwrites any frame not yet drained, copying into
+  // recycled storage. Constrained-line requests go through a bounded MPSC ring
+  // that any number of threads may fill; requests arriving when it's full are
+  // dropped and counted. drainInputs, on the thread that owns the geometry (or
+  // automatically by the async geometry thread), applies the latest major frame
+  // and then every queued request in one batch.
+  void publishMajorRefPoints(geom::PointView majorRefPoints);
+  bool enqueueConstrainedDividerLine(const ConstrainedLineRequest& request);
+  uint64_t getDroppedConstrainedLineRequestCount() const { return droppedConstrainedLineRequests.load(std::memory_order_relaxed); }
+  struct InputDrainStats {
+    bool majorFrameApplied = false;
+    bool majorLinesChanged = false;
+    size_t constrainedLinesApplied = 0;
+    size_t constrainedLinesAdded = 0;
+  };
+  InputDrainStats drainInputs(float dt = getFrameDeltaTime());
+
+  // Frame-budgeted insertion, from the thread that owns the geometry.
+  // Candidates wait in a queue, highest priority first (oldest first among
+  // equals); processInsertions tries them until the deadline passes and leaves
+  // the rest for later frames. Each call counts as a frame, and candidates
+  // still waiting after maxInsertionAge frames are dropped unattempted.
+  using InsertionClock = std::chrono::steady_clock;
+  void scheduleConstrainedDividerLine(const ConstrainedLineRequest& request, float priority = 0.0f);
+  struct InsertionStats {
+    size_t attempts = 0;
+    size_t accepts = 0;
+    size_t dropped = 0; // aged out
+    size_t deferred = 0; // in saturated cells, kept for later frames
+    size_t pending = 0; // left for later frames
+  };
+  InsertionStats processInsertions(InsertionClock::time_point deadline);
+  const InsertionStats& getLastInsertionStats() const { return lastInsertionStats; }
+  size_t getPendingInsertionCount() const { return scheduledInsertions.size(); }
+  void clearScheduledInsertions() { scheduledInsertions.clear(); }
+
+  // Coarse histogram of the constrained lines, kept up to date on insertion
+  // and eviction: per cell, the lines crossing it. With densitySaturation set,
+  // a line that would be clipped around a point (see
+  // DividerLine::getShrinkTowardsPoint) in a cell crossed by that many lines
+  // is rejected before any geometry runs, and processInsertions defers such
+  // candidates rather than attempting them. Callers can use the histogram to
+  // steer new ref points towards sparse cells.
+  const DensityGrid& getDensityGrid();
+  int getLineDensity(glm::vec2 point);
+  bool isSaturated(glm::vec2 point);
+  uint64_t getSaturationRejectionCount() const { return saturationRejections; }
+
+  // Adaptive quality (opt-in): holds the time this area spends in its update
+  // and draw calls near frameTimeTarget milliseconds. Call
+  // updateAdaptiveQuality once a frame to close that frame's measurement.
+  // Sustained overruns step the quality level down; each step trims the
+  // effective max constrained lines and the attempts processInsertions may
+  // make, and from level 2 the background-sampling major styles draw as
+  // Solid. Quality only steps back up after a long run well under target, so
+  // it doesn't oscillate around it.
+  static constexpr int QUALITY_LEVELS = 6;
+  void setAdaptiveQuality(bool enabled);
+  bool isAdaptiveQuality() const { return adaptiveQuality.load(std::memory_order_relaxed); }
+  void updateAdaptiveQuality();
+  // Counts cost spent outside the area's own calls (say, a pass drawing its
+  // lines elsewhere) towards this frame's measurement
+  void addAdaptiveQualityCost(float milliseconds);
+  int getQualityLevel() const { return qualityLevel.load(std::memory_order_relaxed); }
+  // Pins the level, as replaying a recording does (InputLogPlayer); adaptive
+  // quality moves it on from there
+  void setQualityLevel(int level);
+  float getSmoothedFrameCost() const { return smoothedFrameCost; } // milliseconds
+  size_t getEffectiveMaxConstrainedLines() const;
+  size_t getEffectiveMaxInsertionAttempts() const;
+  MajorLineStyle getEffectiveMajorLineStyle() const;
+
+  // The regions the area, major and constrained lines divide the area into,
+  // indexed by region id. Maintained from the subdivision: adding a
+  // constrained line only touches the regions it crosses (a split region
+  // keeps its id for one side), and only those are re-extracted. Moving majors
+  // or evicting lines rebuilds every region, renumbering them, and changes
+  // getRegionsGeneration(). Call from the thread that owns the geometry.
+  const std::vector<DividedAreaRegion>& getRegions();
+  uint64_t getRegionsGeneration() const { return regionsGeneration; }
+  // Point location through the subdivision's grid, which is kept up to date
+  // as lines are added (and rebuilt after majors move or lines are evicted),
+  // so a query only looks at edges near the point. Region 0 is outside the
+  // area. locateBatch only finds region ids, for many points per frame (e.g.
+  // particles); getRegionBoundingLines fills in the rest for the ones needed.
+  RegionLocation locate(glm::vec2 point);
+  void locateBatch(geom::PointView points, std::vector<int>& regions);
+  void getRegionBoundingLines(int region, std::vector<DividerLineRef>& lines);
+
+  // Live reflow (opt-in): constrained lines follow the majors as they move.
+  // Each constrained line remembers which line each of its ends stops on.
+  // When majors move, only the lines that stopped on them or that they now
+  // cross are re-clipped, against the area, the majors and the constrained
+  // lines older than them, as at insertion; then the lines that stopped on, or
+  // are now crossed by, a re-clipped line, and so on. Those lines are found
+  // through the density grid, so the cost follows the lines affected. Re-clipped
+  // lines are patched into their instance ring slots in place. Enabling
+  // re-clips every line once.
+  void setLiveReflow(bool enabled);
+  bool isLiveReflow() const { return liveReflow; }
+  // Constrained lines that moved in the last reflow
+  size_t getLastReflowLineCount() const { return lastReflowLineCount; }
+
+  // Render thread: pick up the newest published snapshot, if any. drawInstanced
+  // does this itself; call it first when drawing major lines before (or
+  // without) drawInstanced in a frame. Returns how many queued calls (submit*
+  // and setOneShotDraw) the latched snapshot reflects.
+  uint64_t latchAsyncGeometry();
+  // Render thread, async mode: the latched snapshot's lines (none otherwise)
+  const ConstrainedLineStore& getLatchedConstrainedLines() const;
+  const DividerLines& getLatchedMajorLines() const { return asyncMajorLines; }
+
+  // Input recording: InputLogRecorder attaches itself here while open, and
+  // is handed each geometry call made from outside the area, as it's made.
+  // Attaching restarts the Random eviction policy's sequence, so a replay
+  // into a new area evicts the same lines.
+  void setInputRecorder(InputLogRecorder* recorder);
+  InputLogRecorder* getInputRecorder() const { return inputRecorder; }
 
 private:
   float getUnconstrainedSmoothnessEffective() const;
 
+  // Per-call settings shared by the major line update paths
+  struct MajorLineTracking {
+    float dt;
+    float occlusionDistance;
+    float endpointMatchThreshold2; // squared threshold for endpoint matching
+    float minRefPointDistance;
+    float stabilityRadius;
+    float springStrength;
+    float damping;
+    int hysteresisFrames;
+    int deleteHysteresisFrames;
+  };
+  MajorLineTracking getMajorLineTracking(float dt) const;
+
+  // The geometry update paths (updateUnconstrainedDividerLines,
+  // addConstrainedDividerLine) only touch CPU state so they can run on worker
+  // threads; GPU buffers are (re)allocated lazily by drawInstanced.
   void setupInstancedDraw(int instanceNumber);
-  std::vector<DividerInstance> instances; // ring buffer (occlusion memory + legacy-mode GPU upload)
-  mutable ofBufferObject instanceBO; // GPU buffer for ring instances
-  mutable ofVbo vbo; // instance vertices (ring)
+  void setConstrainedLineCapacity(int newCapacity);
+  bool reserveInstanceBuffers(int requiredCapacity);
+  int getInstanceBufferCapacity() const;
+  mutable ofBufferObject instanceBO; // GPU copy of constrainedDividerLines
+  mutable ofVbo vbo; // instance vertices
   ofMesh quad; // for each instance
   DividerLineShader shader; // instanced render
-  int instanceCapacity = 0;
-  mutable int instanceCount = 0;
-  int head = 0;
-  mutable bool instancesDirty = false;
-
-  // OneShotDraw state. `pendingInstances` accumulates new instances since the
-  // last drawInstanced flush; the parallel `pendingBO`/`pendingVbo` are
-  // dedicated GPU resources for one-shot draws. Bounded by ring capacity in
-  // practice (you'd never queue more than the ring can hold per frame).
-  bool oneShotDraw = false;
-  std::vector<DividerInstance> pendingInstances;
+  // The shape parameters as a uniform buffer, shared with other areas shaped
+  // the same; reacquired on the next draw after any of them changes
+  std::shared_ptr<ofBufferObject> shapeBuffer;
+  bool shapeBufferStale = true;
+  ofEventListeners shapeParameterListeners;
+  int instanceCapacity = 0; // maxConstrainedLines as last applied
+  // instanceBO mirrors the storage of constrainedDividerLines, evicted lines
+  // included, and is drawn from its head; so evicting the oldest lines
+  // uploads nothing, and only compacting the store, now and then, uploads
+  // it all. The indices below are into that storage. From instancesDirtyFrom
+  // on it differs from instanceBO, as do the lines in changedInstances; lines
+  // are only ever appended past it, so just compaction and removals move it
+  // back, and lines edited in place are listed until there are too many.
+  size_t instancesDirtyFrom = 0;
+  std::vector<size_t> changedInstances;
+  static constexpr size_t MAX_CHANGED_INSTANCES = 64;
+  InstanceChanges instanceChanges; // uploadInstanceChanges' scratch
+  // Render side, so drawInstancedAsync and resetInstanceChanges leave the
+  // geometry thread's tracking above alone: instanceBO was reallocated, or
+  // filled some other way, since uploadInstanceChanges
+  bool instanceBOLost = false;
+  size_t boundInstanceHead = 0; // the first instance vbo's attributes point at
+  // Bounds of the storage in runs of INSTANCE_BUCKET_SIZE, for culling; the
+  // lines before instanceBoundsValid are covered
+  struct InstanceBucket {
+    glm::vec2 min, max;
+    float maxWidth;
+  };
+  std::vector<InstanceBucket> instanceBuckets;
+  size_t instanceBoundsValid = 0;
+  std::vector<std::pair<size_t, size_t>> visibleInstanceRanges; // first, count
+  void markConstrainedLinesChanged(size_t from); // an index into constrainedDividerLines
+  void markConstrainedLineChanged(size_t index); // just the one, once it's written
+  void uploadInstanceChanges();
+  void updateInstanceBuckets();
+  int allocatedInstanceCapacity = 0; // of instanceBO and pendingBO
+
+  // OneShotDraw state: the constrained lines from firstPendingSerial on are
+  // yet to be drawn, through the dedicated `pendingBO`/`pendingVbo`. They're
+  // all in storage from firstPendingSlot on. Written by the geometry thread in
+  // async mode.
+  std::atomic<bool> oneShotDraw { false };
+  void applyOneShotDraw(bool enabled);
+  uint64_t firstPendingSerial = 0;
+  size_t firstPendingSlot = 0;
+  ConstrainedDividerLines pendingLines;
+  const ConstrainedDividerLines& takePendingConstrainedLines();
+  void skipPendingConstrainedLines();
   mutable ofBufferObject pendingBO;
   mutable ofVbo pendingVbo;
 
@@ -196,9 +544,138 @@ private:
   std::unique_ptr<RefractiveLineShader> refractiveLineShader;
   std::unique_ptr<BlurRefractionLineShader> blurRefractionLineShader;
   std::unique_ptr<ChromaticAberrationLineShader> chromaticAberrationLineShader;
+  BackgroundPyramid backgroundPyramid; // what the background styles sample, built once a draw
+  mutable RenderStats renderStats;
   
   void drawMajorLine(const DividerLine& dl, float width, float scale, 
                      const ofFloatColor& color, const ofFbo* backgroundFbo);
 
   ParameterOverrides parameterOverrides_;
+
+  // Shared by the legacy ring and OneShotDraw paths (and async mode)
+  void drawInstanceBuffer(const ofVbo& instanceVbo, int count, float scale);
+  void beginInstancedDraw(float scale);
+  void endInstancedDraw();
+
+  // Explicit subdivision of the area by its boundary, major and constrained
+  // lines, for the regions and point location. Inserting a line updates it in
+  // place; moving majors or evicting lines marks it stale, and it's rebuilt
+  // when it's next queried. Edges are tagged with the line's position in
+  // area, major, constrained order.
+  PlanarSubdivision subdivision;
+  bool subdivisionStale = true;
+  void onMajorLinesChanged();
+  void invalidateSubdivision();
+  void rebuildSubdivision();
+  void insertIntoSubdivision(glm::vec2 start, glm::vec2 end, uint32_t line);
+
+  std::vector<DividedAreaRegion> regions;
+  uint64_t regionsGeneration = 0;
+  uint64_t lastRegionVersion = 0;
+  std::vector<int> changedRegions;
+  std::vector<std::vector<glm::vec2>> regionLoops;
+  void updateRegion(int region);
+
+  // Kept in step with constrainedDividerLines only while raster occlusion is
+  // in use; rebuilt from the lines when it's next needed otherwise
+  OcclusionRaster occlusionRaster;
+  bool occlusionRasterCurrent = false;
+  bool isConstrainedLineOccluded(const DividerLine& dividerLine);
+
+  // Constrained lines are identified by serial numbers that count every
+  // constrained line ever added, so eviction doesn't renumber them. Serials
+  // rise with the index, so a serial's line is a binary search away, until an
+  // eviction from the middle moves the oldest line; from then until the store
+  // next compacts, or drops its oldest lines, and is sorted again,
+  // constrainedLineSlots finds them.
+  HeadOffsetVector<uint64_t> constrainedLineSerials; // parallel to constrainedDividerLines
+  uint64_t nextConstrainedSerial = 0;
+  bool constrainedLinesInSerialOrder = true;
+  std::unordered_map<uint64_t, size_t> constrainedLineSlots; // serial to storage index, while out of order
+  std::vector<size_t> constrainedLineOrder;
+  // In serial order, where the line is or would be; otherwise size() if it's gone
+  size_t findConstrainedDividerLine(uint64_t serial) const;
+  // The indices of the lines with serials below olderThan, oldest first
+  const std::vector<size_t>& orderConstrainedDividerLines(uint64_t olderThan);
+  void restoreConstrainedLineOrder();
+  void eraseFrontConstrainedLineSlots(size_t count); // the lines in them already removed elsewhere
+
+  // Eviction, the density pre-check and finding the lines a clip can hit
+  DensityGrid densityGrid; // ids are serials
+  uint64_t saturationRejections = 0;
+  void updateDensityGridResolution();
+  std::minstd_rand evictionRandom;
+  void makeRoomForConstrainedDividerLine();
+
+  // Live reflow
+  static constexpr uint64_t NO_REFLOW_SUPPORT = ~uint64_t(0);
+  struct ReflowSupport {
+    DividerLineRef::Kind kind = DividerLineRef::Kind::Area;
+    uint64_t id = NO_REFLOW_SUPPORT; // area index, major serial or constrained serial
+  };
+  struct ReflowSupports { ReflowSupport start, end; };
+  // Clips as createConstrainedDividerLine does, against the constrained lines
+  // with serials below olderThan, and notes what each end stopped on
+  DividerLine clipConstrainedDividerLine(glm::vec2 ref1, glm::vec2 ref2, uint64_t olderThan, ReflowSupports* supports = nullptr);
+  bool liveReflow = false;
+  HeadOffsetVector<ReflowSupports> constrainedLineSupports; // parallel to constrainedDividerLines while live reflow is on
+  uint32_t nextMajorSerial = 0;
+  std::vector<std::pair<uint32_t, Line>> reflowMajorPositions; // majors by serial as of the last reflow
+  size_t lastReflowLineCount = 0;
+  bool reflowConstrainedDividerLine(size_t index);
+  void reflowConstrainedDividerLines();
+
+  TripleBuffer<std::vector<glm::vec2>> majorRefPointInput;
+  MpscQueue<ConstrainedLineRequest> constrainedLineInput { 4096 };
+  std::atomic<uint64_t> droppedConstrainedLineRequests { 0 };
+
+  // Frame-budgeted insertion: a binary heap on ScheduledInsertion::operator<
+  struct ScheduledInsertion {
+    ConstrainedLineRequest request;
+    float priority;
+    uint64_t frame; // insertionFrame when scheduled
+    uint64_t sequence;
+    bool operator<(const ScheduledInsertion& other) const {
+      if (priority != other.priority) return priority < other.priority;
+      return sequence > other.sequence;
+    }
+  };
+  std::vector<ScheduledInsertion> scheduledInsertions;
+  uint64_t insertionFrame = 0;
+  uint64_t nextInsertionSequence = 0;
+  uint64_t oldestScheduledFrame = 0;
+  InsertionStats lastInsertionStats;
+
+  // Adaptive quality. The cost is summed by whichever thread runs the work
+  // (the async geometry thread included); the rest belongs to the caller of
+  // updateAdaptiveQuality.
+  struct QualityCostTimer;
+  std::atomic<bool> adaptiveQuality { false };
+  std::atomic<int> qualityLevel { 0 };
+  mutable std::atomic<int64_t> qualityFrameCost { 0 }; // nanoseconds this frame
+  float smoothedFrameCost = 0.0f;
+  int framesOverTarget = 0;
+  int framesUnderTarget = 0;
+
+  // Geometry calls in progress, so those the area makes itself (evicting to
+  // make room, say) aren't recorded as well as the call that made them
+  struct InputRecordScope;
+  InputLogRecorder* inputRecorder = nullptr;
+  int inputCallDepth = 0;
+
+  // Async geometry state lives in DividedAreaAsync.cpp
+  struct AsyncGeometry;
+  struct AsyncGeometryDeleter { void operator()(AsyncGeometry* async) const; };
+  std::unique_ptr<AsyncGeometry, AsyncGeometryDeleter> asyncGeometry;
+  void drawInstancedAsync(float scale);
+  // The major lines to draw: the live lines, or the latched snapshot's copy
+  // in async mode (render thread only, so their meshes stay on the GL thread)
+  DividerLines asyncMajorLines;
+  template<typename F> void forEachMajorLineToDraw(F&& fn) const {
+    if (asyncGeometry) {
+      for (const auto& dl : asyncMajorLines) fn(dl);
+    } else {
+      for (const auto& dl : unconstrainedDividerLines) fn(dl);
+    }
+  }
 };
@@ -1,6 +1,24 @@
 #include "ofApp.h"
 #include "LineGeom.h"
 #include "DividerLine.hpp"
+#include "WorkStealingPool.hpp"
+#include "ConcurrentQueues.h"
+#include "GeomUtils.h"
+#include "ofxDividedArea.h"
+#include "PlanarSubdivision.hpp"
+#include "RegionFill.hpp"
+#include "SoftwareLineRasterizer.hpp"
+#include "BatchedLineRenderer.hpp"
+#include "GeometryTimeline.hpp"
+#include "InputLog.hpp"
+#include "SharedLineSet.hpp"
+#include "DividedAreaGroup.hpp"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 
 static void expect(bool cond, std::vector<std::string>& failures, const std::string& msg){ if(!cond) failures.push_back(msg); }
 
@@ -81,4 +99,714 @@ void ofApp::runTests(){
     bool occ = a.isOccludedBy(b, 0.1f, 0.99f);
     expect(occ==false, failures, "zero-length line should not be considered occluded");
   }
+  // Work-stealing pool runs every index exactly once
+  {
+    WorkStealingPool pool(3);
+    std::vector<int> hits(101, 0);
+    pool.parallelFor(hits.size(), [&](size_t i){ hits[i]++; });
+    expect(std::all_of(hits.begin(), hits.end(), [](int h){ return h == 1; }), failures, "parallelFor should run each index once");
+  }
+  // A task that throws ends parallelFor with its exception, and the pool carries on
+  {
+    WorkStealingPool pool(3);
+    bool caught = false;
+    try {
+      pool.parallelFor(64, [](size_t i){ if (i == 7) throw std::runtime_error("task 7"); });
+    } catch (const std::runtime_error& error) {
+      caught = std::string(error.what()) == "task 7";
+    }
+    expect(caught, failures, "parallelFor rethrows a task's exception");
+    std::atomic<int> ran { 0 };
+    pool.parallelFor(64, [&](size_t){ ++ran; });
+    expect(ran == 64, failures, "pool runs every task after a throw");
+  }
+  // SPSC queue is FIFO and bounded; triple buffer hands over only the latest value
+  {
+    SpscQueue<int> queue(4);
+    for (int i = 0; i < 4; ++i) expect(queue.push(i), failures, "spsc push within capacity");
+    expect(!queue.push(4), failures, "spsc push should fail when full");
+    int value = -1;
+    expect(queue.pop(value) && value == 0, failures, "spsc pops in FIFO order");
+    TripleBuffer<int> latest;
+    expect(!latest.update(), failures, "triple buffer has nothing fresh initially");
+    latest.getWriteBuffer() = 1; latest.publish();
+    latest.getWriteBuffer() = 2; latest.publish();
+    expect(latest.update() && latest.getReadBuffer() == 2, failures, "triple buffer latest value wins");
+    expect(!latest.update() && latest.getReadBuffer() == 2, failures, "triple buffer keeps the last value when nothing new");
+  }
+  // MPSC queue is FIFO, bounded, and reusable after draining
+  {
+    MpscQueue<int> queue(2);
+    expect(queue.push(1) && queue.push(2), failures, "mpsc push within capacity");
+    expect(!queue.push(3), failures, "mpsc push should fail when full");
+    int value = -1;
+    expect(queue.pop(value) && value == 1, failures, "mpsc pops in FIFO order");
+    expect(queue.push(3), failures, "mpsc push succeeds after a pop frees a slot");
+    expect(queue.pop(value) && value == 2 && queue.pop(value) && value == 3, failures, "mpsc keeps order across wrap");
+    expect(!queue.pop(value), failures, "mpsc pop fails when empty");
+  }
+  // Strided point view reads positions in place from caller structs
+  {
+    struct Cluster { float weight; glm::vec2 centre; int id; };
+    std::vector<Cluster> clusters { {1.0f, {1,2}, 7}, {0.5f, {3,4}, 8} };
+    auto view = geom::PointView::of(clusters.data(), clusters.size(), &Cluster::centre);
+    expect(view.size() == 2 && view[1] == glm::vec2{3,4}, failures, "point view reads strided members");
+    expect(geom::containsPoint(view, {1,2}), failures, "containsPoint through point view");
+    auto close = geom::findClosePoint(view, {3.1f,4.0f}, 0.5f);
+    expect(close && *close == glm::vec2{3,4}, failures, "findClosePoint through point view");
+    std::vector<glm::vec3> points3 { {5,6,7} };
+    expect(geom::PointView(points3)[0] == glm::vec2{5,6}, failures, "point view over vec3 takes x,y");
+  }
+  // Id-keyed major lines keep their identity when their ref points jump
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    std::vector<IdentifiedRefPoint> refPoints { {10, {0.2f, 0.2f}}, {11, {0.8f, 0.3f}} };
+    area.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+    expect(area.unconstrainedDividerLines.size() == 1, failures, "id-keyed update adds a line");
+    refPoints = { {10, {0.3f, 0.9f}}, {11, {0.4f, 0.1f}} };
+    area.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+    expect(area.unconstrainedDividerLines.size() == 1, failures, "id-keyed line survives a jump");
+    if (!area.unconstrainedDividerLines.empty()) {
+      const auto& line = area.unconstrainedDividerLines.front();
+      expect(line.framesWithoutMatch == 0 && line.ref1 == glm::vec2{0.3f, 0.9f}, failures, "id-keyed line follows its ref points");
+    }
+  }
+  // Subdivision: a square cut by a cross gives four faces, each found by locate
+  {
+    PlanarSubdivision subdivision;
+    subdivision.reset({0,0}, {1,1}, 4, 1e-6f);
+    subdivision.insertSegment({0,0}, {1,0}, 0);
+    subdivision.insertSegment({1,0}, {1,1}, 1);
+    subdivision.insertSegment({1,1}, {0,1}, 2);
+    subdivision.insertSegment({0,1}, {0,0}, 3);
+    subdivision.insertSegment({0.5f,0}, {0.5f,1}, 4);
+    subdivision.insertSegment({0,0.5f}, {1,0.5f}, 5);
+    subdivision.insertSegment({0.2f,0.2f}, {0.3f,0.3f}, 6); // floating inside one quadrant
+    expect(subdivision.isValid(), failures, "subdivision stays valid");
+    expect(subdivision.getFaceCount() == 5, failures, "square cut by a cross has four bounded faces");
+    int lowerLeft = subdivision.locateFace({0.1f, 0.3f});
+    int upperRight = subdivision.locateFace({0.9f, 0.8f});
+    expect(lowerLeft != PlanarSubdivision::UNBOUNDED_FACE && upperRight != PlanarSubdivision::UNBOUNDED_FACE && lowerLeft != upperRight, failures, "locate finds distinct quadrants");
+    expect(subdivision.getFace(lowerLeft).holes.size() == 1, failures, "floating segment is a hole in its quadrant");
+    expect(subdivision.locateFace({2, 0.5f}) == PlanarSubdivision::UNBOUNDED_FACE, failures, "outside locates to the unbounded face");
+  }
+  // Regions of a divided area tile it, and triangulate to the same area
+  {
+    auto triangleArea = [](const std::vector<glm::vec2>& triangles) {
+      float area = 0.0f;
+      for (size_t i = 0; i + 2 < triangles.size(); i += 3) area += geom::cross2(triangles[i+1] - triangles[i], triangles[i+2] - triangles[i]) * 0.5f;
+      return area;
+    };
+    DividedArea area({1.0, 1.0}, 3);
+    area.addConstrainedDividerLine({0.5f, 0.2f}, {0.5f, 0.8f}, ofFloatColor(1.0f));
+    area.addConstrainedDividerLine({0.1f, 0.4f}, {0.3f, 0.4f}, ofFloatColor(1.0f));
+    const auto& regions = area.getRegions();
+    float total = 0.0f;
+    int regionCount = 0;
+    for (const auto& region : regions) {
+      if (region.outline.empty()) continue;
+      std::vector<glm::vec2> triangles;
+      RegionFillRenderer::triangulate(region, triangles);
+      total += triangleArea(triangles);
+      ++regionCount;
+    }
+    expect(regionCount == 3, failures, "two lines cut the area into three regions");
+    expect(std::fabs(total - 1.0f) < 1e-4f, failures, "region triangles cover the area");
+    DividedAreaRegion square { {{0,0}, {1,0}, {1,1}, {0,1}}, {{{0.25f,0.25f}, {0.25f,0.75f}, {0.75f,0.75f}, {0.75f,0.25f}}} };
+    std::vector<glm::vec2> triangles;
+    RegionFillRenderer::triangulate(square, triangles);
+    expect(std::fabs(triangleArea(triangles) - 0.75f) < 1e-5f, failures, "triangulation leaves holes out");
+  }
+  // Point location finds the region and the lines around it
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.addConstrainedDividerLine({0.5f, 0.2f}, {0.5f, 0.8f}, ofFloatColor(1.0f));
+    area.addConstrainedDividerLine({0.1f, 0.4f}, {0.3f, 0.4f}, ofFloatColor(1.0f));
+    RegionLocation location = area.locate({0.25f, 0.2f});
+    expect(location.region > 0 && !area.getRegions()[location.region].outline.empty(), failures, "locate finds a region inside the area");
+    int constrained = 0, areaEdges = 0;
+    for (const auto& line : location.boundingLines) {
+      if (line.kind == DividerLineRef::Kind::Constrained) ++constrained;
+      if (line.kind == DividerLineRef::Kind::Area) ++areaEdges;
+    }
+    expect(constrained == 2 && areaEdges == 2, failures, "located region is bounded by both lines and two area edges");
+    std::vector<glm::vec2> points { {0.25f, 0.2f}, {0.25f, 0.6f}, {0.75f, 0.5f}, {2.0f, 0.5f} };
+    std::vector<int> regions;
+    area.locateBatch(points, regions);
+    expect(regions[0] == location.region && regions[1] != regions[0] && regions[2] != regions[0] && regions[2] != regions[1], failures, "batch locate separates the regions");
+    expect(regions[3] == 0, failures, "points outside the area are in region 0");
+  }
+  // Live reflow keeps a constrained line stopping on the major it was clipped to
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    std::vector<glm::vec2> refPoints { {0.1f, 0.5f}, {0.9f, 0.5f} };
+    area.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+    area.setLiveReflow(true);
+    area.addConstrainedDividerLine({0.3f, 0.2f}, {0.3f, 0.3f}, ofFloatColor(1.0f));
+    expect(std::fabs(area.constrainedDividerLines[0].end.y - 0.5f) < 1e-4f, failures, "constrained line stops on the major");
+    refPoints = { {0.1f, 0.7f}, {0.9f, 0.7f} };
+    for (int i = 0; i < 600; ++i) area.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+    const auto& major = area.unconstrainedDividerLines.front();
+    expect(std::fabs(major.start.y - 0.7f) < 1e-3f, failures, "major settles on its new ref points");
+    expect(std::fabs(area.constrainedDividerLines[0].end.y - major.start.y) < 1e-4f, failures, "reflowed constrained line follows the major");
+  }
+  // Raster occlusion rejects a near-duplicate, until the line it overlaps is evicted
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.setConstrainedOcclusionMode(ConstrainedOcclusionMode::Raster);
+    area.occlusionRasterResolutionParameter = 64;
+    expect(area.addConstrainedDividerLine({0.3f, 0.2f}, {0.3f, 0.3f}, ofFloatColor(1.0f)).has_value(), failures, "first line accepted");
+    expect(!area.addConstrainedDividerLine({0.301f, 0.4f}, {0.301f, 0.6f}, ofFloatColor(1.0f)).has_value(), failures, "parallel line in the same cells rejected");
+    expect(area.addConstrainedDividerLine({0.2f, 0.5f}, {0.4f, 0.5f}, ofFloatColor(1.0f)).has_value(), failures, "crossing line accepted");
+    area.deleteEarlyConstrainedDividerLines(1);
+    expect(area.addConstrainedDividerLine({0.301f, 0.4f}, {0.301f, 0.6f}, ofFloatColor(1.0f)).has_value(), failures, "parallel line accepted after eviction");
+  }
+  // Scheduled insertions go highest priority first, and age out when the budget keeps running out
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.scheduleConstrainedDividerLine({ {0.3f, 0.2f}, {0.3f, 0.3f}, ofFloatColor(1.0f) }, 0.0f);
+    area.scheduleConstrainedDividerLine({ {0.2f, 0.6f}, {0.3f, 0.6f}, ofFloatColor(1.0f) }, 1.0f);
+    auto stats = area.processInsertions(DividedArea::InsertionClock::now() + std::chrono::seconds(10));
+    expect(stats.attempts == 2 && stats.accepts == 2 && stats.pending == 0, failures, "both scheduled lines inserted");
+    expect(area.constrainedDividerLines.size() == 2 && area.constrainedDividerLines[0].start.y == 0.6f, failures, "higher priority inserted first");
+
+    area.maxInsertionAgeParameter = 1;
+    area.scheduleConstrainedDividerLine({ {0.7f, 0.2f}, {0.7f, 0.3f}, ofFloatColor(1.0f) });
+    auto expired = DividedArea::InsertionClock::now() - std::chrono::seconds(1);
+    stats = area.processInsertions(expired);
+    expect(stats.attempts == 0 && stats.pending == 1, failures, "candidate carried over when out of budget");
+    stats = area.processInsertions(expired);
+    expect(stats.dropped == 1 && area.getPendingInsertionCount() == 0, failures, "aged candidate dropped");
+  }
+  // Adaptive quality steps down under sustained overruns, and back up once well under target
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.setMajorLineStyle(MajorLineStyle::Refractive);
+    area.frameTimeTargetParameter = 0.5f;
+    area.setAdaptiveQuality(true);
+    for (int frame = 0; frame < 40; ++frame) {
+      area.addAdaptiveQualityCost(2.0f);
+      area.updateAdaptiveQuality();
+    }
+    expect(area.getQualityLevel() == 3, failures, "quality stepped down once per sustained overrun");
+    expect(area.getEffectiveMaxConstrainedLines() < static_cast<size_t>(area.maxConstrainedLinesParameter.get()), failures, "max lines trimmed");
+    expect(area.getEffectiveMajorLineStyle() == MajorLineStyle::Solid, failures, "background style falls back to Solid");
+    for (int frame = 0; frame < 1000; ++frame) area.updateAdaptiveQuality();
+    expect(area.getQualityLevel() == 0 && area.getEffectiveMajorLineStyle() == MajorLineStyle::Refractive, failures, "quality restored");
+  }
+  // Past the cap, one line goes per line added, and the densest policy takes it from the busiest cell
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.maxConstrainedLinesParameter = 50;
+    area.setConstrainedEvictionPolicy(ConstrainedEvictionPolicy::Densest);
+    for (int i = 0; i < 35; ++i) {
+      float x = 0.002f + 0.0017f * i;
+      area.addConstrainedDividerLine({x, 0.4f}, {x, 0.6f}, ofFloatColor(1.0f));
+    }
+    for (int i = 0; i < 20; ++i) {
+      float y = 0.05f + 0.045f * i;
+      area.addConstrainedDividerLine({0.6f, y}, {0.9f, y}, ofFloatColor(1.0f));
+    }
+    const auto& lines = area.constrainedDividerLines;
+    auto horizontal = std::count_if(lines.begin(), lines.end(), [](const auto& dl) { return dl.ref1.x == 0.6f; });
+    expect(lines.size() == 50, failures, "line count held at the cap");
+    expect(horizontal == 20, failures, "lines in sparse cells kept, dense ones evicted");
+  }
+  // A cell's line ids stay oldest first when a line is moved, as a reflow does
+  {
+    DensityGrid grid;
+    grid.reset({1.0f, 1.0f}, 4);
+    for (uint64_t id : { 1, 2, 3 }) grid.addLine({0.1f, 0.1f}, {0.2f, 0.1f}, id);
+    grid.removeLine({0.1f, 0.1f}, {0.2f, 0.1f}, 1);
+    grid.addLine({0.1f, 0.12f}, {0.2f, 0.12f}, 1);
+    const auto& ids = grid.getLineIds(grid.getCell({0.15f, 0.1f}));
+    expect(ids.size() == 3 && ids.front() == 1, failures, "moved line is still the cell's oldest");
+  }
+  // Requests in saturated cells are turned away before clipping, and deferred when scheduled
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.densityGridResolutionParameter = 4;
+    area.densitySaturationParameter = 3;
+    for (float x : { 0.05f, 0.1f, 0.15f }) area.addConstrainedDividerLine({x, 0.4f}, {x, 0.6f}, ofFloatColor(1.0f));
+    expect(area.getLineDensity({0.2f, 0.3f}) == 3 && area.getLineDensity({0.6f, 0.6f}) == 0, failures, "histogram counts the lines crossing each cell");
+    expect(!area.addConstrainedDividerLine({0.2f, 0.3f}, {0.22f, 0.35f}, ofFloatColor(1.0f)).has_value(), failures, "saturated request rejected");
+    expect(area.getSaturationRejectionCount() == 1, failures, "rejection counted");
+    expect(area.addConstrainedDividerLine({0.6f, 0.6f}, {0.7f, 0.65f}, ofFloatColor(1.0f)).has_value(), failures, "sparse request accepted");
+    glm::vec2 sparse = area.getDensityGrid().getCellCenter(area.getDensityGrid().getSparsestCell());
+    expect(sparse.x > 0.25f, failures, "sparsest cell away from the busy column");
+    area.scheduleConstrainedDividerLine({ {0.2f, 0.7f}, {0.21f, 0.8f}, ofFloatColor(1.0f) });
+    auto stats = area.processInsertions(DividedArea::InsertionClock::now() + std::chrono::seconds(10));
+    expect(stats.attempts == 0 && stats.deferred == 1 && stats.pending == 1, failures, "saturated candidate deferred");
+  }
+  // Shrinking the cap evicts the oldest lines and keeps the newest in order
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.maxConstrainedLinesParameter = 100;
+    for (int i = 0; i < 80; ++i) {
+      float x = 0.01f + 0.012f * i;
+      area.addConstrainedDividerLine({x, 0.4f}, {x, 0.6f}, ofFloatColor(1.0f));
+    }
+    area.maxConstrainedLinesParameter = 50;
+    area.addConstrainedDividerLine({0.1f, 0.95f}, {0.2f, 0.95f}, ofFloatColor(1.0f));
+    const auto& lines = area.constrainedDividerLines;
+    expect(lines.size() == 50, failures, "shrunk to the new cap");
+    expect(lines.front().ref1.x == 0.01f + 0.012f * 31 && lines.back().ref1.y == 0.95f, failures, "oldest evicted, order kept");
+  }
+  // A constrained line is stored once, with how it's drawn alongside its span
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.constrainedWidthParameter = 0.004f;
+    area.addConstrainedDividerLine({0.3f, 0.4f}, {0.3f, 0.6f}, ofFloatColor(1.0f, 0.0f, 0.0f));
+    area.addConstrainedDividerLine({0.5f, 0.4f}, {0.5f, 0.6f}, ofFloatColor(0.0f, 0.0f, 1.0f), 0.007f, true);
+    const auto& lines = area.constrainedDividerLines;
+    expect(lines.size() == 2 && lines[0].width == 0.004f && lines[0].style == 0.0f && lines[0].color.r == 1.0f, failures, "default width, untapered, own colour");
+    expect(lines[1].width == 0.007f && lines[1].style == 1.0f && lines[1].color.b == 1.0f, failures, "overridden width, tapered");
+    expect(lines[1].toDividerLine().end == lines[1].end && lines[1].ref1.x == 0.5f, failures, "span and ref points kept");
+  }
+  // The software rasterizer draws lines as the shader shapes them, anti-aliased
+  {
+    SoftwareLineRasterizer rasterizer(2);
+    rasterizer.allocate(100, 100);
+    ConstrainedDividerLines lines;
+    lines.push_back({ {0.2f, 0.5f}, {0.8f, 0.5f}, 0.05f, 0.0f, ofFloatColor(1.0f, 0.0f, 0.0f), {0.2f, 0.5f}, {0.8f, 0.5f} });
+    lines.push_back({ {0.1f, 0.1f}, {0.1f, 0.9f}, 0.1f, 1.0f, ofFloatColor(0.0f, 1.0f, 0.0f), {0.1f, 0.1f}, {0.1f, 0.9f} });
+    rasterizer.draw(lines, DividerLineShape {}, 100.0f);
+    expect(rasterizer.getColor(50, 50).r > 0.99f && rasterizer.getColor(50, 50).a > 0.99f, failures, "inside the line fully covered");
+    expect(rasterizer.getColor(50, 40).a == 0.0f && rasterizer.getColor(10, 50).r == 0.0f, failures, "outside the line untouched");
+    float edge = rasterizer.getColor(50, 47).r;
+    expect(edge > 0.0f && edge < 1.0f, failures, "edge pixel partly covered");
+    // Tapered and longer than maxTaperLength: 10px wide at the start narrowing to 9px at the end
+    auto coveredAcross = [&](int y) { float sum = 0.0f; for (int x = 0; x < 30; ++x) sum += rasterizer.getColor(x, y).g; return sum; };
+    expect(std::fabs(coveredAcross(10) - 10.0f) < 0.1f && std::fabs(coveredAcross(89) - 9.0f) < 0.1f, failures, "taper widths follow the shader");
+  }
+  // Render stats count what each draw uploads: only the lines that changed
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    for (float x : { 0.2f, 0.4f, 0.6f }) area.addConstrainedDividerLine({x, 0.4f}, {x, 0.6f}, ofFloatColor(1.0f));
+    area.drawInstanced(100.0f);
+    expect(area.getRenderStats().drawCalls == 1 && area.getRenderStats().uploadedBytes == 3 * sizeof(ConstrainedDividerLine), failures, "first draw uploads every line");
+    area.resetRenderStats();
+    area.addConstrainedDividerLine({0.8f, 0.4f}, {0.8f, 0.6f}, ofFloatColor(1.0f));
+    area.drawInstanced(100.0f);
+    expect(area.getRenderStats().uploadedBytes == sizeof(ConstrainedDividerLine), failures, "next draw uploads just the new line");
+  }
+  // Areas shaped the same share one uniform buffer for the shape
+  {
+    DividerLineShape shape, tapered;
+    tapered.maxTaperLength = 0.25f;
+    auto a = DividerLineShader::acquireShapeBuffer(shape);
+    auto b = DividerLineShader::acquireShapeBuffer(DividerLineShape {});
+    auto c = DividerLineShader::acquireShapeBuffer(tapered);
+    expect(a == b && a != c, failures, "identical shapes share a buffer");
+  }
+  // BlurRefraction's radius picks the nearest background pyramid level
+  {
+    expect(BackgroundPyramid::levelForBlurRadius(0.0f) == 0, failures, "no blur samples the background");
+    expect(BackgroundPyramid::levelForBlurRadius(0.5f) == 1 && BackgroundPyramid::levelForBlurRadius(1.0f) == 1, failures, "any blur samples a blurred level");
+    expect(BackgroundPyramid::levelForBlurRadius(1.5f) == 1 && BackgroundPyramid::levelForBlurRadius(8.0f) == 3, failures, "radius to level");
+    expect(BackgroundPyramid::levelForBlurRadius(1000.0f) == BackgroundPyramid::MAX_LEVEL, failures, "clamped to the top level");
+  }
+  // Batched areas share one draw, and each later draw uploads only what changed
+  {
+    DividedArea a({1.0, 1.0}, 3), b({1.0, 1.0}, 3);
+    for (float x : { 0.2f, 0.4f }) a.addConstrainedDividerLine({x, 0.4f}, {x, 0.6f}, ofFloatColor(1.0f));
+    b.addConstrainedDividerLine({0.5f, 0.2f}, {0.5f, 0.8f}, ofFloatColor(1.0f));
+    BatchedLineRenderer renderer;
+    std::vector<BatchedLineRenderer::Cell> cells { { &a }, { &b, {1.0f, 0.0f} } };
+    renderer.draw(cells, 100.0f);
+    expect(renderer.getRenderStats().drawCalls == 1 && a.getRenderStats().drawCalls == 0, failures, "one draw for both areas");
+    renderer.resetRenderStats();
+    b.addConstrainedDividerLine({0.7f, 0.2f}, {0.7f, 0.8f}, ofFloatColor(1.0f));
+    renderer.draw(cells, 100.0f);
+    expect(renderer.getRenderStats().uploadedBytes == sizeof(ConstrainedDividerLine), failures, "next draw uploads just the new line");
+  }
+  // A group keeps its draw order: an unbatchable cell splits the batch into two draws around it
+  {
+    DividedArea a({1.0, 1.0}, 3), b({1.0, 1.0}, 3), c({1.0, 1.0}, 3);
+    b.setOneShotDraw(true);
+    for (DividedArea* area : { &a, &b, &c }) area->addConstrainedDividerLine({0.5f, 0.2f}, {0.5f, 0.8f}, ofFloatColor(1.0f));
+    DividedAreaGroup group(1);
+    for (DividedArea* area : { &a, &b, &c }) group.add(*area);
+    group.drawInstanced(100.0f);
+    const auto& stats = group.getBatchedLineRenderer().getRenderStats();
+    expect(stats.drawCalls == 2 && stats.instances == 2 && b.getRenderStats().drawCalls == 1, failures, "batch split around the unbatched cell");
+    size_t uploaded = stats.uploadedBytes;
+    group.drawInstanced(100.0f);
+    expect(stats.drawCalls == 4 && stats.uploadedBytes == uploaded, failures, "split runs share one upload");
+  }
+  // A viewport draw submits only the runs of lines whose bounds reach it
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    for (int i = 0; i < 64; ++i) area.addConstrainedDividerLine({0.02f + i * 0.004f, 0.4f}, {0.02f + i * 0.004f, 0.6f}, ofFloatColor(1.0f));
+    for (int i = 0; i < 64; ++i) area.addConstrainedDividerLine({0.72f + i * 0.004f, 0.4f}, {0.72f + i * 0.004f, 0.6f}, ofFloatColor(1.0f));
+    expect(area.constrainedDividerLines.size() == 128, failures, "culling fixture lines all added");
+    area.drawInstanced(100.0f, ofRectangle(0.0f, 0.0f, 40.0f, 100.0f));
+    expect(area.getRenderStats().instances == 64 && area.getRenderStats().drawCalls == 1, failures, "left viewport draws the left run only");
+    area.resetRenderStats();
+    area.drawInstanced(100.0f, ofRectangle(0.0f, 0.0f, 100.0f, 100.0f));
+    expect(area.getRenderStats().instances == 128 && area.getRenderStats().drawCalls == 1 && area.getRenderStats().uploadedBytes == 0, failures, "adjacent runs merge into one draw, nothing re-uploaded");
+    area.resetRenderStats();
+    area.drawInstanced(100.0f, ofRectangle(30.0f, 0.0f, 40.0f, 100.0f));
+    expect(area.getRenderStats().instances == 0, failures, "viewport between the runs draws nothing");
+  }
+  // A timeline replays the ring exactly, frame by frame and after a seek
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    std::string path = (std::filesystem::temp_directory_path() / "timeline_test.divtl").string();
+    GeometryTimelineRecorder recorder;
+    expect(recorder.open(path, area.size, 4), failures, "timeline opens for writing");
+    std::vector<ConstrainedDividerLines> recorded;
+    for (int f = 0; f < 10; ++f) {
+      float x = 0.05f + f * 0.08f;
+      area.addConstrainedDividerLine({x, 0.3f}, {x, 0.7f}, ofFloatColor(1.0f));
+      if (f == 3) area.deleteEarlyConstrainedDividerLines(2);
+      if (f == 5) area.evictConstrainedDividerLine(1);
+      if (f == 6) area.constrainedDividerLines[0].color = ofFloatColor(1.0f, 0.0f, 0.0f);
+      recorder.recordFrame(area, 1.0f / 30.0f);
+      recorded.emplace_back(area.constrainedDividerLines.begin(), area.constrainedDividerLines.end());
+    }
+    recorder.close();
+    auto same = [](const ConstrainedDividerLines& a, const ConstrainedDividerLines& b) {
+      return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(ConstrainedDividerLine)) == 0;
+    };
+    GeometryTimelinePlayer player;
+    expect(player.open(path) && player.getFrameCount() == 10, failures, "timeline opens for playback");
+    bool replayed = true;
+    for (size_t f = 0; f < recorded.size(); ++f) replayed = replayed && player.nextFrame() && same(player.getConstrainedLines(), recorded[f]);
+    expect(replayed && !player.nextFrame(), failures, "timeline replays every frame");
+    expect(player.seek(7) && player.getFrame() == 7 && same(player.getConstrainedLines(), recorded[7]), failures, "timeline seeks from a keyframe");
+    player.close();
+    std::filesystem::remove(path);
+  }
+  // A replayed input log rebuilds the recorded line sets bit for bit
+  {
+    std::string path = (std::filesystem::temp_directory_path() / "input_test.divin").string();
+    DividedArea recorded({1.0, 1.0}, 3);
+    InputLogRecorder recorder;
+    expect(recorder.open(path, recorded), failures, "input log opens for writing");
+    std::minstd_rand random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    int constrainedCalls = 0;
+    for (int f = 0; f < 40; ++f) {
+      float t = f * 0.05f;
+      recorded.updateUnconstrainedDividerLines(std::vector<glm::vec2> { {0.2f + t * 0.1f, 0.3f}, {0.8f, 0.35f + t * 0.1f}, {0.5f, 0.9f} }, 1.0f / 60.0f);
+      for (int i = 0; i < 3; ++i, ++constrainedCalls) {
+        glm::vec2 ref1 { unit(random), unit(random) };
+        recorded.addConstrainedDividerLine(ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.2f, ofFloatColor(unit(random)));
+      }
+      if (f == 20) recorded.maxConstrainedLinesParameter = 50; // evicts from inside the next call
+      if (f == 30) recorded.evictConstrainedDividerLine(3);
+      recorder.checkpoint();
+    }
+    ConstrainedDividerLines recordedLines(recorded.constrainedDividerLines.begin(), recorded.constrainedDividerLines.end());
+    recorder.close();
+
+    InputLogPlayer player;
+    expect(player.open(path), failures, "input log opens for replay");
+    DividedArea replayed(player.getAreaSize(), player.getMaxUnconstrainedDividerLines());
+    player.play(replayed);
+    expect(player.getCheckpointCount() == 41 && player.getCheckpointMismatchCount() == 0, failures, "every checkpoint matches on replay");
+    expect(replayed.constrainedDividerLines.size() == recordedLines.size()
+           && std::memcmp(replayed.constrainedDividerLines.data(), recordedLines.data(), recordedLines.size() * sizeof(ConstrainedDividerLine)) == 0,
+           failures, "replayed lines are bit-identical");
+    expect(player.getDurations(inputlog::Record::ConstrainedDividerLine).size() == static_cast<size_t>(constrainedCalls)
+           && player.getDurations(inputlog::Record::EvictConstrainedDividerLine).size() == 1
+           && player.getDurations(inputlog::Record::DeleteEarlyConstrainedDividerLines).empty(), failures, "only calls from outside the area are logged");
+    std::filesystem::remove(path);
+  }
+  // A shared-memory reader sees each publish in place, until it's lapped
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    for (int i = 0; i < 6; ++i) area.addConstrainedDividerLine({0.1f + i * 0.15f, 0.2f}, {0.1f + i * 0.15f, 0.8f}, ofFloatColor(1.0f));
+    area.updateUnconstrainedDividerLines(std::vector<glm::vec2> { {0.1f, 0.5f}, {0.9f, 0.55f} }, 1.0f / 60.0f);
+    SharedLineSetPublisher publisher;
+    SharedLineSetReader reader;
+    SharedLineSetReader::Snapshot snapshot;
+    expect(publisher.open("/ofxDividedArea-test", area.size, 4, 8) && reader.open("/ofxDividedArea-test"), failures, "shared line set opens");
+    expect(!reader.acquire(snapshot), failures, "nothing to acquire before a publish");
+    publisher.publish(area);
+    expect(reader.acquire(snapshot) && snapshot.generation == 1 && snapshot.constrainedLineCount == 4
+           && std::memcmp(snapshot.constrainedLines, area.constrainedDividerLines.data() + 2, 4 * sizeof(ConstrainedDividerLine)) == 0,
+           failures, "reader sees the newest lines that fit");
+    expect(snapshot.majorLineCount == area.unconstrainedDividerLines.size()
+           && snapshot.majorLineCount > 0 && snapshot.majorLines[0].start == area.unconstrainedDividerLines[0].start, failures, "reader sees the major lines");
+    publisher.publish(area);
+    expect(reader.validate(snapshot), failures, "a snapshot survives the next publish");
+    publisher.publish(area);
+    expect(!reader.validate(snapshot), failures, "a lapped snapshot fails validation");
+    publisher.close();
+    expect(!reader.isPublisherOpen(), failures, "reader sees the publisher close");
+  }
+  // A group's parallel update leaves every cell exactly as the same calls made serially do
+  {
+    constexpr size_t cellCount = 6;
+    std::vector<std::unique_ptr<DividedArea>> grouped, serial;
+    DividedAreaGroup group(3);
+    for (size_t c = 0; c < cellCount; ++c) {
+      grouped.push_back(std::make_unique<DividedArea>(glm::vec2 {1.0f, 1.0f}, 3));
+      serial.push_back(std::make_unique<DividedArea>(glm::vec2 {1.0f, 1.0f}, 3));
+      grouped.back()->maxConstrainedLinesParameter = 40;
+      serial.back()->maxConstrainedLinesParameter = 40;
+      group.add(*grouped.back());
+    }
+    std::minstd_rand random(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (int f = 0; f < 30; ++f) {
+      std::vector<DividedAreaGroup::CellInput> inputs(cellCount);
+      for (size_t c = 0; c < cellCount; ++c) {
+        auto& input = inputs[c];
+        input.updateMajorLines = (f + c) % 3 != 0;
+        input.majorRefPoints = { {unit(random), unit(random)}, {unit(random), unit(random)}, {unit(random), unit(random)} };
+        for (int i = 0; i < 4; ++i) {
+          glm::vec2 ref1 { unit(random), unit(random) };
+          input.constrainedLines.push_back({ ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.3f, ofFloatColor(unit(random)) });
+        }
+      }
+      group.update(inputs, 1.0f / 60.0f);
+      for (size_t c = 0; c < cellCount; ++c) {
+        if (inputs[c].updateMajorLines) serial[c]->updateUnconstrainedDividerLines(inputs[c].majorRefPoints, 1.0f / 60.0f);
+        for (const auto& request : inputs[c].constrainedLines) serial[c]->addConstrainedDividerLine(request);
+      }
+    }
+    bool identical = true;
+    for (size_t c = 0; c < cellCount; ++c) {
+      const auto& a = grouped[c]->constrainedDividerLines;
+      const auto& b = serial[c]->constrainedDividerLines;
+      identical = identical && a.size() == b.size() && !a.empty()
+          && std::memcmp(a.data(), b.data(), a.size() * sizeof(ConstrainedDividerLine)) == 0;
+      const auto& majorsA = grouped[c]->unconstrainedDividerLines;
+      const auto& majorsB = serial[c]->unconstrainedDividerLines;
+      identical = identical && majorsA.size() == majorsB.size();
+      for (size_t i = 0; identical && i < majorsA.size(); ++i) {
+        identical = std::memcmp(&majorsA[i].start, &majorsB[i].start, sizeof(glm::vec2)) == 0
+            && std::memcmp(&majorsA[i].end, &majorsB[i].end, sizeof(glm::vec2)) == 0;
+      }
+    }
+    expect(identical, failures, "group update matches serial updates bit for bit");
+  }
+  // Lines submitted to the async geometry thread latch as a synchronous area builds them
+  {
+    DividedArea async({1.0, 1.0}, 3), sync({1.0, 1.0}, 3);
+    async.maxConstrainedLinesParameter = 40;
+    sync.maxConstrainedLinesParameter = 40;
+    async.setAsyncGeometry(true);
+    std::minstd_rand random(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    uint64_t submitted = 0;
+    for (int f = 0; f < 40; ++f) {
+      std::vector<glm::vec2> refPoints { {0.2f + f * 0.01f, 0.3f}, {0.8f, 0.35f + f * 0.01f}, {0.5f, 0.9f} };
+      if (async.submitMajorRefPoints(refPoints, 1.0f / 60.0f)) ++submitted;
+      sync.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+      for (int i = 0; i < 4; ++i) {
+        glm::vec2 ref1 { unit(random), unit(random) };
+        ConstrainedLineRequest request { ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.3f, ofFloatColor(unit(random)) };
+        if (async.submitConstrainedDividerLine(request)) ++submitted;
+        sync.addConstrainedDividerLine(request);
+      }
+      // A batch a frame, so every snapshot buffer goes round while lines change
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (async.latchAsyncGeometry() < submitted && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+    const auto& latched = async.getLatchedConstrainedLines();
+    expect(submitted == 200 && async.latchAsyncGeometry() == submitted, failures, "async geometry applies every submission");
+    expect(latched.size() == sync.constrainedDividerLines.size()
+           && std::memcmp(latched.data(), sync.constrainedDividerLines.data(), latched.size() * sizeof(ConstrainedDividerLine)) == 0,
+           failures, "latched constrained lines match the synchronous area's");
+    const auto& majors = async.getLatchedMajorLines();
+    bool majorsMatch = majors.size() == sync.unconstrainedDividerLines.size();
+    for (size_t i = 0; majorsMatch && i < majors.size(); ++i) {
+      majorsMatch = majors[i].start == sync.unconstrainedDividerLines[i].start && majors[i].end == sync.unconstrainedDividerLines[i].end;
+    }
+    expect(majorsMatch, failures, "latched major lines match the synchronous area's");
+    async.setAsyncGeometry(false);
+  }
+  // Inserted lines end where a full scan of every line puts them, as majors move and lines are evicted
+  {
+    DividedArea area({1.0, 1.0}, 4);
+    area.maxConstrainedLinesParameter = 600;
+    area.densityGridResolutionParameter = 8;
+    std::minstd_rand random(3);
+    std::uniform_real_distribution<float> unit(-0.1f, 1.1f);
+    int checked = 0, mismatches = 0;
+    for (int f = 0; f < 100; ++f) {
+      float t = f * 0.1f;
+      area.updateUnconstrainedDividerLines(std::vector<glm::vec2> { {0.1f, 0.2f + 0.1f * std::sin(t)}, {0.9f, 0.3f}, {0.5f + 0.1f * std::cos(t), 0.95f}, {0.2f, 0.7f} }, 1.0f / 60.0f);
+      for (int i = 0; i < 20; ++i) {
+        glm::vec2 ref1 { unit(random), unit(random) };
+        glm::vec2 ref2 = ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.2f;
+        DividerLine expected = area.createConstrainedDividerLine(ref1, ref2);
+        if (auto added = area.addConstrainedDividerLine(ref1, ref2, ofFloatColor(1.0f))) {
+          ++checked;
+          if (added->start != expected.start || added->end != expected.end) ++mismatches;
+        }
+      }
+    }
+    expect(checked > 1000 && area.constrainedDividerLines.size() == 600, failures, "clip fixture fills past the cap");
+    expect(mismatches == 0, failures, "indexed clips match the full scan");
+  }
+  // New lines end in the same place whether live reflow is on or not
+  {
+    DividedArea plain({1.0, 1.0}, 3), reflowing({1.0, 1.0}, 3);
+    std::vector<glm::vec2> refPoints { {0.1f, 0.3f}, {0.9f, 0.45f}, {0.4f, 0.95f} };
+    plain.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+    reflowing.updateUnconstrainedDividerLines(refPoints, 1.0f / 60.0f);
+    reflowing.setLiveReflow(true);
+    std::minstd_rand random(9);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    bool same = true;
+    for (int i = 0; i < 400; ++i) {
+      glm::vec2 ref1 { unit(random), unit(random) };
+      glm::vec2 ref2 = ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.2f;
+      auto a = plain.addConstrainedDividerLine(ref1, ref2, ofFloatColor(1.0f));
+      auto b = reflowing.addConstrainedDividerLine(ref1, ref2, ofFloatColor(1.0f));
+      same = same && a.has_value() == b.has_value() && (!a || (a->start == b->start && a->end == b->end));
+    }
+    expect(same && plain.constrainedDividerLines.size() > 100, failures, "live reflow doesn't change where new lines end");
+  }
+  // At the cap, evicting the oldest line uploads just the new one; the store compacts now and then
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.maxConstrainedLinesParameter = 100;
+    area.setConstrainedEvictionPolicy(ConstrainedEvictionPolicy::Oldest);
+    std::minstd_rand random(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Line> added;
+    auto addLine = [&]() {
+      glm::vec2 ref1 { unit(random), unit(random) };
+      auto line = area.addConstrainedDividerLine(ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.1f, ofFloatColor(1.0f));
+      if (line) added.push_back(Line { line->start, line->end });
+      return line.has_value();
+    };
+    for (int attempts = 0; area.constrainedDividerLines.size() < 100 && attempts < 10000; ++attempts) addLine();
+    area.drawInstanced(100.0f);
+    area.resetRenderStats();
+    while (!addLine()) {}
+    area.drawInstanced(100.0f);
+    expect(area.getRenderStats().uploadedBytes == sizeof(ConstrainedDividerLine) && area.getRenderStats().instances == 100, failures, "eviction at the cap uploads only the new line");
+    area.resetRenderStats();
+    bool culledAll = true;
+    for (uint64_t inserted = 0; inserted < 300;) {
+      if (!addLine()) continue;
+      ++inserted;
+      area.drawInstanced(100.0f);
+      area.drawInstanced(100.0f, ofRectangle(0.0f, 0.0f, 100.0f, 100.0f));
+      culledAll = culledAll && area.getRenderStats().instances == 200 * inserted;
+    }
+    expect(area.getRenderStats().uploadedBytes < 3 * 300 * sizeof(ConstrainedDividerLine), failures, "compaction uploads amortize over the evictions");
+    expect(culledAll, failures, "draws start past the evicted lines");
+    const auto& lines = area.constrainedDividerLines;
+    const auto& serials = area.getConstrainedLineSerials();
+    bool kept = lines.size() == 100 && serials.size() == 100;
+    for (size_t i = 0; kept && i < lines.size(); ++i) {
+      const Line& expected = added[added.size() - lines.size() + i];
+      kept = lines[i].start == expected.start && lines[i].end == expected.end && serials[i] == serials[0] + i;
+    }
+    expect(kept, failures, "the newest lines kept, in order, with their serials");
+  }
+  // Growing the capacity while async geometry runs reallocates on the render thread without disturbing the geometry thread's tracking
+  {
+    DividedArea area({1.0, 1.0}, 3);
+    area.maxConstrainedLinesParameter = 64;
+    area.setAsyncGeometry(true);
+    std::minstd_rand random(9);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    uint64_t submitted = area.latchAsyncGeometry();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    auto addLine = [&]() {
+      size_t count = area.getLatchedConstrainedLines().size();
+      while (area.getLatchedConstrainedLines().size() == count && std::chrono::steady_clock::now() < deadline) {
+        glm::vec2 ref1 { unit(random), unit(random) };
+        if (area.submitConstrainedDividerLine({ ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.1f, ofFloatColor(1.0f) })) ++submitted;
+        while (area.latchAsyncGeometry() < submitted && std::chrono::steady_clock::now() < deadline) {
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+      }
+    };
+    addLine();
+    area.drawInstanced(100.0f);
+    bool onlyNewLines = true;
+    for (int capacity = 128; capacity <= 1024; capacity *= 2) {
+      area.maxConstrainedLinesParameter = capacity;
+      addLine();
+      area.drawInstanced(100.0f); // reallocates, so uploads everything
+      area.resetRenderStats();
+      addLine();
+      area.drawInstanced(100.0f);
+      onlyNewLines = onlyNewLines && area.getRenderStats().uploadedBytes == sizeof(ConstrainedDividerLine);
+    }
+    expect(onlyNewLines && std::chrono::steady_clock::now() < deadline, failures, "a reallocation leaves the next upload to the new line");
+    area.setAsyncGeometry(false);
+  }
+  // At the cap, a group's batched draw and an async area's draw upload only what eviction and the new line touch
+  {
+    DividedArea grouped({1.0, 1.0}, 3), async({1.0, 1.0}, 3);
+    std::minstd_rand random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto nextRequest = [&]() {
+      glm::vec2 ref1 { unit(random), unit(random) };
+      return ConstrainedLineRequest { ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.1f, ofFloatColor(1.0f) };
+    };
+    for (DividedArea* area : { &grouped, &async }) {
+      area->maxConstrainedLinesParameter = 100;
+      area->setConstrainedEvictionPolicy(ConstrainedEvictionPolicy::Oldest);
+      for (int attempts = 0; area->constrainedDividerLines.size() < 100 && attempts < 10000; ++attempts) area->addConstrainedDividerLine(nextRequest());
+    }
+    DividedAreaGroup group(1);
+    group.add(grouped);
+    group.drawInstanced(100.0f);
+    const auto& stats = group.getBatchedLineRenderer().getRenderStats();
+    uint64_t uploaded = stats.uploadedBytes;
+    while (!grouped.addConstrainedDividerLine(nextRequest())) {}
+    group.drawInstanced(100.0f);
+    expect(stats.uploadedBytes - uploaded == 2 * sizeof(ConstrainedDividerLine), failures, "batched eviction blanks one line and uploads the new one");
+
+    async.setAsyncGeometry(true);
+    async.drawInstanced(100.0f);
+    async.resetRenderStats();
+    uint64_t submitted = async.latchAsyncGeometry();
+    size_t accepted = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (accepted < 50 && std::chrono::steady_clock::now() < deadline) {
+      size_t head = async.getLatchedConstrainedLines().getHead();
+      if (async.submitConstrainedDividerLine(nextRequest())) ++submitted;
+      while (async.latchAsyncGeometry() < submitted && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      async.drawInstanced(100.0f);
+      if (async.getLatchedConstrainedLines().getHead() != head) ++accepted;
+    }
+    expect(accepted == 50 && async.getRenderStats().uploadedBytes == 50 * sizeof(ConstrainedDividerLine), failures, "async eviction at the cap uploads just the new lines");
+    async.setAsyncGeometry(false);
+  }
+  // Evicting from the middle moves just the oldest line into the gap, so each eviction uploads that and the new line
+  for (auto policy : { ConstrainedEvictionPolicy::Random, ConstrainedEvictionPolicy::Densest }) {
+    std::string name = (policy == ConstrainedEvictionPolicy::Random) ? "random" : "densest";
+    DividedArea area({1.0, 1.0}, 3);
+    area.maxConstrainedLinesParameter = 100;
+    area.setConstrainedEvictionPolicy(policy);
+    std::minstd_rand random(9);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto addLine = [&]() {
+      glm::vec2 ref1 { unit(random), unit(random) };
+      return area.addConstrainedDividerLine(ref1, ref1 + glm::vec2 { unit(random) - 0.5f, unit(random) - 0.5f } * 0.1f, ofFloatColor(1.0f)).has_value();
+    };
+    for (int attempts = 0; area.constrainedDividerLines.size() < 100 && attempts < 10000; ++attempts) addLine();
+    area.drawInstanced(100.0f);
+    area.resetRenderStats();
+    while (!addLine()) {}
+    area.drawInstanced(100.0f);
+    expect(area.getRenderStats().uploadedBytes <= 2 * sizeof(ConstrainedDividerLine), failures, name + " eviction uploads the moved line and the new one");
+    area.resetRenderStats();
+    for (int inserted = 0; inserted < 300;) {
+      if (!addLine()) continue;
+      ++inserted;
+      area.drawInstanced(100.0f);
+    }
+    expect(area.getRenderStats().uploadedBytes < 4 * 300 * sizeof(ConstrainedDividerLine), failures, name + " eviction uploads amortize to a few lines each");
+    std::vector<uint64_t> serials(area.getConstrainedLineSerials().begin(), area.getConstrainedLineSerials().end());
+    std::sort(serials.begin(), serials.end());
+    expect(serials.size() == 100 && std::adjacent_find(serials.begin(), serials.end()) == serials.end(), failures, name + " eviction keeps every line once");
+  }
 }